@@ -24,27 +24,120 @@
 
 #include "as-app-private.h"
 #include "as-cleanup.h"
+#include "as-key.h"
 #include "as-utils.h"
 
+typedef struct {
+	AsKey		 kind;
+	const gchar	*locale;
+	gchar		*value;
+} AsAppDesktopValue;
+
 /**
- * as_app_desktop_key_get_locale:
- */
+ * as_app_desktop_unescape_char:
+ *
+ * Returns the unescaped character for a backslash followed by @c, or NUL
+ * if the sequence is not valid in a desktop file.
+ **/
+static gchar
+as_app_desktop_unescape_char (gchar c)
+{
+	switch (c) {
+	case 's':
+		return ' ';
+	case 'n':
+		return '\n';
+	case 't':
+		return '\t';
+	case 'r':
+		return '\r';
+	case '\\':
+		return '\\';
+	case ';':
+		return ';';
+	default:
+		break;
+	}
+	return '\0';
+}
+
+/**
+ * as_app_desktop_value_unescape:
+ *
+ * Unescapes a string value in place, which can only ever make it shorter.
+ **/
 static gchar *
-as_app_desktop_key_get_locale (const gchar *key)
+as_app_desktop_value_unescape (gchar *value)
+{
+	gchar *dst;
+	gchar *src;
+
+	/* nothing to do */
+	dst = strchr (value, '\\');
+	if (dst == NULL)
+		return value;
+
+	for (src = dst; *src != '\0'; src++) {
+		gchar c;
+		if (*src != '\\' || src[1] == '\0') {
+			*dst++ = *src;
+			continue;
+		}
+		c = as_app_desktop_unescape_char (src[1]);
+		if (c == '\0') {
+			*dst++ = *src;
+			continue;
+		}
+		*dst++ = c;
+		src++;
+	}
+	*dst = '\0';
+	return value;
+}
+
+/**
+ * as_app_desktop_value_split:
+ *
+ * Splits a string list value in place at each unescaped ';', unescaping
+ * each element as it goes. The returned array points into @value and
+ * should be freed with g_free() rather than g_strfreev().
+ **/
+static gchar **
+as_app_desktop_value_split (gchar *value)
 {
-	gchar *tmp1;
-	gchar *tmp2;
-	gchar *locale = NULL;
-
-	tmp1 = g_strstr_len (key, -1, "[");
-	if (tmp1 == NULL)
-		return NULL;
-	tmp2 = g_strstr_len (tmp1, -1, "]");
-	if (tmp2 == NULL)
-		return NULL;
-	locale = g_strdup (tmp1 + 1);
-	locale[tmp2 - tmp1 - 1] = '\0';
-	return locale;
+	gchar **list;
+	gchar *dst = value;
+	gchar *src = value;
+	guint n = 0;
+
+	/* there can never be more elements than separators plus one */
+	for (; *src != '\0'; src++) {
+		if (*src == ';')
+			n++;
+	}
+	list = g_new0 (gchar *, n + 2);
+
+	n = 0;
+	src = value;
+	while (*src != '\0') {
+		list[n++] = dst;
+		while (*src != '\0' && *src != ';') {
+			gchar c;
+			if (*src == '\\' && src[1] != '\0') {
+				c = as_app_desktop_unescape_char (src[1]);
+				if (c != '\0') {
+					*dst++ = c;
+					src += 2;
+					continue;
+				}
+			}
+			*dst++ = *src++;
+		}
+		if (*src == ';')
+			src++;
+		*dst++ = '\0';
+	}
+	return list;
 }
 
 /**
@@ -52,46 +145,44 @@ as_app_desktop_key_get_locale (const gchar *key)
  **/
 static gboolean
 as_app_infer_file_key (AsApp *app,
-		       GKeyFile *kf,
-		       const gchar *key,
+		       AsKey kind,
+		       gchar *value,
 		       GError **error)
 {
-	_cleanup_free_ gchar *tmp = NULL;
-
-	if (g_strcmp0 (key, "X-GNOME-UsesNotifications") == 0) {
+	switch (kind) {
+	case AS_KEY_X_GNOME_USES_NOTIFICATIONS:
 		as_app_add_kudo_kind (AS_APP (app),
 				      AS_KUDO_KIND_NOTIFICATIONS);
+		break;
 
-	} else if (g_strcmp0 (key, "X-GNOME-Bugzilla-Bugzilla") == 0) {
-		tmp = g_key_file_get_string (kf,
-					     G_KEY_FILE_DESKTOP_GROUP,
-					     key,
-					     NULL);
-		if (g_strcmp0 (tmp, "GNOME") == 0)
+	case AS_KEY_X_GNOME_BUGZILLA_BUGZILLA:
+		as_app_desktop_value_unescape (value);
+		if (g_strcmp0 (value, "GNOME") == 0)
 			as_app_set_project_group (app, "GNOME");
+		break;
 
-	} else if (g_strcmp0 (key, "X-MATE-Bugzilla-Product") == 0) {
+	case AS_KEY_X_MATE_BUGZILLA_PRODUCT:
 		as_app_set_project_group (app, "MATE");
+		break;
 
-	} else if (g_strcmp0 (key, "X-KDE-StartupNotify") == 0) {
+	case AS_KEY_X_KDE_STARTUP_NOTIFY:
 		as_app_set_project_group (app, "KDE");
+		break;
 
-	} else if (g_strcmp0 (key, "X-DocPath") == 0) {
-		tmp = g_key_file_get_string (kf,
-					     G_KEY_FILE_DESKTOP_GROUP,
-					     key,
-					     NULL);
-		if (g_str_has_prefix (tmp, "http://userbase.kde.org/"))
+	case AS_KEY_X_DOC_PATH:
+		as_app_desktop_value_unescape (value);
+		if (g_str_has_prefix (value, "http://userbase.kde.org/"))
 			as_app_set_project_group (app, "KDE");
+		break;
 
 	/* Exec */
-	} else if (g_strcmp0 (key, G_KEY_FILE_DESKTOP_KEY_EXEC) == 0) {
-		tmp = g_key_file_get_string (kf,
-					     G_KEY_FILE_DESKTOP_GROUP,
-					     key,
-					     NULL);
-		if (g_str_has_prefix (tmp, "xfce4-"))
+	case AS_KEY_EXEC:
+		as_app_desktop_value_unescape (value);
+		if (g_str_has_prefix (value, "xfce4-"))
 			as_app_set_project_group (app, "XFCE");
+		break;
+	default:
+		break;
 	}
 
 	return TRUE;
@@ -123,73 +214,73 @@ _as_utils_is_stock_icon_name_fallback (const gchar *name)
  **/
 static gboolean
 as_app_parse_file_key (AsApp *app,
-		       GKeyFile *kf,
-		       const gchar *key,
+		       AsKey kind,
+		       const gchar *locale,
+		       gchar *value,
 		       AsAppParseFlags flags,
 		       GError **error)
 {
 	gchar *dot = NULL;
 	guint i;
 	guint j;
-	_cleanup_free_ gchar *locale = NULL;
-	_cleanup_free_ gchar *tmp = NULL;
-	_cleanup_strv_free_ gchar **list = NULL;
+	_cleanup_free_ gchar **list = NULL;
+
+	switch (kind) {
 
 	/* NoDisplay */
-	if (g_strcmp0 (key, G_KEY_FILE_DESKTOP_KEY_NO_DISPLAY) == 0) {
-		tmp = g_key_file_get_string (kf,
-					     G_KEY_FILE_DESKTOP_GROUP,
-					     key,
-					     NULL);
-		if (tmp != NULL && strcasecmp (tmp, "True") == 0)
+	case AS_KEY_NO_DISPLAY:
+		if (locale != NULL)
+			break;
+		as_app_desktop_value_unescape (value);
+		if (strcasecmp (value, "True") == 0)
 			as_app_add_veto (app, "NoDisplay=true");
+		break;
 
 	/* Type */
-	} else if (g_strcmp0 (key, G_KEY_FILE_DESKTOP_KEY_TYPE) == 0) {
-		tmp = g_key_file_get_string (kf,
-					     G_KEY_FILE_DESKTOP_GROUP,
-					     key,
-					     NULL);
-		if (g_strcmp0 (tmp, G_KEY_FILE_DESKTOP_TYPE_APPLICATION) != 0) {
+	case AS_KEY_TYPE:
+		if (locale != NULL)
+			break;
+		as_app_desktop_value_unescape (value);
+		if (g_strcmp0 (value, G_KEY_FILE_DESKTOP_TYPE_APPLICATION) != 0) {
 			g_set_error_literal (error,
 					     AS_APP_ERROR,
 					     AS_APP_ERROR_INVALID_TYPE,
 					     "not an application");
 			return FALSE;
 		}
+		break;
 
 	/* Icon */
-	} else if (g_strcmp0 (key, G_KEY_FILE_DESKTOP_KEY_ICON) == 0) {
-		tmp = g_key_file_get_string (kf,
-					     G_KEY_FILE_DESKTOP_GROUP,
-					     key,
-					     NULL);
-		if (tmp != NULL && tmp[0] != '\0') {
+	case AS_KEY_ICON:
+		if (locale != NULL)
+			break;
+		as_app_desktop_value_unescape (value);
+		if (value[0] != '\0') {
 			_cleanup_object_unref_ AsIcon *icon = NULL;
 			icon = as_icon_new ();
-			as_icon_set_name (icon, tmp);
-			dot = g_strstr_len (tmp, -1, ".");
+			as_icon_set_name (icon, value);
+			dot = g_strstr_len (value, -1, ".");
 			if (dot != NULL)
 				*dot = '\0';
-			if (as_utils_is_stock_icon_name (tmp)) {
-				as_icon_set_name (icon, tmp);
+			if (as_utils_is_stock_icon_name (value)) {
+				as_icon_set_name (icon, value);
 				as_icon_set_kind (icon, AS_ICON_KIND_STOCK);
 			} else if ((flags & AS_APP_PARSE_FLAG_USE_FALLBACKS) > 0 &&
-				   _as_utils_is_stock_icon_name_fallback (tmp)) {
-				as_icon_set_name (icon, tmp);
+				   _as_utils_is_stock_icon_name_fallback (value)) {
+				as_icon_set_name (icon, value);
 				as_icon_set_kind (icon, AS_ICON_KIND_STOCK);
 			} else {
 				as_icon_set_kind (icon, AS_ICON_KIND_LOCAL);
 			}
 			as_app_add_icon (app, icon);
 		}
+		break;
 
 	/* Categories */
-	} else if (g_strcmp0 (key, G_KEY_FILE_DESKTOP_KEY_CATEGORIES) == 0) {
-		list = g_key_file_get_string_list (kf,
-						   G_KEY_FILE_DESKTOP_GROUP,
-						   key,
-						   NULL, NULL);
+	case AS_KEY_CATEGORIES:
+		if (locale != NULL)
+			break;
+		list = as_app_desktop_value_split (value);
 		for (i = 0; list[i] != NULL; i++) {
 
 			/* check categories that if present would blacklist
@@ -220,188 +311,294 @@ as_app_parse_file_key (AsApp *app,
 				continue;
 			as_app_add_category (app, list[i]);
 		}
+		break;
 
-	} else if (g_strcmp0 (key, "Keywords") == 0) {
-		list = g_key_file_get_string_list (kf,
-						   G_KEY_FILE_DESKTOP_GROUP,
-						   key,
-						   NULL, NULL);
+	/* Keywords and Keywords[] */
+	case AS_KEY_KEYWORDS:
+		list = as_app_desktop_value_split (value);
 		for (i = 0; list[i] != NULL; i++) {
 			_cleanup_strv_free_ gchar **kw_split = NULL;
 			kw_split = g_strsplit (list[i], ",", -1);
 			for (j = 0; kw_split[j] != NULL; j++) {
 				if (kw_split[j][0] == '\0')
 					continue;
-				as_app_add_keyword (app, "C", kw_split[j]);
+				as_app_add_keyword (app,
+						    locale != NULL ? locale : "C",
+						    kw_split[j]);
 			}
 		}
+		break;
 
-	} else if (g_str_has_prefix (key, "Keywords")) {
-		locale = as_app_desktop_key_get_locale (key);
-		list = g_key_file_get_locale_string_list (kf,
-							  G_KEY_FILE_DESKTOP_GROUP,
-							  key,
-							  locale,
-							  NULL, NULL);
-		for (i = 0; list[i] != NULL; i++) {
-			_cleanup_strv_free_ gchar **kw_split = NULL;
-			kw_split = g_strsplit (list[i], ",", -1);
-			for (j = 0; kw_split[j] != NULL; j++) {
-				if (kw_split[j][0] == '\0')
-					continue;
-				as_app_add_keyword (app, locale, kw_split[j]);
-			}
-		}
-
-	} else if (g_strcmp0 (key, "MimeType") == 0) {
-		list = g_key_file_get_string_list (kf,
-						   G_KEY_FILE_DESKTOP_GROUP,
-						   key,
-						   NULL, NULL);
+	case AS_KEY_MIME_TYPE:
+		if (locale != NULL)
+			break;
+		list = as_app_desktop_value_split (value);
 		for (i = 0; list[i] != NULL; i++)
 			as_app_add_mimetype (app, list[i]);
+		break;
 
-	} else if (g_strcmp0 (key, "X-AppInstall-Package") == 0) {
-		tmp = g_key_file_get_string (kf,
-					     G_KEY_FILE_DESKTOP_GROUP,
-					     key,
-					     NULL);
-		if (tmp != NULL && tmp[0] != '\0')
-			as_app_add_pkgname (app, tmp);
+	case AS_KEY_X_APP_INSTALL_PACKAGE:
+		if (locale != NULL)
+			break;
+		as_app_desktop_value_unescape (value);
+		if (value[0] != '\0')
+			as_app_add_pkgname (app, value);
+		break;
 
 	/* OnlyShowIn */
-	} else if (g_strcmp0 (key, G_KEY_FILE_DESKTOP_KEY_ONLY_SHOW_IN) == 0) {
+	case AS_KEY_ONLY_SHOW_IN:
+		if (locale != NULL)
+			break;
 		/* if an app has only one entry, it's that desktop */
-		list = g_key_file_get_string_list (kf,
-						   G_KEY_FILE_DESKTOP_GROUP,
-						   key,
-						   NULL, NULL);
+		list = as_app_desktop_value_split (value);
 		if (g_strv_length (list) == 1)
 			as_app_set_project_group (app, list[0]);
-
-	/* Name */
-	} else if (g_strcmp0 (key, G_KEY_FILE_DESKTOP_KEY_NAME) == 0 ||
-	           g_strcmp0 (key, "_Name") == 0) {
-		tmp = g_key_file_get_string (kf,
-					     G_KEY_FILE_DESKTOP_GROUP,
-					     key,
-					     NULL);
-		if (tmp != NULL && tmp[0] != '\0')
-			as_app_set_name (app, "C", tmp);
-
-	/* Name[] */
-	} else if (g_str_has_prefix (key, G_KEY_FILE_DESKTOP_KEY_NAME)) {
-		locale = as_app_desktop_key_get_locale (key);
-		tmp = g_key_file_get_locale_string (kf,
-						    G_KEY_FILE_DESKTOP_GROUP,
-						    G_KEY_FILE_DESKTOP_KEY_NAME,
-						    locale,
-						    NULL);
-		if (tmp != NULL && tmp[0] != '\0')
-			as_app_set_name (app, locale, tmp);
-
-	/* Comment */
-	} else if (g_strcmp0 (key, G_KEY_FILE_DESKTOP_KEY_COMMENT) == 0 ||
-	           g_strcmp0 (key, "_Comment") == 0) {
-		tmp = g_key_file_get_string (kf,
-					     G_KEY_FILE_DESKTOP_GROUP,
-					     key,
-					     NULL);
-		if (tmp != NULL && tmp[0] != '\0')
-			as_app_set_comment (app, "C", tmp);
-
-	/* Comment[] */
-	} else if (g_str_has_prefix (key, G_KEY_FILE_DESKTOP_KEY_COMMENT)) {
-		locale = as_app_desktop_key_get_locale (key);
-		tmp = g_key_file_get_locale_string (kf,
-						    G_KEY_FILE_DESKTOP_GROUP,
-						    G_KEY_FILE_DESKTOP_KEY_COMMENT,
-						    locale,
-						    NULL);
-		if (tmp != NULL && tmp[0] != '\0')
-			as_app_set_comment (app, locale, tmp);
-
-	/* non-standard */
-	} else if (g_strcmp0 (key, "X-Ubuntu-Software-Center-Name") == 0) {
-		tmp = g_key_file_get_string (kf,
-					     G_KEY_FILE_DESKTOP_GROUP,
-					     key,
-					     NULL);
-		if (tmp != NULL && tmp[0] != '\0')
-			as_app_set_name (app, "C", tmp);
-	} else if (g_str_has_prefix (key, "X-Ubuntu-Software-Center-Name")) {
-		locale = as_app_desktop_key_get_locale (key);
-		tmp = g_key_file_get_locale_string (kf,
-						    G_KEY_FILE_DESKTOP_GROUP,
-						    "X-Ubuntu-Software-Center-Name",
-						    locale,
-						    NULL);
-		if (tmp != NULL && tmp[0] != '\0')
-			as_app_set_name (app, locale, tmp);
+		break;
+
+	/* Name and Name[], and the non-standard Ubuntu variant */
+	case AS_KEY_NAME:
+	case AS_KEY_X_UBUNTU_SOFTWARE_CENTER_NAME:
+		as_app_desktop_value_unescape (value);
+		if (value[0] != '\0')
+			as_app_set_name (app, locale != NULL ? locale : "C", value);
+		break;
+
+	/* Comment and Comment[] */
+	case AS_KEY_COMMENT:
+		as_app_desktop_value_unescape (value);
+		if (value[0] != '\0')
+			as_app_set_comment (app, locale != NULL ? locale : "C", value);
+		break;
+	default:
+		break;
 	}
 
 	return TRUE;
 }
 
 /**
- * as_app_parse_file_key_fallback_comment:
+ * as_app_desktop_value_hash:
+ **/
+static guint
+as_app_desktop_value_hash (gconstpointer v)
+{
+	const AsAppDesktopValue *dv = v;
+	if (dv->locale == NULL)
+		return dv->kind;
+	return dv->kind ^ g_str_hash (dv->locale);
+}
+
+/**
+ * as_app_desktop_value_equal:
  **/
 static gboolean
-as_app_parse_file_key_fallback_comment (AsApp *app,
-					GKeyFile *kf,
-					const gchar *key,
-					GError **error)
+as_app_desktop_value_equal (gconstpointer a, gconstpointer b)
 {
-	_cleanup_free_ gchar *locale = NULL;
-	_cleanup_free_ gchar *tmp = NULL;
-
-	/* GenericName */
-	if (g_strcmp0 (key, G_KEY_FILE_DESKTOP_KEY_GENERIC_NAME) == 0 ||
-	           g_strcmp0 (key, "_GenericName") == 0) {
-		tmp = g_key_file_get_string (kf,
-					     G_KEY_FILE_DESKTOP_GROUP,
-					     key,
-					     NULL);
-		if (tmp != NULL && tmp[0] != '\0')
-			as_app_set_comment (app, "C", tmp);
-
-	/* GenericName[] */
-	} else if (g_str_has_prefix (key, G_KEY_FILE_DESKTOP_KEY_GENERIC_NAME)) {
-		locale = as_app_desktop_key_get_locale (key);
-		tmp = g_key_file_get_locale_string (kf,
-						    G_KEY_FILE_DESKTOP_GROUP,
-						    G_KEY_FILE_DESKTOP_KEY_GENERIC_NAME,
-						    locale,
-						    NULL);
-		if (tmp != NULL && tmp[0] != '\0')
-			as_app_set_comment (app, locale, tmp);
+	const AsAppDesktopValue *dv1 = a;
+	const AsAppDesktopValue *dv2 = b;
+	return dv1->kind == dv2->kind &&
+	       g_strcmp0 (dv1->locale, dv2->locale) == 0;
+}
+
+/**
+ * as_app_parse_desktop_values:
+ *
+ * Applies the interesting keys of the [Desktop Entry] group in file order.
+ **/
+static gboolean
+as_app_parse_desktop_values (AsApp *app,
+			     GArray *values,
+			     AsAppParseFlags flags,
+			     GError **error)
+{
+	AsAppDesktopValue *dv;
+	guint i;
+	_cleanup_hashtable_unref_ GHashTable *latest = NULL;
+
+	/* like GKeyFile, the last of any duplicate keys wins */
+	latest = g_hash_table_new (as_app_desktop_value_hash,
+				   as_app_desktop_value_equal);
+	for (i = 0; i < values->len; i++) {
+		dv = &g_array_index (values, AsAppDesktopValue, i);
+		g_hash_table_insert (latest, dv, dv);
+	}
+
+	for (i = 0; i < values->len; i++) {
+		dv = &g_array_index (values, AsAppDesktopValue, i);
+		if (g_hash_table_lookup (latest, dv) != dv)
+			continue;
+
+		/* only used if there is no comment */
+		if (dv->kind == AS_KEY_GENERIC_NAME)
+			continue;
+
+		if (!as_app_parse_file_key (app, dv->kind, dv->locale,
+					    dv->value, flags, error))
+			return FALSE;
+		if ((flags & AS_APP_PARSE_FLAG_USE_HEURISTICS) > 0 &&
+		    dv->locale == NULL) {
+			if (!as_app_infer_file_key (app, dv->kind, dv->value, error))
+				return FALSE;
+		}
+	}
+
+	/* perform any fallbacks, using GenericName and GenericName[] */
+	if ((flags & AS_APP_PARSE_FLAG_USE_FALLBACKS) > 0 &&
+	    as_app_get_comment_size (app) == 0) {
+		for (i = 0; i < values->len; i++) {
+			dv = &g_array_index (values, AsAppDesktopValue, i);
+			if (dv->kind != AS_KEY_GENERIC_NAME)
+				continue;
+			if (g_hash_table_lookup (latest, dv) != dv)
+				continue;
+			as_app_desktop_value_unescape (dv->value);
+			if (dv->value[0] == '\0')
+				continue;
+			as_app_set_comment (app,
+					    dv->locale != NULL ? dv->locale : "C",
+					    dv->value);
+		}
 	}
 
 	return TRUE;
 }
 
 /**
- * as_app_parse_desktop_file:
+ * as_app_parse_desktop_keys:
+ *
+ * Scans the [Desktop Entry] group of a desktop file in a single pass. The
+ * data is modified in place so that keys, locales and values can be used
+ * without copying, and keys that are not interesting are never unescaped.
  **/
-gboolean
-as_app_parse_desktop_file (AsApp *app,
+static gboolean
+as_app_parse_desktop_keys (AsApp *app,
 			   const gchar *desktop_file,
+			   gchar *data,
 			   AsAppParseFlags flags,
 			   GError **error)
+{
+	AsKey kind;
+	gboolean in_group = FALSE;
+	gboolean seen_group = FALSE;
+	gboolean seen_desktop_group = FALSE;
+	gchar *eq;
+	gchar *key_end;
+	gchar *line;
+	gchar *locale;
+	gchar *next;
+	gchar *tmp;
+	gchar *value;
+	guint lineno = 0;
+	_cleanup_array_unref_ GArray *values = NULL;
+
+	values = g_array_new (FALSE, FALSE, sizeof (AsAppDesktopValue));
+	for (line = data; line != NULL; line = next) {
+		lineno++;
+		next = strchr (line, '\n');
+		if (next != NULL)
+			*next++ = '\0';
+
+		/* blank lines and comments */
+		while (g_ascii_isspace (*line))
+			line++;
+		if (line[0] == '\0' || line[0] == '#')
+			continue;
+
+		/* group */
+		if (line[0] == '[') {
+			in_group = g_str_has_prefix (line, "[" G_KEY_FILE_DESKTOP_GROUP "]");
+			if (in_group)
+				seen_desktop_group = TRUE;
+			seen_group = TRUE;
+			continue;
+		}
+
+		/* key=value */
+		eq = strchr (line, '=');
+		if (eq == NULL || !seen_group) {
+			g_set_error (error,
+				     AS_APP_ERROR,
+				     AS_APP_ERROR_INVALID_TYPE,
+				     "Failed to parse %s: invalid line %u",
+				     desktop_file, lineno);
+			return FALSE;
+		}
+		if (!in_group)
+			continue;
+
+		/* key, with an optional [locale] suffix */
+		for (key_end = eq; key_end > line && g_ascii_isspace (key_end[-1]); key_end--);
+		locale = NULL;
+		tmp = memchr (line, '[', (gsize) (key_end - line));
+		if (tmp != NULL) {
+			if (key_end[-1] != ']')
+				continue;
+			key_end[-1] = '\0';
+			locale = tmp + 1;
+			key_end = tmp;
+		}
+		kind = as_key_from_data (line, (gsize) (key_end - line));
+		if (kind == AS_KEY_UNKNOWN)
+			continue;
+
+		/* value, which has to be valid UTF-8 */
+		value = eq + 1;
+		while (*value == ' ' || *value == '\t')
+			value++;
+		tmp = value + strlen (value);
+		if (tmp > value && tmp[-1] == '\r')
+			tmp[-1] = '\0';
+		if (!g_utf8_validate (value, -1, NULL))
+			continue;
+
+		{
+			AsAppDesktopValue dv = { kind, locale, value };
+			g_array_append_val (values, dv);
+		}
+	}
+
+	/* no [Desktop Entry] */
+	if (!seen_desktop_group) {
+		g_set_error (error,
+			     AS_APP_ERROR,
+			     AS_APP_ERROR_INVALID_TYPE,
+			     "Failed to parse %s: no %s group",
+			     desktop_file, G_KEY_FILE_DESKTOP_GROUP);
+		return FALSE;
+	}
+
+	return as_app_parse_desktop_values (app, values, flags, error);
+}
+
+/**
+ * as_app_parse_desktop_keyfile:
+ *
+ * Loads the desktop file using GKeyFile, which is slower than scanning it
+ * but is able to keep the comments.
+ **/
+static gboolean
+as_app_parse_desktop_keyfile (AsApp *app,
+			      const gchar *desktop_file,
+			      const gchar *data,
+			      AsAppParseFlags flags,
+			      GError **error)
 {
 	GKeyFileFlags kf_flags = G_KEY_FILE_KEEP_TRANSLATIONS;
+	gchar *key;
 	gchar *tmp;
+	gchar *value;
+	gsize key_len;
 	guint i;
+	_cleanup_array_unref_ GArray *values = NULL;
 	_cleanup_error_free_ GError *error_local = NULL;
-	_cleanup_free_ gchar *app_id = NULL;
 	_cleanup_keyfile_unref_ GKeyFile *kf = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *data_values = NULL;
 	_cleanup_strv_free_ gchar **keys = NULL;
 
-	/* load file */
 	kf = g_key_file_new ();
 	if (flags & AS_APP_PARSE_FLAG_KEEP_COMMENTS)
 		kf_flags |= G_KEY_FILE_KEEP_COMMENTS;
-	if (!g_key_file_load_from_file (kf, desktop_file, kf_flags, &error_local)) {
+	if (!g_key_file_load_from_data (kf, data, -1, kf_flags, &error_local)) {
 		g_set_error (error,
 			     AS_APP_ERROR,
 			     AS_APP_ERROR_INVALID_TYPE,
@@ -409,6 +606,63 @@ as_app_parse_desktop_file (AsApp *app,
 			     desktop_file, error_local->message);
 		return FALSE;
 	}
+	keys = g_key_file_get_keys (kf, G_KEY_FILE_DESKTOP_GROUP, NULL, NULL);
+	if (keys == NULL) {
+		g_set_error (error,
+			     AS_APP_ERROR,
+			     AS_APP_ERROR_INVALID_TYPE,
+			     "Failed to parse %s: no %s group",
+			     desktop_file, G_KEY_FILE_DESKTOP_GROUP);
+		return FALSE;
+	}
+
+	/* the same values the scanner would have found */
+	values = g_array_new (FALSE, FALSE, sizeof (AsAppDesktopValue));
+	data_values = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; keys[i] != NULL; i++) {
+		AsAppDesktopValue dv;
+		value = g_key_file_get_value (kf, G_KEY_FILE_DESKTOP_GROUP,
+					      keys[i], NULL);
+		if (value == NULL)
+			continue;
+		g_ptr_array_add (data_values, value);
+		if (!g_utf8_validate (value, -1, NULL))
+			continue;
+
+		/* key, with an optional [locale] suffix */
+		key = keys[i];
+		key_len = strlen (key);
+		dv.locale = NULL;
+		tmp = strchr (key, '[');
+		if (tmp != NULL) {
+			if (key[key_len - 1] != ']')
+				continue;
+			key[key_len - 1] = '\0';
+			dv.locale = tmp + 1;
+			key_len = (gsize) (tmp - key);
+		}
+		dv.kind = as_key_from_data (key, key_len);
+		if (dv.kind == AS_KEY_UNKNOWN)
+			continue;
+		dv.value = value;
+		g_array_append_val (values, dv);
+	}
+
+	return as_app_parse_desktop_values (app, values, flags, error);
+}
+
+/**
+ * as_app_parse_desktop_data:
+ **/
+gboolean
+as_app_parse_desktop_data (AsApp *app,
+			   const gchar *desktop_file,
+			   gchar *data,
+			   AsAppParseFlags flags,
+			   GError **error)
+{
+	gchar *tmp;
+	_cleanup_free_ gchar *app_id = NULL;
 
 	/* create app */
 	app_id = g_path_get_basename (desktop_file);
@@ -426,28 +680,14 @@ as_app_parse_desktop_file (AsApp *app,
 		as_app_set_id (app, app_id);
 
 	/* look at all the keys */
-	keys = g_key_file_get_keys (kf, G_KEY_FILE_DESKTOP_GROUP, NULL, error);
-	if (keys == NULL)
-		return FALSE;
-	for (i = 0; keys[i] != NULL; i++) {
-		if (!as_app_parse_file_key (app, kf, keys[i], flags, error))
+	if (flags & AS_APP_PARSE_FLAG_KEEP_COMMENTS) {
+		if (!as_app_parse_desktop_keyfile (app, desktop_file, data,
+						   flags, error))
+			return FALSE;
+	} else {
+		if (!as_app_parse_desktop_keys (app, desktop_file, data,
+						flags, error))
 			return FALSE;
-		if ((flags & AS_APP_PARSE_FLAG_USE_HEURISTICS) > 0) {
-			if (!as_app_infer_file_key (app, kf, keys[i], error))
-				return FALSE;
-		}
-	}
-
-	/* perform any fallbacks */
-	if ((flags & AS_APP_PARSE_FLAG_USE_FALLBACKS) > 0 &&
-	    as_app_get_comment_size (app) == 0) {
-		for (i = 0; keys[i] != NULL; i++) {
-			if (!as_app_parse_file_key_fallback_comment (app,
-								     kf,
-								     keys[i],
-								     error))
-				return FALSE;
-		}
 	}
 
 	/* all applications require icons */
@@ -456,3 +696,27 @@ as_app_parse_desktop_file (AsApp *app,
 
 	return TRUE;
 }
+
+/**
+ * as_app_parse_desktop_file:
+ **/
+gboolean
+as_app_parse_desktop_file (AsApp *app,
+			   const gchar *desktop_file,
+			   AsAppParseFlags flags,
+			   GError **error)
+{
+	_cleanup_error_free_ GError *error_local = NULL;
+	_cleanup_free_ gchar *data = NULL;
+
+	/* load file */
+	if (!g_file_get_contents (desktop_file, &data, NULL, &error_local)) {
+		g_set_error (error,
+			     AS_APP_ERROR,
+			     AS_APP_ERROR_INVALID_TYPE,
+			     "Failed to parse %s: %s",
+			     desktop_file, error_local->message);
+		return FALSE;
+	}
+	return as_app_parse_desktop_data (app, desktop_file, data, flags, error);
+}
@@ -30,6 +30,7 @@
 
 #include "as-app.h"
 #include "as-node-private.h"
+#include "as-yaml.h"
 
 G_BEGIN_DECLS
 
@@ -90,10 +91,23 @@ gboolean	 as_app_node_parse_dep11	(AsApp		*app,
 						 GNode		*node,
 						 AsNodeContext	*ctx,
 						 GError		**error);
+void		 as_app_node_emit_dep11		(AsApp		*app,
+						 AsYamlEmitter	*emitter);
 gboolean	 as_app_parse_desktop_file	(AsApp		*app,
 						 const gchar	*filename,
 						 AsAppParseFlags flags,
 						 GError		**error);
+gboolean	 as_app_parse_desktop_data	(AsApp		*app,
+						 const gchar	*filename,
+						 gchar		*data,
+						 AsAppParseFlags flags,
+						 GError		**error);
+gboolean	 as_app_parse_data		(AsApp		*app,
+						 const gchar	*filename,
+						 gchar		*data,
+						 gsize		 data_len,
+						 AsAppParseFlags flags,
+						 GError		**error);
 gboolean	 as_app_parse_inf_file		(AsApp		*app,
 						 const gchar	*filename,
 						 AsAppParseFlags flags,
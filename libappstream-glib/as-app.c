@@ -41,6 +41,7 @@
 #include "as-cleanup.h"
 #include "as-enums.h"
 #include "as-icon-private.h"
+#include "as-key.h"
 #include "as-node-private.h"
 #include "as-provide-private.h"
 #include "as-release-private.h"
@@ -49,6 +50,16 @@
 #include "as-utils-private.h"
 #include "as-yaml.h"
 
+typedef enum {
+	AS_APP_DICT_NAMES		= 1 << 0,
+	AS_APP_DICT_COMMENTS		= 1 << 1,
+	AS_APP_DICT_DEVELOPER_NAMES	= 1 << 2,
+	AS_APP_DICT_DESCRIPTIONS	= 1 << 3,
+	AS_APP_DICT_METADATA		= 1 << 4,
+	AS_APP_DICT_URLS		= 1 << 5,
+	AS_APP_DICT_LAST
+} AsAppDict;
+
 typedef struct _AsAppPrivate	AsAppPrivate;
 struct _AsAppPrivate
 {
@@ -91,9 +102,14 @@ struct _AsAppPrivate
 	gchar		*source_pkgname;
 	gchar		*update_contact;
 	gchar		*source_file;
+	gchar		*content_hash;
 	gint		 priority;
-	gsize		 token_cache_valid;
+	gboolean	 releases_sorted;
+	guint		 releases_generation;
+	gboolean	 token_cache_valid;
+	GMutex		 token_cache_mutex;
 	GPtrArray	*token_cache;			/* of AsAppTokenItem */
+	guint		 shared_dicts;			/* of AsAppDict */
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (AsApp, as_app, G_TYPE_OBJECT)
@@ -106,6 +122,63 @@ typedef struct {
 	guint		  score;
 } AsAppTokenItem;
 
+/**
+ * as_app_dict_get:
+ **/
+static GHashTable **
+as_app_dict_get (AsApp *app, AsAppDict kind)
+{
+	AsAppPrivate *priv = GET_PRIVATE (app);
+	switch (kind) {
+	case AS_APP_DICT_NAMES:
+		return &priv->names;
+	case AS_APP_DICT_COMMENTS:
+		return &priv->comments;
+	case AS_APP_DICT_DEVELOPER_NAMES:
+		return &priv->developer_names;
+	case AS_APP_DICT_DESCRIPTIONS:
+		return &priv->descriptions;
+	case AS_APP_DICT_METADATA:
+		return &priv->metadata;
+	case AS_APP_DICT_URLS:
+		return &priv->urls;
+	default:
+		break;
+	}
+	g_assert_not_reached ();
+	return NULL;
+}
+
+/**
+ * as_app_dict_unshare:
+ *
+ * Dictionaries can be shared between applications by as_app_subsume_full()
+ * and have to be copied before they are modified.
+ **/
+static void
+as_app_dict_unshare (AsApp *app, AsAppDict kind)
+{
+	AsAppPrivate *priv = GET_PRIVATE (app);
+	GHashTable **dict;
+	GHashTable *copy;
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+
+	/* we are the only user */
+	if ((priv->shared_dicts & kind) == 0)
+		return;
+
+	dict = as_app_dict_get (app, kind);
+	copy = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	g_hash_table_iter_init (&iter, *dict);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_hash_table_insert (copy, g_strdup (key), g_strdup (value));
+	g_hash_table_unref (*dict);
+	*dict = copy;
+	priv->shared_dicts &= ~kind;
+}
+
 /**
  * as_app_error_quark:
  *
@@ -265,6 +338,7 @@ as_app_finalize (GObject *object)
 	g_free (priv->source_pkgname);
 	g_free (priv->update_contact);
 	g_free (priv->source_file);
+	g_free (priv->content_hash);
 	g_hash_table_unref (priv->comments);
 	g_hash_table_unref (priv->developer_names);
 	g_hash_table_unref (priv->descriptions);
@@ -288,6 +362,7 @@ as_app_finalize (GObject *object)
 	g_ptr_array_unref (priv->icons);
 	g_ptr_array_unref (priv->bundles);
 	g_ptr_array_unref (priv->token_cache);
+	g_mutex_clear (&priv->token_cache_mutex);
 	g_ptr_array_unref (priv->vetos);
 
 	G_OBJECT_CLASS (as_app_parent_class)->finalize (object);
@@ -328,6 +403,7 @@ as_app_init (AsApp *app)
 	priv->icons = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	priv->bundles = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	priv->token_cache = g_ptr_array_new_with_free_func ((GDestroyNotify) as_app_token_item_free);
+	g_mutex_init (&priv->token_cache_mutex);
 	priv->vetos = g_ptr_array_new_with_free_func (g_free);
 
 	priv->comments = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
@@ -595,11 +671,50 @@ as_app_get_mimetypes (AsApp *app)
 	return priv->mimetypes;
 }
 
+/**
+ * as_app_releases_sort_cb:
+ **/
+static gint
+as_app_releases_sort_cb (gconstpointer a, gconstpointer b)
+{
+	AsRelease **rel1 = (AsRelease **) a;
+	AsRelease **rel2 = (AsRelease **) b;
+	return as_release_vercmp (*rel1, *rel2);
+}
+
+/**
+ * as_app_releases_ensure_sorted:
+ *
+ * Releases are inserted in order, but may have been modified since, for
+ * instance by as_release_set_timestamp() or when shared with another app,
+ * so the order is checked again only if a release has been added or any
+ * release version or timestamp has changed since the last check.
+ **/
+static void
+as_app_releases_ensure_sorted (AsApp *app)
+{
+	AsAppPrivate *priv = GET_PRIVATE (app);
+	guint generation = as_release_get_generation ();
+	guint i;
+
+	if (priv->releases_sorted && priv->releases_generation == generation)
+		return;
+	priv->releases_sorted = TRUE;
+	priv->releases_generation = generation;
+	for (i = 1; i < priv->releases->len; i++) {
+		if (as_release_vercmp (g_ptr_array_index (priv->releases, i - 1),
+				       g_ptr_array_index (priv->releases, i)) > 0) {
+			g_ptr_array_sort (priv->releases, as_app_releases_sort_cb);
+			return;
+		}
+	}
+}
+
 /**
  * as_app_get_releases:
  * @app: a #AsApp instance.
  *
- * Gets all the releases the application has had.
+ * Gets all the releases the application has had, newest first.
  *
  * Returns: (element-type AsRelease) (transfer none): an array
  *
@@ -609,6 +724,7 @@ GPtrArray *
 as_app_get_releases (AsApp *app)
 {
 	AsAppPrivate *priv = GET_PRIVATE (app);
+	as_app_releases_ensure_sorted (app);
 	return priv->releases;
 }
 
@@ -651,18 +767,12 @@ as_app_get_release (AsApp *app, const gchar *version)
 AsRelease *
 as_app_get_release_default (AsApp *app)
 {
-	AsAppPrivate *priv = GET_PRIVATE (app);
-	AsRelease *release_newest = NULL;
-	AsRelease *release_tmp = NULL;
-	guint i;
+	GPtrArray *releases = as_app_get_releases (app);
 
-	for (i = 0; i < priv->releases->len; i++) {
-		release_tmp = g_ptr_array_index (priv->releases, i);
-		if (release_newest == NULL ||
-		    as_release_vercmp (release_tmp, release_newest) < 1)
-			release_newest = release_tmp;
-	}
-	return release_newest;
+	/* releases are kept newest first */
+	if (releases->len == 0)
+		return NULL;
+	return g_ptr_array_index (releases, 0);
 }
 
 /**
@@ -1369,6 +1479,28 @@ as_app_get_source_file (AsApp *app)
 	return priv->source_file;
 }
 
+/**
+ * as_app_get_content_hash:
+ * @app: a #AsApp instance.
+ *
+ * Gets a checksum of the metadata the instance was last parsed from.
+ * Components parsed from identical XML or YAML have the same checksum,
+ * which makes it suitable for invalidating caches.
+ *
+ * NOTE: the checksum is not updated when the instance is modified after
+ * it has been parsed.
+ *
+ * Returns: string, or %NULL if the instance was not parsed from a node
+ *
+ * Since: 0.5.0
+ **/
+const gchar *
+as_app_get_content_hash (AsApp *app)
+{
+	AsAppPrivate *priv = GET_PRIVATE (app);
+	return priv->content_hash;
+}
+
 /**
  * as_app_validate_utf8:
  **/
@@ -1404,6 +1536,23 @@ as_app_validate_utf8 (const gchar *text)
 
 /******************************************************************************/
 
+/**
+ * as_app_invalidate_tokens:
+ *
+ * Called by every setter that changes data used for searching.
+ **/
+static void
+as_app_invalidate_tokens (AsApp *app)
+{
+	AsAppPrivate *priv = GET_PRIVATE (app);
+	g_mutex_lock (&priv->token_cache_mutex);
+	if (priv->token_cache_valid) {
+		g_ptr_array_set_size (priv->token_cache, 0);
+		priv->token_cache_valid = FALSE;
+	}
+	g_mutex_unlock (&priv->token_cache_mutex);
+}
+
 /**
  * as_app_set_id:
  * @app: a #AsApp instance.
@@ -1435,6 +1584,7 @@ as_app_set_id (AsApp *app, const gchar *id)
 	tmp = g_strrstr_len (priv->id_filename, -1, ".");
 	if (tmp != NULL)
 		*tmp = '\0';
+	as_app_invalidate_tokens (app);
 }
 
 /**
@@ -1773,9 +1923,11 @@ as_app_set_name (AsApp *app,
 	tmp_locale = as_app_parse_locale (locale);
 	if (tmp_locale == NULL)
 		return;
+	as_app_dict_unshare (app, AS_APP_DICT_NAMES);
 	g_hash_table_insert (priv->names,
 			     tmp_locale,
 			     g_strdup (name));
+	as_app_invalidate_tokens (app);
 }
 
 /**
@@ -1809,9 +1961,11 @@ as_app_set_comment (AsApp *app,
 	tmp_locale = as_app_parse_locale (locale);
 	if (tmp_locale == NULL)
 		return;
+	as_app_dict_unshare (app, AS_APP_DICT_COMMENTS);
 	g_hash_table_insert (priv->comments,
 			     tmp_locale,
 			     g_strdup (comment));
+	as_app_invalidate_tokens (app);
 }
 
 /**
@@ -1845,6 +1999,7 @@ as_app_set_developer_name (AsApp *app,
 	tmp_locale = as_app_parse_locale (locale);
 	if (tmp_locale == NULL)
 		return;
+	as_app_dict_unshare (app, AS_APP_DICT_DEVELOPER_NAMES);
 	g_hash_table_insert (priv->developer_names,
 			     tmp_locale,
 			     g_strdup (developer_name));
@@ -1881,9 +2036,11 @@ as_app_set_description (AsApp *app,
 	tmp_locale = as_app_parse_locale (locale);
 	if (tmp_locale == NULL)
 		return;
+	as_app_dict_unshare (app, AS_APP_DICT_DESCRIPTIONS);
 	g_hash_table_insert (priv->descriptions,
 			     tmp_locale,
 			     g_strdup (description));
+	as_app_invalidate_tokens (app);
 }
 
 /**
@@ -2006,6 +2163,7 @@ as_app_add_keyword (AsApp *app,
 			return;
 	}
 	g_ptr_array_add (tmp, g_strdup (keyword));
+	as_app_invalidate_tokens (app);
 }
 
 /**
@@ -2101,6 +2259,7 @@ as_app_add_mimetype (AsApp *app, const gchar *mimetype)
 	}
 
 	g_ptr_array_add (priv->mimetypes, g_strdup (mimetype));
+	as_app_invalidate_tokens (app);
 }
 
 /**
@@ -2150,6 +2309,36 @@ as_app_subsume_release (AsRelease *release, AsRelease *donor)
 	}
 }
 
+/**
+ * as_app_add_release_sorted:
+ *
+ * Inserts the release after any that are the same or newer, so that the
+ * array is always newest first and never needs sorting.
+ **/
+static void
+as_app_add_release_sorted (AsApp *app, AsRelease *release)
+{
+	AsAppPrivate *priv = GET_PRIVATE (app);
+	AsRelease *release_tmp;
+	guint hi = priv->releases->len;
+	guint lo = 0;
+	guint mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		release_tmp = g_ptr_array_index (priv->releases, mid);
+		if (as_release_vercmp (release_tmp, release) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	g_ptr_array_add (priv->releases, NULL);
+	memmove (priv->releases->pdata + lo + 1,
+		 priv->releases->pdata + lo,
+		 (priv->releases->len - lo - 1) * sizeof (gpointer));
+	priv->releases->pdata[lo] = g_object_ref (release);
+}
+
 /**
  * as_app_add_release:
  * @app: a #AsApp instance.
@@ -2171,12 +2360,18 @@ as_app_add_release (AsApp *app, AsRelease *release)
 		release_old = as_app_get_release (app, NULL);
 	if (release_old == release)
 		return;
+	priv->releases_sorted = FALSE;
 	if (release_old != NULL) {
+		/* the version or timestamp may have changed */
+		g_object_ref (release_old);
 		as_app_subsume_release (release_old, release);
+		g_ptr_array_remove (priv->releases, release_old);
+		as_app_add_release_sorted (app, release_old);
+		g_object_unref (release_old);
 		return;
 	}
 
-	g_ptr_array_add (priv->releases, g_object_ref (release));
+	as_app_add_release_sorted (app, release);
 }
 
 /**
@@ -2454,6 +2649,7 @@ as_app_add_url (AsApp *app,
 		return;
 	}
 
+	as_app_dict_unshare (app, AS_APP_DICT_URLS);
 	g_hash_table_insert (priv->urls,
 			     g_strdup (as_url_kind_to_string (url_kind)),
 			     g_strdup (url));
@@ -2485,6 +2681,7 @@ as_app_add_metadata (AsApp *app,
 
 	if (value == NULL)
 		value = "";
+	as_app_dict_unshare (app, AS_APP_DICT_METADATA);
 	g_hash_table_insert (priv->metadata,
 			     g_strdup (key),
 			     g_strdup (value));
@@ -2503,6 +2700,7 @@ void
 as_app_remove_metadata (AsApp *app, const gchar *key)
 {
 	AsAppPrivate *priv = GET_PRIVATE (app);
+	as_app_dict_unshare (app, AS_APP_DICT_METADATA);
 	g_hash_table_remove (priv->metadata, key);
 }
 
@@ -2552,6 +2750,7 @@ as_app_add_addon (AsApp *app, AsApp *addon)
 {
 	AsAppPrivate *priv = GET_PRIVATE (app);
 	g_ptr_array_add (priv->addons, g_object_ref (addon));
+	as_app_invalidate_tokens (app);
 }
 
 /******************************************************************************/
@@ -2563,25 +2762,76 @@ as_app_add_addon (AsApp *app, AsApp *addon)
 static void
 as_app_subsume_dict (GHashTable *dest, GHashTable *src, gboolean overwrite)
 {
-	GList *l;
+	GHashTableIter iter;
 	const gchar *tmp;
-	const gchar *key;
-	const gchar *value;
-	_cleanup_list_free_ GList *keys = NULL;
-
-	keys = g_hash_table_get_keys (src);
-	for (l = keys; l != NULL; l = l->next) {
-		key = l->data;
-		if (!overwrite) {
-			tmp = g_hash_table_lookup (dest, key);
-			if (tmp != NULL)
+	gpointer key;
+	gpointer value;
+
+	g_hash_table_iter_init (&iter, src);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		tmp = g_hash_table_lookup (dest, key);
+		if (tmp != NULL) {
+			if (!overwrite)
+				continue;
+			if (g_strcmp0 (tmp, value) == 0)
 				continue;
 		}
-		value = g_hash_table_lookup (src, key);
 		g_hash_table_insert (dest, g_strdup (key), g_strdup (value));
 	}
 }
 
+/**
+ * as_app_subsume_dict_shared:
+ *
+ * Like as_app_subsume_dict() but shares the donor dictionary rather than
+ * copying it when the application has no data of its own, and only copies
+ * when either application modifies it.
+ **/
+static void
+as_app_subsume_dict_shared (AsApp *app,
+			    AsApp *donor,
+			    AsAppDict kind,
+			    gboolean overwrite)
+{
+	AsAppPrivate *papp = GET_PRIVATE (app);
+	AsAppPrivate *priv = GET_PRIVATE (donor);
+	GHashTable **dest;
+	GHashTable *src;
+	GHashTableIter iter;
+	const gchar *tmp;
+	gpointer key;
+	gpointer value;
+
+	/* nothing to do */
+	dest = as_app_dict_get (app, kind);
+	src = *as_app_dict_get (donor, kind);
+	if (*dest == src || g_hash_table_size (src) == 0)
+		return;
+
+	/* share */
+	if (g_hash_table_size (*dest) == 0) {
+		g_hash_table_unref (*dest);
+		*dest = g_hash_table_ref (src);
+		papp->shared_dicts |= kind;
+		priv->shared_dicts |= kind;
+		return;
+	}
+
+	/* only copy the entries that are different */
+	g_hash_table_iter_init (&iter, src);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		tmp = g_hash_table_lookup (*dest, key);
+		if (tmp != NULL) {
+			if (!overwrite)
+				continue;
+			if (g_strcmp0 (tmp, value) == 0)
+				continue;
+		}
+		as_app_dict_unshare (app, kind);
+		g_hash_table_insert (*dest, g_strdup (key), g_strdup (value));
+	}
+}
+
 /**
  * as_app_subsume_keywords:
  **/
@@ -2767,12 +3017,12 @@ as_app_subsume_private (AsApp *app, AsApp *donor, AsAppSubsumeFlags flags)
 	}
 
 	/* dictionaries */
-	as_app_subsume_dict (papp->names, priv->names, overwrite);
-	as_app_subsume_dict (papp->comments, priv->comments, overwrite);
-	as_app_subsume_dict (papp->developer_names, priv->developer_names, overwrite);
-	as_app_subsume_dict (papp->descriptions, priv->descriptions, overwrite);
-	as_app_subsume_dict (papp->metadata, priv->metadata, overwrite);
-	as_app_subsume_dict (papp->urls, priv->urls, overwrite);
+	as_app_subsume_dict_shared (app, donor, AS_APP_DICT_NAMES, overwrite);
+	as_app_subsume_dict_shared (app, donor, AS_APP_DICT_COMMENTS, overwrite);
+	as_app_subsume_dict_shared (app, donor, AS_APP_DICT_DEVELOPER_NAMES, overwrite);
+	as_app_subsume_dict_shared (app, donor, AS_APP_DICT_DESCRIPTIONS, overwrite);
+	as_app_subsume_dict_shared (app, donor, AS_APP_DICT_METADATA, overwrite);
+	as_app_subsume_dict_shared (app, donor, AS_APP_DICT_URLS, overwrite);
 	as_app_subsume_keywords (app, donor, overwrite);
 
 	/* source */
@@ -2796,6 +3046,9 @@ as_app_subsume_private (AsApp *app, AsApp *donor, AsAppSubsumeFlags flags)
 	/* project_group */
 	if (priv->project_group != NULL)
 		as_app_set_project_group (app, priv->project_group);
+
+	/* the search tokens have to be worked out again */
+	as_app_invalidate_tokens (app);
 }
 
 /**
@@ -2928,17 +3181,6 @@ as_app_ptr_array_sort_cb (gconstpointer a, gconstpointer b)
 	return g_strcmp0 (*((const gchar **) a), *((const gchar **) b));
 }
 
-/**
- * as_app_releases_sort_cb:
- **/
-static gint
-as_app_releases_sort_cb (gconstpointer a, gconstpointer b)
-{
-	AsRelease **rel1 = (AsRelease **) a;
-	AsRelease **rel2 = (AsRelease **) b;
-	return as_release_vercmp (*rel1, *rel2);
-}
-
 /**
  * as_app_icons_sort_cb:
  **/
@@ -3237,8 +3479,7 @@ as_app_node_insert (AsApp *app, GNode *parent, AsNodeContext *ctx)
 	}
 
 	/* <releases> */
-	if (priv->releases->len > 0) {
-		g_ptr_array_sort (priv->releases, as_app_releases_sort_cb);
+	if (as_app_get_releases (app)->len > 0) {
 		node_tmp = as_node_insert (node_app, "releases", NULL, 0, NULL);
 		for (i = 0; i < priv->releases->len && i < 3; i++) {
 			rel = g_ptr_array_index (priv->releases, i);
@@ -3347,6 +3588,7 @@ as_app_node_parse_child (AsApp *app, GNode *n, AsAppParseFlags flags,
 		taken = as_app_parse_locale (as_node_get_attribute (n, "xml:lang"));
 		if (taken == NULL)
 			break;
+		as_app_dict_unshare (app, AS_APP_DICT_NAMES);
 		g_hash_table_insert (priv->names,
 				     taken,
 				     as_node_take_data (n));
@@ -3357,6 +3599,7 @@ as_app_node_parse_child (AsApp *app, GNode *n, AsAppParseFlags flags,
 		taken = as_app_parse_locale (as_node_get_attribute (n, "xml:lang"));
 		if (taken == NULL)
 			break;
+		as_app_dict_unshare (app, AS_APP_DICT_COMMENTS);
 		g_hash_table_insert (priv->comments,
 				     taken,
 				     as_node_take_data (n));
@@ -3367,6 +3610,7 @@ as_app_node_parse_child (AsApp *app, GNode *n, AsAppParseFlags flags,
 		taken = as_app_parse_locale (as_node_get_attribute (n, "xml:lang"));
 		if (taken == NULL)
 			break;
+		as_app_dict_unshare (app, AS_APP_DICT_DEVELOPER_NAMES);
 		g_hash_table_insert (priv->developer_names,
 				     taken,
 				     as_node_take_data (n));
@@ -3396,6 +3640,7 @@ as_app_node_parse_child (AsApp *app, GNode *n, AsAppParseFlags flags,
 				g_propagate_error (error, error_local);
 				return FALSE;
 			}
+			as_app_dict_unshare (app, AS_APP_DICT_DESCRIPTIONS);
 			as_app_subsume_dict (priv->descriptions, unwrapped, FALSE);
 			break;
 		}
@@ -3652,6 +3897,7 @@ as_app_node_parse_child (AsApp *app, GNode *n, AsAppParseFlags flags,
 
 	/* <metadata> */
 	case AS_TAG_METADATA:
+		as_app_dict_unshare (app, AS_APP_DICT_METADATA);
 		if (!(flags & AS_APP_PARSE_FLAG_APPEND_DATA))
 			g_hash_table_remove_all (priv->metadata);
 		for (c = n->children; c != NULL; c = c->next) {
@@ -3734,6 +3980,12 @@ as_app_node_parse_full (AsApp *app, GNode *node, AsAppParseFlags flags,
 			as_app_set_priority (app, prio);
 	}
 
+	/* appended data is not covered by a single node */
+	g_free (priv->content_hash);
+	priv->content_hash = NULL;
+	if (!(flags & AS_APP_PARSE_FLAG_APPEND_DATA))
+		priv->content_hash = as_node_get_checksum (node);
+
 	/* parse each node */
 	if (!(flags & AS_APP_PARSE_FLAG_APPEND_DATA)) {
 		g_ptr_array_set_size (priv->compulsory_for_desktops, 0);
@@ -3749,6 +4001,9 @@ as_app_node_parse_full (AsApp *app, GNode *node, AsAppParseFlags flags,
 			return FALSE;
 	}
 
+	/* the localized data is added without using the setters */
+	as_app_invalidate_tokens (app);
+
 	/* if only one icon is listed, look for HiDPI versions too */
 	if (as_app_get_icons(app)->len == 1)
 		as_app_check_for_hidpi_icons (app);
@@ -3775,6 +4030,184 @@ as_app_node_parse (AsApp *app, GNode *node, AsNodeContext *ctx, GError **error)
 	return as_app_node_parse_full (app, node, AS_APP_PARSE_FLAG_NONE, ctx, error);
 }
 
+/**
+ * as_app_node_emit_dep11_localized:
+ **/
+static void
+as_app_node_emit_dep11_localized (AsYamlEmitter *emitter,
+				  const gchar *key,
+				  GHashTable *hash)
+{
+	GList *l;
+	_cleanup_list_free_ GList *keys = NULL;
+
+	if (g_hash_table_size (hash) == 0)
+		return;
+	as_yaml_emitter_scalar (emitter, key);
+	as_yaml_emitter_mapping_start (emitter);
+	keys = g_hash_table_get_keys (hash);
+	keys = g_list_sort (keys, (GCompareFunc) g_strcmp0);
+	for (l = keys; l != NULL; l = l->next) {
+		as_yaml_emitter_key_value (emitter, l->data,
+					   g_hash_table_lookup (hash, l->data));
+	}
+	as_yaml_emitter_mapping_end (emitter);
+}
+
+/**
+ * as_app_node_emit_dep11_array:
+ **/
+static void
+as_app_node_emit_dep11_array (AsYamlEmitter *emitter,
+			      const gchar *key,
+			      GPtrArray *array)
+{
+	guint i;
+
+	if (array->len == 0)
+		return;
+	if (key != NULL)
+		as_yaml_emitter_scalar (emitter, key);
+	as_yaml_emitter_sequence_start (emitter);
+	for (i = 0; i < array->len; i++)
+		as_yaml_emitter_string (emitter, g_ptr_array_index (array, i));
+	as_yaml_emitter_sequence_end (emitter);
+}
+
+/**
+ * as_app_node_emit_dep11:
+ * @app: a #AsApp instance.
+ * @emitter: a #AsYamlEmitter.
+ *
+ * Writes the application as a DEP-11 document, the inverse of
+ * as_app_node_parse_dep11().
+ **/
+void
+as_app_node_emit_dep11 (AsApp *app, AsYamlEmitter *emitter)
+{
+	AsAppPrivate *priv = GET_PRIVATE (app);
+	AsIcon *icon;
+	GList *l;
+	const gchar *tmp;
+	guint i;
+	gboolean has_icon = FALSE;
+	_cleanup_list_free_ GList *keys = NULL;
+
+	as_yaml_emitter_document_start (emitter);
+
+	/* type */
+	switch (priv->id_kind) {
+	case AS_ID_KIND_DESKTOP:
+		tmp = "desktop-app";
+		break;
+	case AS_ID_KIND_ADDON:
+		tmp = "addon";
+		break;
+	case AS_ID_KIND_CODEC:
+		tmp = "codec";
+		break;
+	case AS_ID_KIND_FONT:
+		tmp = "font";
+		break;
+	case AS_ID_KIND_INPUT_METHOD:
+		tmp = "inputmethod";
+		break;
+	default:
+		tmp = "generic";
+		break;
+	}
+	as_yaml_emitter_key_value (emitter, "Type", tmp);
+	as_yaml_emitter_key_value (emitter, "ID", priv->id);
+	as_app_node_emit_dep11_array (emitter, "Packages", priv->pkgnames);
+	as_app_node_emit_dep11_localized (emitter, "Name", priv->names);
+	as_app_node_emit_dep11_localized (emitter, "Summary", priv->comments);
+	as_app_node_emit_dep11_localized (emitter, "Description", priv->descriptions);
+
+	/* keywords */
+	if (g_hash_table_size (priv->keywords) > 0) {
+		as_yaml_emitter_scalar (emitter, "Keywords");
+		as_yaml_emitter_mapping_start (emitter);
+		keys = g_hash_table_get_keys (priv->keywords);
+		keys = g_list_sort (keys, (GCompareFunc) g_strcmp0);
+		for (l = keys; l != NULL; l = l->next) {
+			as_yaml_emitter_key (emitter, l->data);
+			as_app_node_emit_dep11_array (emitter, NULL,
+						      g_hash_table_lookup (priv->keywords, l->data));
+		}
+		as_yaml_emitter_mapping_end (emitter);
+	}
+	as_app_node_emit_dep11_array (emitter, "Categories", priv->categories);
+
+	/* icons are stored once, without the size prefix */
+	for (i = 0; i < priv->icons->len; i++) {
+		icon = g_ptr_array_index (priv->icons, i);
+		if (as_icon_get_kind (icon) != AS_ICON_KIND_CACHED &&
+		    as_icon_get_kind (icon) != AS_ICON_KIND_STOCK)
+			continue;
+		if (as_icon_get_name (icon) == NULL)
+			continue;
+		if (!has_icon) {
+			as_yaml_emitter_scalar (emitter, "Icon");
+			as_yaml_emitter_mapping_start (emitter);
+			has_icon = TRUE;
+		}
+		if (as_icon_get_kind (icon) == AS_ICON_KIND_CACHED) {
+			_cleanup_free_ gchar *basename = NULL;
+			basename = g_path_get_basename (as_icon_get_name (icon));
+			as_yaml_emitter_key_value (emitter, "cached", basename);
+		} else {
+			as_yaml_emitter_key_value (emitter, "stock",
+						   as_icon_get_name (icon));
+		}
+		break;
+	}
+	if (has_icon)
+		as_yaml_emitter_mapping_end (emitter);
+
+	/* bundles */
+	if (priv->bundles->len > 0) {
+		as_yaml_emitter_scalar (emitter, "Bundle");
+		as_yaml_emitter_sequence_start (emitter);
+		for (i = 0; i < priv->bundles->len; i++) {
+			AsBundle *bu = g_ptr_array_index (priv->bundles, i);
+			as_yaml_emitter_mapping_start (emitter);
+			as_yaml_emitter_key_value (emitter, "id", as_bundle_get_id (bu));
+			as_yaml_emitter_mapping_end (emitter);
+		}
+		as_yaml_emitter_sequence_end (emitter);
+	}
+
+	/* only the homepage is supported */
+	tmp = g_hash_table_lookup (priv->urls, as_url_kind_to_string (AS_URL_KIND_HOMEPAGE));
+	if (tmp != NULL) {
+		as_yaml_emitter_scalar (emitter, "Url");
+		as_yaml_emitter_mapping_start (emitter);
+		as_yaml_emitter_key_value (emitter, "homepage", tmp);
+		as_yaml_emitter_mapping_end (emitter);
+	}
+
+	/* provides */
+	if (priv->mimetypes->len > 0) {
+		as_yaml_emitter_scalar (emitter, "Provides");
+		as_yaml_emitter_mapping_start (emitter);
+		as_app_node_emit_dep11_array (emitter, "mimetypes", priv->mimetypes);
+		as_yaml_emitter_mapping_end (emitter);
+	}
+
+	/* screenshots */
+	if (priv->screenshots->len > 0) {
+		as_yaml_emitter_scalar (emitter, "Screenshots");
+		as_yaml_emitter_sequence_start (emitter);
+		for (i = 0; i < priv->screenshots->len; i++) {
+			AsScreenshot *ss = g_ptr_array_index (priv->screenshots, i);
+			as_screenshot_node_emit_dep11 (ss, emitter);
+		}
+		as_yaml_emitter_sequence_end (emitter);
+	}
+
+	as_yaml_emitter_document_end (emitter);
+}
+
 /**
  * as_app_node_parse_dep11_icons:
  **/
@@ -3838,54 +4271,49 @@ gboolean
 as_app_node_parse_dep11 (AsApp *app, GNode *node,
 			 AsNodeContext *ctx, GError **error)
 {
+	AsAppPrivate *priv = GET_PRIVATE (app);
 	GNode *c;
 	GNode *c2;
 	GNode *n;
-	const gchar *tmp;
+
+	g_free (priv->content_hash);
+	priv->content_hash = as_yaml_node_get_checksum (node);
 
 	for (n = node->children; n != NULL; n = n->next) {
-		tmp = as_yaml_node_get_key (n);
-		if (g_strcmp0 (tmp, "ID") == 0) {
+		switch (as_key_from_string (as_yaml_node_get_key (n))) {
+		case AS_KEY_ID:
 			as_app_set_id (app, as_yaml_node_get_value (n));
-			continue;
-		}
-		if (g_strcmp0 (tmp, "Type") == 0) {
-			if (g_strcmp0 (as_yaml_node_get_value (n), "desktop-app") == 0) {
+			break;
+		case AS_KEY_TYPE:
+			if (g_strcmp0 (as_yaml_node_get_value (n), "desktop-app") == 0)
 				as_app_set_id_kind (app, AS_ID_KIND_DESKTOP);
-				continue;
-			}
-			continue;
-		}
-		if (g_strcmp0 (tmp, "Packages") == 0) {
+			break;
+		case AS_KEY_PACKAGES:
 			for (c = n->children; c != NULL; c = c->next)
 				as_app_add_pkgname (app, as_yaml_node_get_key (c));
-			continue;
-		}
-		if (g_strcmp0 (tmp, "Name") == 0) {
+			break;
+		case AS_KEY_NAME:
 			for (c = n->children; c != NULL; c = c->next) {
 				as_app_set_name (app,
 						 as_yaml_node_get_key (c),
 						 as_yaml_node_get_value (c));
 			}
-			continue;
-		}
-		if (g_strcmp0 (tmp, "Summary") == 0) {
+			break;
+		case AS_KEY_SUMMARY:
 			for (c = n->children; c != NULL; c = c->next) {
 				as_app_set_comment (app,
 						    as_yaml_node_get_key (c),
 						    as_yaml_node_get_value (c));
 			}
-			continue;
-		}
-		if (g_strcmp0 (tmp, "Description") == 0) {
+			break;
+		case AS_KEY_DESCRIPTION:
 			for (c = n->children; c != NULL; c = c->next) {
 				as_app_set_description (app,
 							as_yaml_node_get_key (c),
 							as_yaml_node_get_value (c));
 			}
-			continue;
-		}
-		if (g_strcmp0 (tmp, "Keywords") == 0) {
+			break;
+		case AS_KEY_KEYWORDS:
 			for (c = n->children; c != NULL; c = c->next) {
 				for (c2 = c->children; c2 != NULL; c2 = c2->next) {
 					if (as_yaml_node_get_key (c2) == NULL)
@@ -3895,21 +4323,18 @@ as_app_node_parse_dep11 (AsApp *app, GNode *node,
 							   as_yaml_node_get_key (c2));
 				}
 			}
-			continue;
-		}
-		if (g_strcmp0 (tmp, "Categories") == 0) {
+			break;
+		case AS_KEY_CATEGORIES:
 			for (c = n->children; c != NULL; c = c->next)
 				as_app_add_category (app, as_yaml_node_get_key (c));
-			continue;
-		}
-		if (g_strcmp0 (tmp, "Icon") == 0) {
+			break;
+		case AS_KEY_ICON:
 			for (c = n->children; c != NULL; c = c->next) {
 				if (!as_app_node_parse_dep11_icons (app, c, ctx, error))
 					return FALSE;
 			}
-			continue;
-		}
-		if (g_strcmp0 (tmp, "Bundle") == 0) {
+			break;
+		case AS_KEY_BUNDLE:
 			for (c = n->children; c != NULL; c = c->next) {
 				_cleanup_object_unref_ AsBundle *bu = NULL;
 				bu = as_bundle_new ();
@@ -3917,38 +4342,37 @@ as_app_node_parse_dep11 (AsApp *app, GNode *node,
 					return FALSE;
 				as_app_add_bundle (app, bu);
 			}
-			continue;
-		}
-		if (g_strcmp0 (tmp, "Url") == 0) {
+			break;
+		case AS_KEY_URL:
 			for (c = n->children; c != NULL; c = c->next) {
 				if (g_strcmp0 (as_yaml_node_get_key (c), "homepage") == 0) {
 					as_app_add_url (app,
 							AS_URL_KIND_HOMEPAGE,
 							as_yaml_node_get_value (c));
-					continue;
 				}
 			}
-			continue;
-		}
-		if (g_strcmp0 (tmp, "Provides") == 0) {
+			break;
+		case AS_KEY_PROVIDES:
 			for (c = n->children; c != NULL; c = c->next) {
 				if (g_strcmp0 (as_yaml_node_get_key (c), "mimetypes") == 0) {
 					for (c2 = c->children; c2 != NULL; c2 = c2->next) {
 						as_app_add_mimetype (app,
 								     as_yaml_node_get_key (c2));
 					}
-					continue;
 				} else {
-					_cleanup_object_unref_ AsProvide *pr = NULL;
-					pr = as_provide_new ();
-					if (!as_provide_node_parse_dep11 (pr, c, ctx, error))
-						return FALSE;
-					as_app_add_provide (app, pr);
+					for (c2 = c->children; c2 != NULL; c2 = c2->next) {
+						_cleanup_object_unref_ AsProvide *pr = NULL;
+						pr = as_provide_new ();
+						if (!as_provide_node_parse_dep11 (pr, c2, ctx, error))
+							return FALSE;
+						if (as_provide_get_kind (pr) == AS_PROVIDE_KIND_UNKNOWN)
+							continue;
+						as_app_add_provide (app, pr);
+					}
 				}
 			}
-			continue;
-		}
-		if (g_strcmp0 (tmp, "Screenshots") == 0) {
+			break;
+		case AS_KEY_SCREENSHOTS:
 			for (c = n->children; c != NULL; c = c->next) {
 				_cleanup_object_unref_ AsScreenshot *ss = NULL;
 				ss = as_screenshot_new ();
@@ -3956,7 +4380,9 @@ as_app_node_parse_dep11 (AsApp *app, GNode *node,
 					return FALSE;
 				as_app_add_screenshot (app, ss);
 			}
-			continue;
+			break;
+		default:
+			break;
 		}
 	}
 	return TRUE;
@@ -4111,32 +4537,41 @@ as_app_create_token_cache (AsApp *app)
 }
 
 /**
- * as_app_search_matches:
- * @app: a #AsApp instance.
- * @search: the search term.
+ * as_app_token_cache_lock:
  *
- * Searches application data for a specific keyword.
- *
- * Returns: a match scrore, where 0 is no match and 100 is the best match.
- *
- * Since: 0.1.0
+ * Locks the token cache, creating it if required. The cache must not be
+ * used after as_app_token_cache_unlock() as a setter may clear it.
  **/
-guint
-as_app_search_matches (AsApp *app, const gchar *search)
+static void
+as_app_token_cache_lock (AsApp *app)
 {
 	AsAppPrivate *priv = GET_PRIVATE (app);
-	AsAppTokenItem *item;
-	guint i, j;
-
-	/* nothing to do */
-	if (search == NULL)
-		return 0;
-
-	/* ensure the token cache is created */
-	if (g_once_init_enter (&priv->token_cache_valid)) {
+	g_mutex_lock (&priv->token_cache_mutex);
+	if (!priv->token_cache_valid) {
 		as_app_create_token_cache (app);
-		g_once_init_leave (&priv->token_cache_valid, TRUE);
+		priv->token_cache_valid = TRUE;
 	}
+}
+
+/**
+ * as_app_token_cache_unlock:
+ **/
+static void
+as_app_token_cache_unlock (AsApp *app)
+{
+	AsAppPrivate *priv = GET_PRIVATE (app);
+	g_mutex_unlock (&priv->token_cache_mutex);
+}
+
+/**
+ * as_app_search_matches_locked:
+ **/
+static guint
+as_app_search_matches_locked (AsApp *app, const gchar *search)
+{
+	AsAppPrivate *priv = GET_PRIVATE (app);
+	AsAppTokenItem *item;
+	guint i, j;
 
 	/* find the search term */
 	for (i = 0; i < priv->token_cache->len; i++) {
@@ -4161,6 +4596,32 @@ as_app_search_matches (AsApp *app, const gchar *search)
 	return 0;
 }
 
+/**
+ * as_app_search_matches:
+ * @app: a #AsApp instance.
+ * @search: the search term.
+ *
+ * Searches application data for a specific keyword.
+ *
+ * Returns: a match scrore, where 0 is no match and 100 is the best match.
+ *
+ * Since: 0.1.0
+ **/
+guint
+as_app_search_matches (AsApp *app, const gchar *search)
+{
+	guint score;
+
+	/* nothing to do */
+	if (search == NULL)
+		return 0;
+
+	as_app_token_cache_lock (app);
+	score = as_app_search_matches_locked (app, search);
+	as_app_token_cache_unlock (app);
+	return score;
+}
+
 /**
  * as_app_get_search_tokens:
  * @app: a #AsApp instance.
@@ -4179,13 +4640,8 @@ as_app_get_search_tokens (AsApp *app)
 	GPtrArray *array;
 	guint i, j;
 
-	/* ensure the token cache is created */
-	if (g_once_init_enter (&priv->token_cache_valid)) {
-		as_app_create_token_cache (app);
-		g_once_init_leave (&priv->token_cache_valid, TRUE);
-	}
-
 	/* return all the toek cache */
+	as_app_token_cache_lock (app);
 	array = g_ptr_array_new_with_free_func (g_free);
 	for (i = 0; i < priv->token_cache->len; i++) {
 		item = g_ptr_array_index (priv->token_cache, i);
@@ -4198,6 +4654,7 @@ as_app_get_search_tokens (AsApp *app)
 				g_ptr_array_add (array, g_strdup (item->values_ascii[j]));
 		}
 	}
+	as_app_token_cache_unlock (app);
 	return array;
 }
 
@@ -4219,16 +4676,160 @@ as_app_get_search_tokens (AsApp *app)
 guint
 as_app_search_matches_all (AsApp *app, gchar **search)
 {
+	AsAppPrivate *priv = GET_PRIVATE (app);
+	AsAppTokenItem *item;
+	guint i, j, k;
+	guint matches_sum = 0;
+	guint search_len;
+	guint unmatched;
+	_cleanup_free_ guint *scores = NULL;
+	_cleanup_free_ gboolean *found = NULL;
+
+	/* nothing to do */
+	search_len = g_strv_length (search);
+	if (search_len == 0)
+		return 0;
+
+	/* walk the token cache once, scoring each term on the first item
+	 * it matches in the same way as as_app_search_matches() */
+	scores = g_new0 (guint, search_len);
+	found = g_new0 (gboolean, search_len);
+	unmatched = search_len;
+	as_app_token_cache_lock (app);
+	for (i = 0; i < priv->token_cache->len && unmatched > 0; i++) {
+		item = g_ptr_array_index (priv->token_cache, i);
+		for (k = 0; k < search_len; k++) {
+			if (found[k])
+				continue;
+
+			/* prefer UTF-8 matches */
+			if (item->values_utf8 != NULL) {
+				for (j = 0; item->values_utf8[j] != NULL; j++) {
+					if (g_str_has_prefix (item->values_utf8[j], search[k])) {
+						scores[k] = item->score;
+						found[k] = TRUE;
+						break;
+					}
+				}
+			}
+			if (found[k]) {
+				unmatched--;
+				continue;
+			}
+
+			/* fall back to ASCII matches */
+			if (item->values_ascii != NULL) {
+				for (j = 0; item->values_ascii[j] != NULL; j++) {
+					if (g_str_has_prefix (item->values_ascii[j], search[k])) {
+						scores[k] = item->score / 2;
+						found[k] = TRUE;
+						break;
+					}
+				}
+			}
+			if (found[k])
+				unmatched--;
+		}
+	}
+	as_app_token_cache_unlock (app);
+
+	/* do *all* search keywords match */
+	for (k = 0; k < search_len; k++) {
+		if (scores[k] == 0)
+			return 0;
+		matches_sum += scores[k];
+	}
+	return matches_sum;
+}
+
+/**
+ * as_app_search_score_tokens:
+ **/
+static void
+as_app_search_score_tokens (gchar **tokens,
+			    gchar **search,
+			    const gsize *search_lens,
+			    guint weight,
+			    guint *scores)
+{
+	guint j, k;
+
+	if (tokens == NULL)
+		return;
+	for (j = 0; tokens[j] != NULL; j++) {
+		for (k = 0; search[k] != NULL; k++) {
+			if (strncmp (tokens[j], search[k], search_lens[k]) != 0)
+				continue;
+
+			/* an exact match counts double a prefix match */
+			if (tokens[j][search_lens[k]] == '\0')
+				scores[k] += weight * 2;
+			else
+				scores[k] += weight;
+		}
+	}
+}
+
+/**
+ * as_app_search_matches_ranked:
+ * @app: a #AsApp instance.
+ * @search: the search terms.
+ *
+ * Searches application data for all the specific keywords, returning a
+ * relevance score suitable for ranking results against each other.
+ *
+ * Unlike as_app_search_matches_all() every matching token contributes to the
+ * score rather than just the first hit, so a term found in the name, summary
+ * and keywords ranks higher than one found only in the description. Exact
+ * token matches are weighted twice as high as prefix matches, and matches on
+ * the transliterated ASCII tokens half as high as UTF-8 matches.
+ *
+ * All the terms are evaluated in a single pass over the search tokens.
+ *
+ * Returns: a match score, where 0 is no match and larger numbers are better
+ * matches.
+ *
+ * Since: 0.5.0
+ */
+guint
+as_app_search_matches_ranked (AsApp *app, gchar **search)
+{
+	AsAppPrivate *priv = GET_PRIVATE (app);
+	AsAppTokenItem *item;
 	guint i;
+	guint k;
 	guint matches_sum = 0;
-	guint tmp;
+	guint search_len;
+	_cleanup_free_ gsize *search_lens = NULL;
+	_cleanup_free_ guint *scores = NULL;
+
+	/* nothing to do */
+	search_len = g_strv_length (search);
+	if (search_len == 0)
+		return 0;
+
+	/* accumulate the score for each term over every token */
+	search_lens = g_new0 (gsize, search_len);
+	for (k = 0; k < search_len; k++)
+		search_lens[k] = strlen (search[k]);
+	scores = g_new0 (guint, search_len);
+	as_app_token_cache_lock (app);
+	for (i = 0; i < priv->token_cache->len; i++) {
+		item = g_ptr_array_index (priv->token_cache, i);
+		as_app_search_score_tokens (item->values_utf8, search,
+					    search_lens, item->score * 2,
+					    scores);
+		as_app_search_score_tokens (item->values_ascii, search,
+					    search_lens, item->score,
+					    scores);
+	}
+	as_app_token_cache_unlock (app);
 
 	/* do *all* search keywords match */
-	for (i = 0; search[i] != NULL; i++) {
-		tmp = as_app_search_matches (app, search[i]);
-		if (tmp == 0)
+	for (k = 0; k < search_len; k++) {
+		if (scores[k] == 0)
 			return 0;
-		matches_sum += tmp;
+		matches_sum += scores[k];
 	}
 	return matches_sum;
 }
@@ -4281,11 +4882,13 @@ as_app_parse_appdata_unintltoolize_cb (GNode *node, gpointer data)
 }
 
 /**
- * as_app_parse_appdata_file:
+ * as_app_parse_appdata_data:
  **/
 static gboolean
-as_app_parse_appdata_file (AsApp *app,
+as_app_parse_appdata_data (AsApp *app,
 			   const gchar *filename,
+			   const gchar *data,
+			   gsize len,
 			   AsAppParseFlags flags,
 			   GError **error)
 {
@@ -4295,22 +4898,10 @@ as_app_parse_appdata_file (AsApp *app,
 	GNode *node;
 	gboolean seen_application = FALSE;
 	gchar *tmp;
-	gsize len;
 	_cleanup_error_free_ GError *error_local = NULL;
 	_cleanup_free_ AsNodeContext *ctx = NULL;
-	_cleanup_free_ gchar *data = NULL;
 	_cleanup_node_unref_ GNode *root = NULL;
 
-	/* open file */
-	if (!g_file_get_contents (filename, &data, &len, &error_local)) {
-		g_set_error (error,
-			     AS_APP_ERROR,
-			     AS_APP_ERROR_INVALID_TYPE,
-			     "%s could not be read: %s",
-			     filename, error_local->message);
-		return FALSE;
-	}
-
 	/* validate */
 	tmp = g_strstr_len (data, len, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>");
 	if (tmp == NULL)
@@ -4378,28 +4969,15 @@ as_app_parse_appdata_file (AsApp *app,
 }
 
 /**
- * as_app_parse_file:
- * @app: a #AsApp instance.
- * @filename: file to load.
- * @flags: #AsAppParseFlags, e.g. %AS_APP_PARSE_FLAG_USE_HEURISTICS
- * @error: A #GError or %NULL.
- *
- * Parses a desktop or AppData file and populates the application state.
- *
- * Applications that are not suitable for the store will have vetos added.
- *
- * Returns: %TRUE for success
- *
- * Since: 0.1.2
+ * as_app_parse_file_prepare:
  **/
-gboolean
-as_app_parse_file (AsApp *app,
-		   const gchar *filename,
-		   AsAppParseFlags flags,
-		   GError **error)
+static gboolean
+as_app_parse_file_prepare (AsApp *app,
+			   const gchar *filename,
+			   AsAppParseFlags *flags,
+			   GError **error)
 {
 	AsAppPrivate *priv = GET_PRIVATE (app);
-	GPtrArray *vetos;
 
 	/* autodetect */
 	if (priv->source_kind == AS_APP_SOURCE_KIND_UNKNOWN) {
@@ -4417,7 +4995,7 @@ as_app_parse_file (AsApp *app,
 	/* convert <_p> into <p> for easy validation */
 	if (g_str_has_suffix (filename, ".appdata.xml.in") ||
 	    g_str_has_suffix (filename, ".metainfo.xml.in"))
-		flags |= AS_APP_PARSE_FLAG_CONVERT_TRANSLATABLE;
+		*flags |= AS_APP_PARSE_FLAG_CONVERT_TRANSLATABLE;
 
 	/* all untrusted */
 	as_app_set_trust_flags (AS_APP (app),
@@ -4426,16 +5004,55 @@ as_app_parse_file (AsApp *app,
 
 	/* set the source location */
 	as_app_set_source_file (app, filename);
+	return TRUE;
+}
+
+/**
+ * as_app_parse_file_check_vetos:
+ **/
+static gboolean
+as_app_parse_file_check_vetos (AsApp *app,
+			       AsAppParseFlags flags,
+			       GError **error)
+{
+	GPtrArray *vetos;
+
+	/* vetos are errors by default */
+	vetos = as_app_get_vetos (app);
+	if ((flags & AS_APP_PARSE_FLAG_ALLOW_VETO) == 0 && vetos->len > 0) {
+		const gchar *tmp = g_ptr_array_index (vetos, 0);
+		g_set_error_literal (error,
+				     AS_APP_ERROR,
+				     AS_APP_ERROR_INVALID_TYPE,
+				     tmp);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * as_app_parse_data_prepared:
+ **/
+static gboolean
+as_app_parse_data_prepared (AsApp *app,
+			    const gchar *filename,
+			    gchar *data,
+			    gsize data_len,
+			    AsAppParseFlags flags,
+			    GError **error)
+{
+	AsAppPrivate *priv = GET_PRIVATE (app);
 
 	/* parse */
 	switch (priv->source_kind) {
 	case AS_APP_SOURCE_KIND_DESKTOP:
-		if (!as_app_parse_desktop_file (app, filename, flags, error))
+		if (!as_app_parse_desktop_data (app, filename, data, flags, error))
 			return FALSE;
 		break;
 	case AS_APP_SOURCE_KIND_APPDATA:
 	case AS_APP_SOURCE_KIND_METAINFO:
-		if (!as_app_parse_appdata_file (app, filename, flags, error))
+		if (!as_app_parse_appdata_data (app, filename, data, data_len,
+						flags, error))
 			return FALSE;
 		break;
 	case AS_APP_SOURCE_KIND_INF:
@@ -4452,18 +5069,79 @@ as_app_parse_file (AsApp *app,
 		break;
 	}
 
-	/* vetos are errors by default */
-	vetos = as_app_get_vetos (app);
-	if ((flags & AS_APP_PARSE_FLAG_ALLOW_VETO) == 0 && vetos->len > 0) {
-		const gchar *tmp = g_ptr_array_index (vetos, 0);
-		g_set_error_literal (error,
-				     AS_APP_ERROR,
-				     AS_APP_ERROR_INVALID_TYPE,
-				     tmp);
+	return as_app_parse_file_check_vetos (app, flags, error);
+}
+
+/**
+ * as_app_parse_data:
+ * @app: a #AsApp instance.
+ * @filename: the file the data was read from
+ * @data: the file contents, which must be NUL terminated
+ * @data_len: the length of @data
+ * @flags: #AsAppParseFlags, e.g. %AS_APP_PARSE_FLAG_USE_HEURISTICS
+ * @error: A #GError or %NULL.
+ *
+ * Parses a desktop or AppData file that has already been read into
+ * memory, which allows the caller to reuse one buffer for many files.
+ * The contents of @data may be modified.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+as_app_parse_data (AsApp *app,
+		   const gchar *filename,
+		   gchar *data,
+		   gsize data_len,
+		   AsAppParseFlags flags,
+		   GError **error)
+{
+	if (!as_app_parse_file_prepare (app, filename, &flags, error))
 		return FALSE;
-	}
+	return as_app_parse_data_prepared (app, filename, data, data_len,
+					   flags, error);
+}
 
-	return TRUE;
+/**
+ * as_app_parse_file:
+ * @app: a #AsApp instance.
+ * @filename: file to load.
+ * @flags: #AsAppParseFlags, e.g. %AS_APP_PARSE_FLAG_USE_HEURISTICS
+ * @error: A #GError or %NULL.
+ *
+ * Parses a desktop or AppData file and populates the application state.
+ *
+ * Applications that are not suitable for the store will have vetos added.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 0.1.2
+ **/
+gboolean
+as_app_parse_file (AsApp *app,
+		   const gchar *filename,
+		   AsAppParseFlags flags,
+		   GError **error)
+{
+	AsAppPrivate *priv = GET_PRIVATE (app);
+	gsize len = 0;
+	_cleanup_error_free_ GError *error_local = NULL;
+	_cleanup_free_ gchar *data = NULL;
+
+	if (!as_app_parse_file_prepare (app, filename, &flags, error))
+		return FALSE;
+
+	/* the INF parser reads the file itself */
+	if (priv->source_kind != AS_APP_SOURCE_KIND_INF &&
+	    !g_file_get_contents (filename, &data, &len, &error_local)) {
+		g_set_error (error,
+			     AS_APP_ERROR,
+			     AS_APP_ERROR_INVALID_TYPE,
+			     "%s could not be read: %s",
+			     filename, error_local->message);
+		return FALSE;
+	}
+	return as_app_parse_data_prepared (app, filename, data, len,
+					   flags, error);
 }
 
 /**
@@ -258,6 +258,7 @@ const gchar	*as_app_get_project_license	(AsApp		*app);
 const gchar	*as_app_get_metadata_license	(AsApp		*app);
 const gchar	*as_app_get_update_contact	(AsApp		*app);
 const gchar	*as_app_get_source_file		(AsApp		*app);
+const gchar	*as_app_get_content_hash	(AsApp		*app);
 const gchar	*as_app_get_name		(AsApp		*app,
 						 const gchar	*locale);
 const gchar	*as_app_get_comment		(AsApp		*app,
@@ -387,6 +388,8 @@ guint		 as_app_search_matches_all	(AsApp		*app,
 						 gchar		**search);
 guint		 as_app_search_matches		(AsApp		*app,
 						 const gchar	*search);
+guint		 as_app_search_matches_ranked	(AsApp		*app,
+						 gchar		**search);
 gboolean	 as_app_parse_file		(AsApp		*app,
 						 const gchar	*filename,
 						 AsAppParseFlags flags,
@@ -28,6 +28,7 @@
 
 #include "as-image.h"
 #include "as-node-private.h"
+#include "as-yaml.h"
 
 G_BEGIN_DECLS
 
@@ -42,6 +43,8 @@ gboolean	 as_image_node_parse_dep11	(AsImage	*image,
 						 GNode		*node,
 						 AsNodeContext	*ctx,
 						 GError		**error);
+void		 as_image_node_emit_dep11	(AsImage	*image,
+						 AsYamlEmitter	*emitter);
 
 G_END_DECLS
 
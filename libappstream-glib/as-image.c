@@ -445,6 +445,31 @@ as_image_node_parse (AsImage *image, GNode *node,
 	return TRUE;
 }
 
+/**
+ * as_image_node_emit_dep11:
+ * @image: a #AsImage instance.
+ * @emitter: a #AsYamlEmitter.
+ *
+ * Writes the image as a DEP-11 mapping.
+ **/
+void
+as_image_node_emit_dep11 (AsImage *image, AsYamlEmitter *emitter)
+{
+	AsImagePrivate *priv = GET_PRIVATE (image);
+
+	as_yaml_emitter_mapping_start (emitter);
+	if (priv->height > 0) {
+		_cleanup_free_ gchar *tmp = g_strdup_printf ("%u", priv->height);
+		as_yaml_emitter_key_value_plain (emitter, "height", tmp);
+	}
+	as_yaml_emitter_key_value (emitter, "url", priv->url);
+	if (priv->width > 0) {
+		_cleanup_free_ gchar *tmp = g_strdup_printf ("%u", priv->width);
+		as_yaml_emitter_key_value_plain (emitter, "width", tmp);
+	}
+	as_yaml_emitter_mapping_end (emitter);
+}
+
 /**
  * as_image_node_parse_dep11:
  * @image: a #AsImage instance.
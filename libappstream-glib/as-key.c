@@ -0,0 +1,136 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2015 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/**
+ * SECTION:as-key
+ * @short_description: Helper functions to convert key names to enums
+ * @stability: Private
+ *
+ * These functions convert the keys found in DEP-11 documents and desktop
+ * files into an enum, so parsers can dispatch with a switch rather than
+ * a chain of string comparisons.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "as-key.h"
+
+#ifdef HAVE_GPERF
+  /* we need to define this now as gperf just writes a big header file */
+  const struct key_data *as_key_from_gperf (const char *key, guint len);
+  #include "as-key-private.h"
+#else
+typedef struct {
+	const gchar	*name;
+	AsKey		 ekey;
+} AsKeyData;
+
+static const AsKeyData as_key_data[] = {
+	{ "File",				AS_KEY_FILE },
+	{ "Origin",				AS_KEY_ORIGIN },
+	{ "Version",				AS_KEY_VERSION },
+	{ "ID",					AS_KEY_ID },
+	{ "Type",				AS_KEY_TYPE },
+	{ "Packages",				AS_KEY_PACKAGES },
+	{ "Name",				AS_KEY_NAME },
+	{ "_Name",				AS_KEY_NAME },
+	{ "Summary",				AS_KEY_SUMMARY },
+	{ "Description",			AS_KEY_DESCRIPTION },
+	{ "Keywords",				AS_KEY_KEYWORDS },
+	{ "Categories",				AS_KEY_CATEGORIES },
+	{ "Icon",				AS_KEY_ICON },
+	{ "Bundle",				AS_KEY_BUNDLE },
+	{ "Url",				AS_KEY_URL },
+	{ "Provides",				AS_KEY_PROVIDES },
+	{ "Screenshots",			AS_KEY_SCREENSHOTS },
+	{ "Comment",				AS_KEY_COMMENT },
+	{ "_Comment",				AS_KEY_COMMENT },
+	{ "GenericName",			AS_KEY_GENERIC_NAME },
+	{ "_GenericName",			AS_KEY_GENERIC_NAME },
+	{ "MimeType",				AS_KEY_MIME_TYPE },
+	{ "NoDisplay",				AS_KEY_NO_DISPLAY },
+	{ "OnlyShowIn",				AS_KEY_ONLY_SHOW_IN },
+	{ "Exec",				AS_KEY_EXEC },
+	{ "X-AppInstall-Package",		AS_KEY_X_APP_INSTALL_PACKAGE },
+	{ "X-Ubuntu-Software-Center-Name",	AS_KEY_X_UBUNTU_SOFTWARE_CENTER_NAME },
+	{ "X-GNOME-UsesNotifications",		AS_KEY_X_GNOME_USES_NOTIFICATIONS },
+	{ "X-GNOME-Bugzilla-Bugzilla",		AS_KEY_X_GNOME_BUGZILLA_BUGZILLA },
+	{ "X-MATE-Bugzilla-Product",		AS_KEY_X_MATE_BUGZILLA_PRODUCT },
+	{ "X-KDE-StartupNotify",		AS_KEY_X_KDE_STARTUP_NOTIFY },
+	{ "X-DocPath",				AS_KEY_X_DOC_PATH },
+	{ NULL,					AS_KEY_UNKNOWN }
+};
+#endif
+
+/**
+ * as_key_from_data:
+ * @key: the key name, which does not have to be NUL terminated
+ * @key_len: the length of @key
+ *
+ * Converts the key name to an enumerated value.
+ *
+ * Returns: a %AsKey, or %AS_KEY_UNKNOWN if not known.
+ **/
+AsKey
+as_key_from_data (const gchar *key, gsize key_len)
+{
+#ifdef HAVE_GPERF
+	const struct key_data *ky;
+#else
+	guint i;
+#endif
+
+	/* invalid */
+	if (key == NULL || key_len == 0)
+		return AS_KEY_UNKNOWN;
+
+#ifdef HAVE_GPERF
+	/* use a perfect hash */
+	ky = as_key_from_gperf (key, key_len);
+	if (ky != NULL)
+		return ky->ekey;
+#else
+	for (i = 0; as_key_data[i].name != NULL; i++) {
+		if (strncmp (key, as_key_data[i].name, key_len) == 0 &&
+		    as_key_data[i].name[key_len] == '\0')
+			return as_key_data[i].ekey;
+	}
+#endif
+	return AS_KEY_UNKNOWN;
+}
+
+/**
+ * as_key_from_string:
+ * @key: the key name
+ *
+ * Converts the key name to an enumerated value.
+ *
+ * Returns: a %AsKey, or %AS_KEY_UNKNOWN if not known.
+ **/
+AsKey
+as_key_from_string (const gchar *key)
+{
+	if (key == NULL)
+		return AS_KEY_UNKNOWN;
+	return as_key_from_data (key, strlen (key));
+}
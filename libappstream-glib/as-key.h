@@ -0,0 +1,76 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2015 Richard Hughes <richard@hughsie.com>
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __AS_KEY_H
+#define __AS_KEY_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * AsKey:
+ *
+ * The keys used in DEP-11 documents and desktop files. Keys that have
+ * the same name in both formats share a value.
+ **/
+typedef enum {
+	AS_KEY_UNKNOWN,
+	AS_KEY_FILE,
+	AS_KEY_ORIGIN,
+	AS_KEY_VERSION,
+	AS_KEY_ID,
+	AS_KEY_TYPE,
+	AS_KEY_PACKAGES,
+	AS_KEY_NAME,
+	AS_KEY_SUMMARY,
+	AS_KEY_DESCRIPTION,
+	AS_KEY_KEYWORDS,
+	AS_KEY_CATEGORIES,
+	AS_KEY_ICON,
+	AS_KEY_BUNDLE,
+	AS_KEY_URL,
+	AS_KEY_PROVIDES,
+	AS_KEY_SCREENSHOTS,
+	AS_KEY_COMMENT,
+	AS_KEY_GENERIC_NAME,
+	AS_KEY_MIME_TYPE,
+	AS_KEY_NO_DISPLAY,
+	AS_KEY_ONLY_SHOW_IN,
+	AS_KEY_EXEC,
+	AS_KEY_X_APP_INSTALL_PACKAGE,
+	AS_KEY_X_UBUNTU_SOFTWARE_CENTER_NAME,
+	AS_KEY_X_GNOME_USES_NOTIFICATIONS,
+	AS_KEY_X_GNOME_BUGZILLA_BUGZILLA,
+	AS_KEY_X_MATE_BUGZILLA_PRODUCT,
+	AS_KEY_X_KDE_STARTUP_NOTIFY,
+	AS_KEY_X_DOC_PATH,
+	/*< private >*/
+	AS_KEY_LAST
+} AsKey;
+
+AsKey		 as_key_from_string		(const gchar	*key);
+AsKey		 as_key_from_data		(const gchar	*key,
+						 gsize		 key_len);
+
+G_END_DECLS
+
+#endif /* __AS_KEY_H */
@@ -32,28 +32,65 @@
 
 #include "config.h"
 
+#ifdef HAVE_SYS_INOTIFY_H
+#include <errno.h>
+#include <glib-unix.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 #include "as-cleanup.h"
 #include "as-monitor.h"
 
-
+/* how long to collect events before delivering them */
+#define AS_MONITOR_DELAY_DEFAULT	800	/* ms */
 
 typedef struct _AsMonitorPrivate	AsMonitorPrivate;
 struct _AsMonitorPrivate
 {
 	GPtrArray		*array;		/* of GFileMonitor */
-	GPtrArray		*files;		/* of gchar* */
-	GPtrArray		*queue_add;	/* of gchar* */
-	GPtrArray		*queue_changed;	/* of gchar* */
-	GPtrArray		*queue_temp;	/* of gchar* */
+	GHashTable		*files;		/* of gchar* */
+	GHashTable		*queue_add;	/* of gchar*:sequence */
+	GHashTable		*queue_changed;	/* of gchar*:sequence */
+	GHashTable		*queue_removed;	/* of gchar*:sequence */
+	GHashTable		*queue_temp;	/* of gchar* */
+	guint			 queue_seq;
 	guint			 pending_id;
+	guint			 delay;
+#ifdef HAVE_SYS_INOTIFY_H
+	gint			 inotify_fd;
+	guint			 inotify_id;
+	GHashTable		*watches;	/* of gchar*:AsMonitorWatch */
+	GHashTable		*watches_wd;	/* of wd:AsMonitorWatch */
+	guint32			 move_cookie;
+	gchar			*move_filename;
+	gboolean		 move_watched;
+#endif
 };
 
+#ifdef HAVE_SYS_INOTIFY_H
+/* one kernel watch per directory, shared by all the files in it */
+typedef struct {
+	gint			 wd;
+	gchar			*path;
+	gboolean		 all_files;
+	GHashTable		*names;		/* of gchar* */
+	GHashTable		*dirs;		/* of gchar*, waiting to be created */
+} AsMonitorWatch;
+
+#define AS_MONITOR_INOTIFY_MASK	(IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | \
+				 IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | \
+				 IN_ONLYDIR)
+#endif
+
 G_DEFINE_TYPE_WITH_PRIVATE (AsMonitor, as_monitor, G_TYPE_OBJECT)
 
 enum {
 	SIGNAL_ADDED,
 	SIGNAL_REMOVED,
 	SIGNAL_CHANGED,
+	SIGNAL_BATCH,
 	SIGNAL_LAST
 };
 
@@ -77,6 +114,20 @@ as_monitor_error_quark (void)
 	return quark;
 }
 
+#ifdef HAVE_SYS_INOTIFY_H
+/**
+ * as_monitor_watch_free:
+ **/
+static void
+as_monitor_watch_free (AsMonitorWatch *watch)
+{
+	g_hash_table_unref (watch->names);
+	g_hash_table_unref (watch->dirs);
+	g_free (watch->path);
+	g_slice_free (AsMonitorWatch, watch);
+}
+#endif
+
 /**
  * as_monitor_finalize:
  **/
@@ -89,10 +140,20 @@ as_monitor_finalize (GObject *object)
 	if (priv->pending_id)
 		g_source_remove (priv->pending_id);
 	g_ptr_array_unref (priv->array);
-	g_ptr_array_unref (priv->files);
-	g_ptr_array_unref (priv->queue_add);
-	g_ptr_array_unref (priv->queue_changed);
-	g_ptr_array_unref (priv->queue_temp);
+	g_hash_table_unref (priv->files);
+	g_hash_table_unref (priv->queue_add);
+	g_hash_table_unref (priv->queue_changed);
+	g_hash_table_unref (priv->queue_removed);
+	g_hash_table_unref (priv->queue_temp);
+#ifdef HAVE_SYS_INOTIFY_H
+	if (priv->inotify_id != 0)
+		g_source_remove (priv->inotify_id);
+	if (priv->inotify_fd >= 0)
+		close (priv->inotify_fd);
+	g_hash_table_unref (priv->watches_wd);
+	g_hash_table_unref (priv->watches);
+	g_free (priv->move_filename);
+#endif
 
 	G_OBJECT_CLASS (as_monitor_parent_class)->finalize (object);
 }
@@ -105,10 +166,18 @@ as_monitor_init (AsMonitor *monitor)
 {
 	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
 	priv->array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
-	priv->files = g_ptr_array_new_with_free_func (g_free);
-	priv->queue_add = g_ptr_array_new_with_free_func (g_free);
-	priv->queue_changed = g_ptr_array_new_with_free_func (g_free);
-	priv->queue_temp = g_ptr_array_new_with_free_func (g_free);
+	priv->files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->queue_add = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->queue_changed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->queue_removed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->queue_temp = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->delay = AS_MONITOR_DELAY_DEFAULT;
+#ifdef HAVE_SYS_INOTIFY_H
+	priv->inotify_fd = -1;
+	priv->watches = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+					       (GDestroyNotify) as_monitor_watch_free);
+	priv->watches_wd = g_hash_table_new (g_direct_hash, g_direct_equal);
+#endif
 }
 
 /**
@@ -167,6 +236,27 @@ as_monitor_class_init (AsMonitorClass *klass)
 			      NULL, NULL, g_cclosure_marshal_VOID__STRING,
 			      G_TYPE_NONE, 1, G_TYPE_STRING);
 
+	/**
+	 * AsMonitor::batch:
+	 * @monitor: the #AsMonitor instance that emitted the signal
+	 * @added: the filenames that have been added
+	 * @removed: the filenames that have been removed
+	 * @changed: the filenames that have changed
+	 *
+	 * The ::batch signal is emitted once for all the files that changed
+	 * within the delay set by as_monitor_set_delay(), after the
+	 * individual ::added, ::removed and ::changed signals.
+	 *
+	 * Since: 0.5.0
+	 **/
+	signals [SIGNAL_BATCH] =
+		g_signal_new ("batch",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (AsMonitorClass, batch),
+			      NULL, NULL, NULL,
+			      G_TYPE_NONE, 3,
+			      G_TYPE_STRV, G_TYPE_STRV, G_TYPE_STRV);
+
 	object_class->finalize = as_monitor_finalize;
 }
 
@@ -196,48 +286,53 @@ _g_file_monitor_to_string (GFileMonitorEvent ev)
 }
 
 /**
- * _g_ptr_array_str_find:
- */
-static const gchar *
-_g_ptr_array_str_find (GPtrArray *array, const gchar *fn)
+ * as_monitor_queue_add:
+ **/
+static void
+as_monitor_queue_add (AsMonitor *monitor, GHashTable *queue, const gchar *filename)
 {
-	guint i;
-	const gchar *tmp;
-	for (i = 0; i < array->len; i++) {
-		tmp = g_ptr_array_index (array, i);
-		if (g_strcmp0 (tmp, fn) == 0)
-			return fn;
-	}
-	return NULL;
+	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
+	if (g_hash_table_contains (queue, filename))
+		return;
+	g_hash_table_insert (queue, g_strdup (filename),
+			     GUINT_TO_POINTER (++priv->queue_seq));
 }
 
 /**
- * _g_ptr_array_str_remove:
- */
-static gboolean
-_g_ptr_array_str_remove (GPtrArray *array, const gchar *fn)
+ * as_monitor_queue_sort_cb:
+ **/
+static gint
+as_monitor_queue_sort_cb (gconstpointer a, gconstpointer b, gpointer user_data)
 {
-	guint i;
-	const gchar *tmp;
-	for (i = 0; i < array->len; i++) {
-		tmp = g_ptr_array_index (array, i);
-		if (g_strcmp0 (tmp, fn) == 0) {
-			g_ptr_array_remove_index_fast (array, i);
-			return TRUE;
-		}
-	}
-	return FALSE;
+	GHashTable *queue = (GHashTable *) user_data;
+	guint seq_a = GPOINTER_TO_UINT (g_hash_table_lookup (queue, *((const gchar **) a)));
+	guint seq_b = GPOINTER_TO_UINT (g_hash_table_lookup (queue, *((const gchar **) b)));
+	if (seq_a < seq_b)
+		return -1;
+	if (seq_a > seq_b)
+		return 1;
+	return 0;
 }
 
 /**
- * _g_ptr_array_str_add:
- */
-static void
-_g_ptr_array_str_add (GPtrArray *array, const gchar *fn)
+ * as_monitor_queue_steal:
+ *
+ * Empties the queue, returning the filenames in the order they were added.
+ **/
+static GPtrArray *
+as_monitor_queue_steal (GHashTable *queue)
 {
-	if (_g_ptr_array_str_find (array, fn) != NULL)
-		return;
-	g_ptr_array_add (array, g_strdup (fn));
+	GHashTableIter iter;
+	GPtrArray *array;
+	gpointer key;
+
+	array = g_ptr_array_new_full (g_hash_table_size (queue), g_free);
+	g_hash_table_iter_init (&iter, queue);
+	while (g_hash_table_iter_next (&iter, &key, NULL))
+		g_ptr_array_add (array, key);
+	g_ptr_array_sort_with_data (array, as_monitor_queue_sort_cb, queue);
+	g_hash_table_steal_all (queue);
+	return array;
 }
 
 /**
@@ -249,7 +344,7 @@ as_monitor_emit_added (AsMonitor *monitor, const gchar *filename)
 	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
 	g_debug ("Emit ::added(%s)", filename);
 	g_signal_emit (monitor, signals[SIGNAL_ADDED], 0, filename);
-	_g_ptr_array_str_add (priv->files, filename);
+	g_hash_table_add (priv->files, g_strdup (filename));
 }
 
 /**
@@ -261,7 +356,7 @@ as_monitor_emit_removed (AsMonitor *monitor, const gchar *filename)
 	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
 	g_debug ("Emit ::removed(%s)", filename);
 	g_signal_emit (monitor, signals[SIGNAL_REMOVED], 0, filename);
-	_g_ptr_array_str_remove (priv->files, filename);
+	g_hash_table_remove (priv->files, filename);
 }
 
 /**
@@ -283,6 +378,12 @@ as_monitor_process_pending (AsMonitor *monitor)
 	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
 	guint i;
 	const gchar *tmp;
+	_cleanup_ptrarray_unref_ GPtrArray *queue_add = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *queue_changed = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *queue_removed = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *added = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *changed = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *removed = NULL;
 
 	/* stop the timer */
 	if (priv->pending_id) {
@@ -290,25 +391,54 @@ as_monitor_process_pending (AsMonitor *monitor)
 		priv->pending_id = 0;
 	}
 
+	/* take the queues in case a handler causes more events */
+	queue_removed = as_monitor_queue_steal (priv->queue_removed);
+	queue_changed = as_monitor_queue_steal (priv->queue_changed);
+	queue_add = as_monitor_queue_steal (priv->queue_add);
+	if (queue_removed->len == 0 &&
+	    queue_changed->len == 0 &&
+	    queue_add->len == 0)
+		return;
+
+	/* emit all the pending removed signals */
+	removed = g_ptr_array_new ();
+	for (i = 0; i < queue_removed->len; i++) {
+		tmp = g_ptr_array_index (queue_removed, i);
+		as_monitor_emit_removed (monitor, tmp);
+		g_ptr_array_add (removed, (gpointer) tmp);
+	}
+
 	/* emit all the pending changed signals */
-	for (i = 0; i < priv->queue_changed->len; i++) {
-		tmp = g_ptr_array_index (priv->queue_changed, i);
+	changed = g_ptr_array_new ();
+	for (i = 0; i < queue_changed->len; i++) {
+		tmp = g_ptr_array_index (queue_changed, i);
 		as_monitor_emit_changed (monitor, tmp);
+		g_ptr_array_add (changed, (gpointer) tmp);
 	}
-	g_ptr_array_set_size (priv->queue_changed, 0);
 
 	/* emit all the pending add signals */
-	for (i = 0; i < priv->queue_add->len; i++) {
-		tmp = g_ptr_array_index (priv->queue_add, i);
+	added = g_ptr_array_new ();
+	for (i = 0; i < queue_add->len; i++) {
+		tmp = g_ptr_array_index (queue_add, i);
 		/* did we atomically replace an existing file */
-		if (_g_ptr_array_str_find (priv->files, tmp) != NULL) {
+		if (g_hash_table_contains (priv->files, tmp)) {
 			g_debug ("detecting atomic replace of existing file");
 			as_monitor_emit_changed (monitor, tmp);
+			g_ptr_array_add (changed, (gpointer) tmp);
 		} else {
 			as_monitor_emit_added (monitor, tmp);
+			g_ptr_array_add (added, (gpointer) tmp);
 		}
 	}
-	g_ptr_array_set_size (priv->queue_add, 0);
+
+	/* and everything at once */
+	g_ptr_array_add (added, NULL);
+	g_ptr_array_add (removed, NULL);
+	g_ptr_array_add (changed, NULL);
+	g_debug ("Emit ::batch(%u, %u, %u)",
+		 added->len - 1, removed->len - 1, changed->len - 1);
+	g_signal_emit (monitor, signals[SIGNAL_BATCH], 0,
+		       added->pdata, removed->pdata, changed->pdata);
 }
 
 /**
@@ -320,100 +450,464 @@ as_monitor_process_pending_trigger_cb (gpointer user_data)
 	AsMonitor *monitor = AS_MONITOR (user_data);
 	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
 
-	g_debug ("No CHANGES_DONE_HINT, catching in timeout");
-	as_monitor_process_pending (monitor);
 	priv->pending_id = 0;
+	as_monitor_process_pending (monitor);
 	return FALSE;
 }
 
 /**
  * as_monitor_process_pending_trigger:
+ *
+ * Delivers everything queued once the delay has passed since the first
+ * event, so that a burst of events from one transaction is coalesced
+ * without postponing delivery indefinitely.
  **/
 static void
 as_monitor_process_pending_trigger (AsMonitor *monitor)
 {
 	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
 	if (priv->pending_id)
-		g_source_remove (priv->pending_id);
-	priv->pending_id = g_timeout_add (800,
+		return;
+	if (priv->delay == 0) {
+		priv->pending_id = g_idle_add (as_monitor_process_pending_trigger_cb,
+					       monitor);
+		return;
+	}
+	priv->pending_id = g_timeout_add (priv->delay,
 					  as_monitor_process_pending_trigger_cb,
 					  monitor);
 }
 
 /**
- * as_monitor_file_changed_cb:
+ * as_monitor_queue_removed:
+ **/
+static void
+as_monitor_queue_removed (AsMonitor *monitor, const gchar *filename)
+{
+	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
+
+	/* created and removed again before anybody was told */
+	g_hash_table_remove (priv->queue_changed, filename);
+	if (g_hash_table_remove (priv->queue_add, filename) &&
+	    !g_hash_table_contains (priv->files, filename))
+		return;
+	as_monitor_queue_add (monitor, priv->queue_removed, filename);
+}
+
+/**
+ * as_monitor_process_event:
  *
  * touch newfile      -> CREATED+CHANGED+ATTRIBUTE_CHANGED+CHANGES_DONE_HINT
  *                       or, just CREATED
  * touch newfile      -> ATTRIBUTE_CHANGED+CHANGES_DONE_HINT
  * echo "1" > newfile -> CHANGED+CHANGES_DONE_HINT
  * rm newfile         -> DELETED
+ *
+ * All events are queued and delivered together by the pending timer.
  **/
 static void
-as_monitor_file_changed_cb (GFileMonitor *mon,
-				 GFile *file, GFile *other_file,
-				 GFileMonitorEvent event_type,
-				 AsMonitor *monitor)
+as_monitor_process_event (AsMonitor *monitor,
+			  GFileMonitorEvent event_type,
+			  const gchar *filename,
+			  const gchar *filename_other)
 {
 	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
-	const gchar *tmp;
 	gboolean is_temp;
-	_cleanup_free_ gchar *filename = NULL;
-	_cleanup_free_ gchar *filename_other = NULL;
 
-	/* get both filenames */
-	filename = g_file_get_path (file);
 	is_temp = !g_file_test (filename, G_FILE_TEST_EXISTS);
-	if (other_file != NULL)
-		filename_other = g_file_get_path (other_file);
 	g_debug ("modified: %s %s [%i]", filename,
 		_g_file_monitor_to_string (event_type), is_temp);
 
 	switch (event_type) {
 	case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
-		as_monitor_process_pending (monitor);
+		as_monitor_process_pending_trigger (monitor);
 		break;
 	case G_FILE_MONITOR_EVENT_CREATED:
 		if (!is_temp) {
-			_g_ptr_array_str_add (priv->queue_add, filename);
+			/* removed and created again is reported as changed */
+			g_hash_table_remove (priv->queue_removed, filename);
+			as_monitor_queue_add (monitor, priv->queue_add, filename);
 		} else {
-			_g_ptr_array_str_add (priv->queue_temp, filename);
+			g_hash_table_add (priv->queue_temp, g_strdup (filename));
 		}
 		/* file monitors do not send CHANGES_DONE_HINT */
 		as_monitor_process_pending_trigger (monitor);
 		break;
 	case G_FILE_MONITOR_EVENT_DELETED:
-		as_monitor_emit_removed (monitor, filename);
+		/* a temp file that was never renamed */
+		if (g_hash_table_remove (priv->queue_temp, filename))
+			break;
+		as_monitor_queue_removed (monitor, filename);
+		as_monitor_process_pending_trigger (monitor);
 		break;
 	case G_FILE_MONITOR_EVENT_CHANGED:
 		/* if the file is not pending and not a temp file, add */
-		if (_g_ptr_array_str_find (priv->queue_add, filename) == NULL &&
-		    _g_ptr_array_str_find (priv->queue_temp, filename) == NULL) {
-			_g_ptr_array_str_add (priv->queue_changed, filename);
+		if (!g_hash_table_contains (priv->queue_add, filename) &&
+		    !g_hash_table_contains (priv->queue_temp, filename)) {
+			as_monitor_queue_add (monitor, priv->queue_changed, filename);
+			as_monitor_process_pending_trigger (monitor);
 		}
 		break;
 	case G_FILE_MONITOR_EVENT_MOVED:
 		/* a temp file that was just created and atomically
 		 * renamed to its final destination */
-		tmp = _g_ptr_array_str_find (priv->queue_temp, filename);
-		if (tmp != NULL) {
+		if (g_hash_table_remove (priv->queue_temp, filename)) {
 			g_debug ("detected atomic save, adding %s", filename_other);
-			g_ptr_array_remove_fast (priv->queue_temp, (gpointer) tmp);
-			if (_g_ptr_array_str_find (priv->files, filename_other) != NULL)
-				as_monitor_emit_changed (monitor, filename_other);
-			else
-				as_monitor_emit_added (monitor, filename_other);
 		} else {
 			g_debug ("detected rename, treating it as remove->add");
-			as_monitor_emit_removed (monitor, filename);
-			as_monitor_emit_added (monitor, filename_other);
+			as_monitor_queue_removed (monitor, filename);
 		}
+		g_hash_table_remove (priv->queue_removed, filename_other);
+		as_monitor_queue_add (monitor, priv->queue_add, filename_other);
+		as_monitor_process_pending_trigger (monitor);
 		break;
 	default:
 		break;
 	}
 }
 
+/**
+ * as_monitor_file_changed_cb:
+ **/
+static void
+as_monitor_file_changed_cb (GFileMonitor *mon,
+			    GFile *file, GFile *other_file,
+			    GFileMonitorEvent event_type,
+			    AsMonitor *monitor)
+{
+	_cleanup_free_ gchar *filename = NULL;
+	_cleanup_free_ gchar *filename_other = NULL;
+
+	/* get both filenames */
+	filename = g_file_get_path (file);
+	if (other_file != NULL)
+		filename_other = g_file_get_path (other_file);
+	as_monitor_process_event (monitor, event_type, filename, filename_other);
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+/**
+ * as_monitor_inotify_move_flush:
+ *
+ * A file moved out of the watched directories is treated as deleted.
+ **/
+static void
+as_monitor_inotify_move_flush (AsMonitor *monitor)
+{
+	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
+	_cleanup_free_ gchar *filename = NULL;
+
+	if (priv->move_filename == NULL)
+		return;
+	filename = priv->move_filename;
+	priv->move_filename = NULL;
+	if (priv->move_watched) {
+		as_monitor_process_event (monitor, G_FILE_MONITOR_EVENT_DELETED,
+					  filename, NULL);
+	}
+}
+
+/**
+ * as_monitor_inotify_watch_new:
+ **/
+static AsMonitorWatch *
+as_monitor_inotify_watch_new (AsMonitor *monitor, const gchar *path)
+{
+	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
+	AsMonitorWatch *watch;
+
+	watch = g_slice_new0 (AsMonitorWatch);
+	watch->wd = -1;
+	watch->path = g_strdup (path);
+	watch->names = g_hash_table_new_full (g_str_hash, g_str_equal,
+					      g_free, NULL);
+	watch->dirs = g_hash_table_new_full (g_str_hash, g_str_equal,
+					     g_free, NULL);
+	g_hash_table_insert (priv->watches, watch->path, watch);
+	return watch;
+}
+
+/**
+ * as_monitor_inotify_arm:
+ *
+ * Creates the kernel watch for the directory.
+ **/
+static gboolean
+as_monitor_inotify_arm (AsMonitor *monitor, AsMonitorWatch *watch)
+{
+	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
+	gint wd;
+
+	wd = inotify_add_watch (priv->inotify_fd, watch->path,
+				AS_MONITOR_INOTIFY_MASK);
+	if (wd < 0) {
+		g_debug ("failed to watch %s: %s", watch->path, strerror (errno));
+		return FALSE;
+	}
+	watch->wd = wd;
+	g_hash_table_insert (priv->watches_wd, GINT_TO_POINTER (wd), watch);
+	return TRUE;
+}
+
+static void as_monitor_inotify_rearm (AsMonitor *monitor,
+				      AsMonitorWatch *parent,
+				      const gchar *name);
+
+/**
+ * as_monitor_inotify_wait_for:
+ *
+ * Watches the parent of a directory that does not exist (any more) so that
+ * the watch can be created again when the directory comes back. The parent
+ * may itself be missing, in which case its parent is watched instead.
+ **/
+static void
+as_monitor_inotify_wait_for (AsMonitor *monitor, AsMonitorWatch *watch)
+{
+	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
+	AsMonitorWatch *parent;
+	_cleanup_free_ gchar *basename = NULL;
+	_cleanup_free_ gchar *dirname = NULL;
+
+	/* nothing above the root */
+	dirname = g_path_get_dirname (watch->path);
+	if (g_strcmp0 (dirname, watch->path) == 0)
+		return;
+
+	parent = g_hash_table_lookup (priv->watches, dirname);
+	if (parent == NULL) {
+		parent = as_monitor_inotify_watch_new (monitor, dirname);
+		if (!as_monitor_inotify_arm (monitor, parent))
+			as_monitor_inotify_wait_for (monitor, parent);
+	}
+	basename = g_path_get_basename (watch->path);
+	g_hash_table_add (parent->dirs, g_strdup (basename));
+
+	/* it may have been created again before the parent was watched */
+	if (parent->wd >= 0 && g_file_test (watch->path, G_FILE_TEST_IS_DIR))
+		as_monitor_inotify_rearm (monitor, parent, basename);
+}
+
+/**
+ * as_monitor_inotify_rearm:
+ *
+ * Watches a directory again now it has been created, and reports any of
+ * the watched files that were created before the kernel watch was.
+ **/
+static void
+as_monitor_inotify_rearm (AsMonitor *monitor,
+			  AsMonitorWatch *parent,
+			  const gchar *name)
+{
+	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
+	AsMonitorWatch *watch;
+	const gchar *tmp;
+	_cleanup_dir_close_ GDir *dir = NULL;
+	_cleanup_free_ gchar *path = NULL;
+
+	path = g_build_filename (parent->path, name, NULL);
+	g_hash_table_remove (parent->dirs, name);
+	watch = g_hash_table_lookup (priv->watches, path);
+	if (watch == NULL || watch->wd >= 0)
+		return;
+	if (!as_monitor_inotify_arm (monitor, watch)) {
+		/* try again the next time it is created */
+		g_hash_table_add (parent->dirs, g_strdup (name));
+		return;
+	}
+	g_debug ("watching %s again", path);
+
+	dir = g_dir_open (path, 0, NULL);
+	if (dir == NULL)
+		return;
+	while ((tmp = g_dir_read_name (dir)) != NULL) {
+		_cleanup_free_ gchar *fn = g_build_filename (path, tmp, NULL);
+		if (g_hash_table_contains (watch->dirs, tmp)) {
+			as_monitor_inotify_rearm (monitor, watch, tmp);
+			continue;
+		}
+		if (!watch->all_files && !g_hash_table_contains (watch->names, tmp))
+			continue;
+		as_monitor_process_event (monitor, G_FILE_MONITOR_EVENT_CREATED,
+					  fn, NULL);
+	}
+}
+
+/**
+ * as_monitor_inotify_event:
+ **/
+static void
+as_monitor_inotify_event (AsMonitor *monitor, const struct inotify_event *ev)
+{
+	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
+	AsMonitorWatch *watch;
+	gboolean watched;
+	_cleanup_free_ gchar *filename = NULL;
+
+	/* the kernel dropped events; nothing sensible can be done */
+	if (ev->mask & IN_Q_OVERFLOW) {
+		g_warning ("inotify queue overflowed, events were lost");
+		return;
+	}
+
+	watch = g_hash_table_lookup (priv->watches_wd, GINT_TO_POINTER (ev->wd));
+	if (watch == NULL)
+		return;
+
+	/* the directory was deleted or unmounted */
+	if (ev->mask & IN_IGNORED) {
+		g_debug ("%s went away, waiting for it to come back", watch->path);
+		g_hash_table_remove (priv->watches_wd, GINT_TO_POINTER (ev->wd));
+		watch->wd = -1;
+		as_monitor_inotify_wait_for (monitor, watch);
+		return;
+	}
+
+	/* a directory we were waiting for was created */
+	if (ev->len > 0 && (ev->mask & IN_ISDIR) != 0 &&
+	    (ev->mask & (IN_CREATE | IN_MOVED_TO)) != 0 &&
+	    g_hash_table_contains (watch->dirs, ev->name)) {
+		as_monitor_inotify_rearm (monitor, watch, ev->name);
+		return;
+	}
+
+	/* only events on the files inside the directory are interesting */
+	if (ev->len == 0 || (ev->mask & IN_ISDIR) != 0)
+		return;
+	filename = g_build_filename (watch->path, ev->name, NULL);
+	watched = watch->all_files || g_hash_table_contains (watch->names, ev->name);
+
+	/* the second half of a rename */
+	if (ev->mask & IN_MOVED_TO) {
+		if (priv->move_filename != NULL && priv->move_cookie == ev->cookie) {
+			_cleanup_free_ gchar *filename_old = priv->move_filename;
+			gboolean watched_old = priv->move_watched;
+			priv->move_filename = NULL;
+			if (watched_old && watched) {
+				as_monitor_process_event (monitor,
+							  G_FILE_MONITOR_EVENT_MOVED,
+							  filename_old, filename);
+			} else if (watched_old) {
+				as_monitor_process_event (monitor,
+							  G_FILE_MONITOR_EVENT_DELETED,
+							  filename_old, NULL);
+			} else if (watched) {
+				as_monitor_process_event (monitor,
+							  G_FILE_MONITOR_EVENT_CREATED,
+							  filename, NULL);
+			}
+			return;
+		}
+		as_monitor_inotify_move_flush (monitor);
+		if (watched) {
+			as_monitor_process_event (monitor,
+						  G_FILE_MONITOR_EVENT_CREATED,
+						  filename, NULL);
+		}
+		return;
+	}
+
+	/* the first half of a rename, wait for the other */
+	as_monitor_inotify_move_flush (monitor);
+	if (ev->mask & IN_MOVED_FROM) {
+		priv->move_cookie = ev->cookie;
+		priv->move_filename = g_strdup (filename);
+		priv->move_watched = watched;
+		return;
+	}
+	if (!watched)
+		return;
+
+	if (ev->mask & IN_CREATE) {
+		as_monitor_process_event (monitor, G_FILE_MONITOR_EVENT_CREATED,
+					  filename, NULL);
+	}
+	if (ev->mask & IN_MODIFY) {
+		as_monitor_process_event (monitor, G_FILE_MONITOR_EVENT_CHANGED,
+					  filename, NULL);
+	}
+	if (ev->mask & IN_CLOSE_WRITE) {
+		as_monitor_process_event (monitor, G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT,
+					  filename, NULL);
+	}
+	if (ev->mask & IN_DELETE) {
+		as_monitor_process_event (monitor, G_FILE_MONITOR_EVENT_DELETED,
+					  filename, NULL);
+	}
+}
+
+/**
+ * as_monitor_inotify_cb:
+ **/
+static gboolean
+as_monitor_inotify_cb (gint fd, GIOCondition condition, gpointer user_data)
+{
+	AsMonitor *monitor = AS_MONITOR (user_data);
+	gchar buf[4096] __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+	const struct inotify_event *ev;
+	gssize len;
+	gssize off;
+
+	while ((len = read (fd, buf, sizeof (buf))) > 0) {
+		off = 0;
+		while (off < len) {
+			ev = (const struct inotify_event *) (buf + off);
+			as_monitor_inotify_event (monitor, ev);
+			off += sizeof (struct inotify_event) + ev->len;
+		}
+	}
+
+	/* the kernel queues both halves of a rename together */
+	as_monitor_inotify_move_flush (monitor);
+	return TRUE;
+}
+
+/**
+ * as_monitor_inotify_add:
+ * @monitor: an #AsMonitor
+ * @dirname: a directory name
+ * @basename: a filename in @dirname, or %NULL for all files
+ *
+ * Watches the directory containing the file, sharing the kernel watch
+ * with any other file in the same directory.
+ *
+ * Returns: %FALSE if a #GFileMonitor should be used instead
+ **/
+static gboolean
+as_monitor_inotify_add (AsMonitor *monitor,
+			const gchar *dirname,
+			const gchar *basename)
+{
+	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
+	AsMonitorWatch *watch;
+
+	/* set up on first use */
+	if (priv->inotify_fd < 0) {
+		priv->inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+		if (priv->inotify_fd < 0) {
+			g_debug ("failed to use inotify: %s", strerror (errno));
+			return FALSE;
+		}
+		priv->inotify_id = g_unix_fd_add (priv->inotify_fd, G_IO_IN,
+						  as_monitor_inotify_cb, monitor);
+	}
+
+	/* create the kernel watch, or reuse the existing one */
+	watch = g_hash_table_lookup (priv->watches, dirname);
+	if (watch == NULL) {
+		watch = as_monitor_inotify_watch_new (monitor, dirname);
+		if (!as_monitor_inotify_arm (monitor, watch)) {
+			g_hash_table_remove (priv->watches, dirname);
+			return FALSE;
+		}
+	}
+	if (basename == NULL)
+		watch->all_files = TRUE;
+	else
+		g_hash_table_add (watch->names, g_strdup (basename));
+	return TRUE;
+}
+#endif
+
 /**
  * as_monitor_add_directory:
  * @monitor: an #AsMonitor
@@ -447,9 +941,15 @@ as_monitor_add_directory (AsMonitor *monitor,
 		_cleanup_free_ gchar *fn = NULL;
 		fn = g_build_filename (filename, tmp, NULL);
 		g_debug ("adding existing file: %s", fn);
-		_g_ptr_array_str_add (priv->files, fn);
+		g_hash_table_add (priv->files, g_strdup (fn));
 	}
 
+#ifdef HAVE_SYS_INOTIFY_H
+	/* one kernel watch for the directory */
+	if (as_monitor_inotify_add (monitor, filename, NULL))
+		return TRUE;
+#endif
+
 	/* create new file monitor */
 	file = g_file_new_for_path (filename);
 	mon = g_file_monitor_directory (file, G_FILE_MONITOR_SEND_MOVED,
@@ -463,6 +963,44 @@ as_monitor_add_directory (AsMonitor *monitor,
 	return TRUE;
 }
 
+/**
+ * as_monitor_add_file_watch:
+ **/
+static gboolean
+as_monitor_add_file_watch (AsMonitor *monitor,
+			   const gchar *filename,
+			   GCancellable *cancellable,
+			   GError **error)
+{
+	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
+	_cleanup_object_unref_ GFile *file = NULL;
+	_cleanup_object_unref_ GFileMonitor *mon = NULL;
+
+#ifdef HAVE_SYS_INOTIFY_H
+	{
+		_cleanup_free_ gchar *dirname = NULL;
+		_cleanup_free_ gchar *basename = NULL;
+
+		/* share the kernel watch on the parent directory */
+		dirname = g_path_get_dirname (filename);
+		basename = g_path_get_basename (filename);
+		if (as_monitor_inotify_add (monitor, dirname, basename))
+			return TRUE;
+	}
+#endif
+
+	/* create new file monitor */
+	file = g_file_new_for_path (filename);
+	mon = g_file_monitor_file (file, G_FILE_MONITOR_NONE,
+				   cancellable, error);
+	if (mon == NULL)
+		return FALSE;
+	g_signal_connect (mon, "changed",
+			  G_CALLBACK (as_monitor_file_changed_cb), monitor);
+	g_ptr_array_add (priv->array, g_object_ref (mon));
+	return TRUE;
+}
+
 /**
  * as_monitor_add_file:
  * @monitor: an #AsMonitor
@@ -472,6 +1010,9 @@ as_monitor_add_directory (AsMonitor *monitor,
  *
  * Adds a file to the watch list.
  *
+ * On Linux the directory containing the file is watched rather than the
+ * file itself, so that many files in one directory use one kernel watch.
+ *
  * Returns: %TRUE for success
  *
  * Since: 0.5.0
@@ -483,30 +1024,57 @@ as_monitor_add_file (AsMonitor *monitor,
 		     GError **error)
 {
 	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
-	_cleanup_object_unref_ GFile *file = NULL;
-	_cleanup_object_unref_ GFileMonitor *mon = NULL;
 
 	/* already watched */
-	if (_g_ptr_array_str_find (priv->files, filename) != NULL)
+	if (g_hash_table_contains (priv->files, filename))
 		return TRUE;
 
-	/* create new file monitor */
-	file = g_file_new_for_path (filename);
-	mon = g_file_monitor_file (file, G_FILE_MONITOR_NONE,
-				   cancellable, error);
-	if (mon == NULL)
+	/* create new watch */
+	if (!as_monitor_add_file_watch (monitor, filename, cancellable, error))
 		return FALSE;
-	g_signal_connect (mon, "changed",
-			  G_CALLBACK (as_monitor_file_changed_cb), monitor);
-	g_ptr_array_add (priv->array, g_object_ref (mon));
 
 	/* only add if actually exists */
 	if (g_file_test (filename, G_FILE_TEST_EXISTS))
-		_g_ptr_array_str_add (priv->files, filename);
+		g_hash_table_add (priv->files, g_strdup (filename));
 
 	return TRUE;
 }
 
+/**
+ * as_monitor_get_delay:
+ * @monitor: an #AsMonitor
+ *
+ * Gets the time events are collected for before being delivered.
+ *
+ * Returns: the delay in ms
+ *
+ * Since: 0.5.0
+ **/
+guint
+as_monitor_get_delay (AsMonitor *monitor)
+{
+	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
+	return priv->delay;
+}
+
+/**
+ * as_monitor_set_delay:
+ * @monitor: an #AsMonitor
+ * @delay: a delay in ms, or 0 to deliver when idle
+ *
+ * Sets the time events are collected for after the first one, before
+ * they are all delivered together. Larger values mean more files from
+ * one package transaction are reported in a single ::batch signal.
+ *
+ * Since: 0.5.0
+ **/
+void
+as_monitor_set_delay (AsMonitor *monitor, guint delay)
+{
+	AsMonitorPrivate *priv = GET_PRIVATE (monitor);
+	priv->delay = delay;
+}
+
 /**
  * as_monitor_new:
  *
@@ -55,8 +55,11 @@ struct _AsMonitorClass
 						 const gchar	*filename);
 	void			(*changed)	(AsMonitor	*monitor,
 						 const gchar	*filename);
+	void			(*batch)	(AsMonitor	*monitor,
+						 gchar		**added,
+						 gchar		**removed,
+						 gchar		**changed);
 	/*< private >*/
-	void (*_as_reserved1)	(void);
 	void (*_as_reserved2)	(void);
 	void (*_as_reserved3)	(void);
 	void (*_as_reserved4)	(void);
@@ -91,6 +94,9 @@ gboolean	 as_monitor_add_file		(AsMonitor	*monitor,
 						 const gchar	*filename,
 						 GCancellable	*cancellable,
 						 GError		**error);
+guint		 as_monitor_get_delay		(AsMonitor	*monitor);
+void		 as_monitor_set_delay		(AsMonitor	*monitor,
+						 guint		 delay);
 
 G_END_DECLS
 
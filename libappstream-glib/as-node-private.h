@@ -44,10 +44,14 @@ void		 as_node_context_set_output	(AsNodeContext	*ctx,
 						 AsAppSourceKind output);
 
 gchar		*as_node_take_data		(const GNode	*node);
+gchar		*as_node_get_checksum		(const GNode	*node);
 gchar		*as_node_take_attribute		(const GNode	*node,
 						 const gchar	*key);
 gchar		*as_node_reflow_text		(const gchar	*text,
 						 gssize		 text_len);
+void		 as_node_reflow_text_append	(GString	*str,
+						 const gchar	*text,
+						 gssize		 text_len);
 
 G_END_DECLS
 
@@ -37,6 +37,10 @@
 #include <glib.h>
 #include <string.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "as-cleanup.h"
 #include "as-node-private.h"
 #include "as-utils-private.h"
@@ -180,46 +184,120 @@ as_node_error_quark (void)
 }
 
 /**
- * as_node_string_replace:
+ * as_node_skip_whitespace:
+ *
+ * Returns the first character in @text that is not ASCII whitespace, or
+ * @end if there is none. This is called for every text node, most of
+ * which are only the indentation between two elements, so whole blocks
+ * of 16 bytes are checked at a time where SSE2 is available.
+ **/
+static const gchar *
+as_node_skip_whitespace (const gchar *text, const gchar *end)
+{
+#ifdef __SSE2__
+	const __m128i sp = _mm_set1_epi8 (' ');
+	const __m128i lo = _mm_set1_epi8 ('\t' - 1);
+	const __m128i hi = _mm_set1_epi8 ('\r' + 1);
+
+	while (end - text >= 16) {
+		__m128i chunk = _mm_loadu_si128 ((const __m128i *) text);
+		__m128i ws;
+		guint mask;
+
+		/* ' ' or '\t' to '\r', as for g_ascii_isspace() */
+		ws = _mm_or_si128 (_mm_cmpeq_epi8 (chunk, sp),
+				   _mm_and_si128 (_mm_cmpgt_epi8 (chunk, lo),
+						  _mm_cmplt_epi8 (chunk, hi)));
+		mask = (guint) _mm_movemask_epi8 (ws);
+		if (mask != 0xffff)
+			return text + g_bit_nth_lsf (~mask, -1);
+		text += 16;
+	}
+#endif
+	while (text < end && g_ascii_isspace (*text))
+		text++;
+	return text;
+}
+
+/**
+ * as_node_unescape_inplace:
+ *
+ * Converts &amp;, &lt; and &gt; back into the raw characters in a single
+ * pass, copying the text between entities in blocks.
  **/
 static void
-as_node_string_replace (GString *string, const gchar *search, const gchar *replace)
+as_node_unescape_inplace (gchar *text)
 {
-	_cleanup_free_ gchar *tmp = NULL;
-	_cleanup_strv_free_ gchar **split = NULL;
+	const gchar *next;
+	const gchar *src;
+	gchar *dst;
+	gsize len;
 
-	/* quick search */
-	if (g_strstr_len (string->str, -1, search) == NULL)
+	dst = strchr (text, '&');
+	if (dst == NULL)
 		return;
+	src = dst;
+	while (*src != '\0') {
+		if (strncmp (src, "&amp;", 5) == 0) {
+			*dst++ = '&';
+			src += 5;
+			continue;
+		}
+		if (strncmp (src, "&lt;", 4) == 0) {
+			*dst++ = '<';
+			src += 4;
+			continue;
+		}
+		if (strncmp (src, "&gt;", 4) == 0) {
+			*dst++ = '>';
+			src += 4;
+			continue;
+		}
 
-	/* replace */
-	split = g_strsplit (string->str, search, -1);
-	tmp = g_strjoinv (replace, split);
-	g_string_assign (string, tmp);
+		/* copy up to the next entity */
+		next = strchr (src + 1, '&');
+		len = next != NULL ? (gsize) (next - src) : strlen (src);
+		memmove (dst, src, len);
+		dst += len;
+		src += len;
+	}
+	*dst = '\0';
 }
 
 /**
- * as_node_string_replace_inplace:
+ * as_node_escape_text:
+ *
+ * Escapes '&', '<' and '>' in a single pass.
  **/
-static void
-as_node_string_replace_inplace (gchar *text,
-				const gchar *search,
-				gchar replace)
+static gchar *
+as_node_escape_text (const gchar *text)
 {
-	const gchar *start = text;
-	gchar *tmp;
+	GString *str;
 	gsize len;
-	gsize len_escaped = 0;
-
-	while ((tmp = g_strstr_len (start, -1, search)) != NULL) {
-		*tmp = replace;
-		len = strlen (tmp);
-		if (len_escaped == 0)
-			len_escaped = strlen (search);
-		memcpy (tmp + 1,
-			tmp + len_escaped,
-			(len - len_escaped) + 1);
-		start = tmp + 1;
+
+	/* nothing to escape */
+	len = strcspn (text, "&<>");
+	if (text[len] == '\0')
+		return g_strdup (text);
+
+	str = g_string_sized_new (strlen (text) + 16);
+	for (;;) {
+		g_string_append_len (str, text, len);
+		text += len;
+		switch (*text) {
+		case '&':
+			g_string_append (str, "&amp;");
+			break;
+		case '<':
+			g_string_append (str, "&lt;");
+			break;
+		case '>':
+			g_string_append (str, "&gt;");
+			break;
+		default:
+			return g_string_free (str, FALSE);
+		}
+		len = strcspn (++text, "&<>");
 	}
 }
 
@@ -231,9 +309,7 @@ as_node_cdata_to_raw (AsNodeData *data)
 {
 	if (!data->cdata_escaped)
 		return;
-	as_node_string_replace_inplace (data->cdata, "&amp;", '&');
-	as_node_string_replace_inplace (data->cdata, "&lt;", '<');
-	as_node_string_replace_inplace (data->cdata, "&gt;", '>');
+	as_node_unescape_inplace (data->cdata);
 	data->cdata_escaped = FALSE;
 }
 
@@ -243,15 +319,12 @@ as_node_cdata_to_raw (AsNodeData *data)
 static void
 as_node_cdata_to_escaped (AsNodeData *data)
 {
-	GString *str;
+	gchar *tmp;
 	if (data->cdata_escaped)
 		return;
-	str = g_string_new (data->cdata);
+	tmp = as_node_escape_text (data->cdata);
 	g_free (data->cdata);
-	as_node_string_replace (str, "&", "&amp;");
-	as_node_string_replace (str, "<", "&lt;");
-	as_node_string_replace (str, ">", "&gt;");
-	data->cdata = g_string_free (str, FALSE);
+	data->cdata = tmp;
 	data->cdata_escaped = TRUE;
 }
 
@@ -435,58 +508,83 @@ as_node_to_xml_string (GString *xml,
 }
 
 /**
- * as_node_reflow_text:
+ * as_node_reflow_text_append:
+ * @str: a #GString
  * @text: XML text data
- * @text_len: length of @text
+ * @text_len: length of @text, or -1 if NUL terminated
  *
- * Converts pretty-formatted source text into a format suitable for AppStream.
- * This might include joining paragraphs, supressing newlines or doing other
- * sanity checks to the text.
- *
- * Returns: (transfer full): a new string
- *
- * Since: 0.1.4
+ * Reflows @text as as_node_reflow_text() does, but appends the result
+ * to an existing buffer.
  **/
-gchar *
-as_node_reflow_text (const gchar *text, gssize text_len)
+void
+as_node_reflow_text_append (GString *str, const gchar *text, gssize text_len)
 {
-	GString *tmp;
-	guint i;
+	const gchar *end;
+	const gchar *line;
+	const gchar *line_end;
+	const gchar *next;
+	gsize start = str->len;
 	guint newline_count = 0;
-	_cleanup_strv_free_ gchar **split = NULL;
 
-	/* split the text into lines */
-	tmp = g_string_sized_new (text_len + 1);
-	split = g_strsplit (text, "\n", -1);
-	for (i = 0; split[i] != NULL; i++) {
+	/* handle each line in place rather than splitting the text */
+	if (text_len < 0)
+		text_len = strlen (text);
+	end = text + text_len;
+	for (line = text; ; line = next + 1) {
+		next = memchr (line, '\n', end - line);
+		line_end = next != NULL ? next : end;
 
 		/* remove leading and trailing whitespace */
-		g_strstrip (split[i]);
+		line = as_node_skip_whitespace (line, line_end);
+		while (line_end > line && g_ascii_isspace (line_end[-1]))
+			line_end--;
 
 		/* if this is a blank line we end the paragraph mode
 		 * and swallow the newline. If we see exactly two
 		 * newlines in sequence then do a paragraph break */
-		if (split[i][0] == '\0') {
+		if (line == line_end) {
 			newline_count++;
-			continue;
-		}
-
-		/* if the line just before this one was not a newline
-		 * then seporate the words with a space */
-		if (newline_count == 1 && tmp->len > 0)
-			g_string_append (tmp, " ");
+		} else {
+			/* if the line just before this one was not a newline
+			 * then seporate the words with a space */
+			if (newline_count == 1 && str->len > start)
+				g_string_append_c (str, ' ');
 
-		/* if we had more than one newline in sequence add a paragraph
-		 * break */
-		if (newline_count > 1)
-			g_string_append (tmp, "\n\n");
+			/* if we had more than one newline in sequence add a
+			 * paragraph break */
+			if (newline_count > 1)
+				g_string_append (str, "\n\n");
 
-		/* add the actual stripped text */
-		g_string_append (tmp, split[i]);
+			/* add the actual stripped text */
+			g_string_append_len (str, line, line_end - line);
 
-		/* this last section was paragraph */
-		newline_count = 1;
+			/* this last section was paragraph */
+			newline_count = 1;
+		}
+		if (next == NULL)
+			break;
 	}
+}
+
+/**
+ * as_node_reflow_text:
+ * @text: XML text data
+ * @text_len: length of @text
+ *
+ * Converts pretty-formatted source text into a format suitable for AppStream.
+ * This might include joining paragraphs, supressing newlines or doing other
+ * sanity checks to the text.
+ *
+ * Returns: (transfer full): a new string
+ *
+ * Since: 0.1.4
+ **/
+gchar *
+as_node_reflow_text (const gchar *text, gssize text_len)
+{
+	GString *tmp;
+	tmp = g_string_sized_new (text_len + 1);
+	as_node_reflow_text_append (tmp, text, text_len);
 	return g_string_free (tmp, FALSE);
 }
 
@@ -593,18 +691,13 @@ as_node_text_cb (GMarkupParseContext *context,
 {
 	AsNodeToXmlHelper *helper = (AsNodeToXmlHelper *) user_data;
 	AsNodeData *data;
-	guint i;
 
 	/* no data */
 	if (text_len == 0)
 		return;
 
 	/* all whitespace? */
-	for (i = 0; i < text_len; i++) {
-		if (!g_ascii_isspace(text[i]))
-			break;
-	}
-	if (i >= text_len)
+	if (as_node_skip_whitespace (text, text + text_len) == text + text_len)
 		return;
 
 	/* split up into lines and add each with spaces stripped */
@@ -991,6 +1084,68 @@ as_node_get_data (const GNode *node)
 	return data->cdata;
 }
 
+/**
+ * as_node_checksum_update_str:
+ **/
+static void
+as_node_checksum_update_str (GChecksum *csum, const gchar *str)
+{
+	/* include the NUL so that adjacent strings cannot run together */
+	if (str == NULL)
+		str = "";
+	g_checksum_update (csum, (const guchar *) str, strlen (str) + 1);
+}
+
+/**
+ * as_node_checksum_update:
+ **/
+static void
+as_node_checksum_update (GChecksum *csum, const GNode *node)
+{
+	AsNodeAttr *attr;
+	AsNodeData *data = node->data;
+	GList *l;
+	const GNode *c;
+
+	if (data != NULL) {
+		as_node_checksum_update_str (csum, as_tag_data_get_name (data));
+		for (l = data->attrs; l != NULL; l = l->next) {
+			attr = l->data;
+			as_node_checksum_update_str (csum, attr->key);
+			as_node_checksum_update_str (csum, attr->value);
+		}
+		as_node_checksum_update_str (csum, as_node_get_data (node));
+	}
+
+	/* mark where the children start and end */
+	g_checksum_update (csum, (const guchar *) "<", 1);
+	for (c = node->children; c != NULL; c = c->next)
+		as_node_checksum_update (csum, c);
+	g_checksum_update (csum, (const guchar *) ">", 1);
+}
+
+/**
+ * as_node_get_checksum:
+ * @node: a #GNode
+ *
+ * Gets a checksum of the node and everything below it, without writing it
+ * out as XML first. Comments are not included.
+ *
+ * Returns: (transfer full): a SHA1 checksum
+ **/
+gchar *
+as_node_get_checksum (const GNode *node)
+{
+	gchar *tmp;
+	GChecksum *csum;
+
+	csum = g_checksum_new (G_CHECKSUM_SHA1);
+	as_node_checksum_update (csum, node);
+	tmp = g_strdup (g_checksum_get_string (csum));
+	g_checksum_free (csum);
+	return tmp;
+}
+
 /**
  * as_node_get_comment:
  * @node: a #GNode
@@ -113,6 +113,8 @@ as_provide_kind_from_string (const gchar *kind)
 		return AS_PROVIDE_KIND_DBUS;
 	if (g_strcmp0 (kind, "dbus-system") == 0)
 		return AS_PROVIDE_KIND_DBUS_SYSTEM;
+	if (g_strcmp0 (kind, "id") == 0)
+		return AS_PROVIDE_KIND_ID;
 	return AS_PROVIDE_KIND_UNKNOWN;
 }
 
@@ -147,6 +149,8 @@ as_provide_kind_to_string (AsProvideKind kind)
 		return "dbus";
 	if (kind == AS_PROVIDE_KIND_DBUS_SYSTEM)
 		return "dbus-system";
+	if (kind == AS_PROVIDE_KIND_ID)
+		return "id";
 	return NULL;
 }
 
@@ -262,14 +266,37 @@ as_provide_node_insert (AsProvide *provide, GNode *parent, AsNodeContext *ctx)
 	return n;
 }
 
+/**
+ * as_provide_kind_from_dep11_string:
+ **/
+static AsProvideKind
+as_provide_kind_from_dep11_string (const gchar *kind)
+{
+	if (g_strcmp0 (kind, "libraries") == 0)
+		return AS_PROVIDE_KIND_LIBRARY;
+	if (g_strcmp0 (kind, "binaries") == 0)
+		return AS_PROVIDE_KIND_BINARY;
+	if (g_strcmp0 (kind, "modaliases") == 0)
+		return AS_PROVIDE_KIND_MODALIAS;
+	if (g_strcmp0 (kind, "python2") == 0)
+		return AS_PROVIDE_KIND_PYTHON2;
+	if (g_strcmp0 (kind, "python3") == 0)
+		return AS_PROVIDE_KIND_PYTHON3;
+	if (g_strcmp0 (kind, "ids") == 0)
+		return AS_PROVIDE_KIND_ID;
+	return AS_PROVIDE_KIND_UNKNOWN;
+}
+
 /**
  * as_provide_node_parse_dep11:
  * @provide: a #AsProvide instance.
- * @node: a #GNode.
+ * @node: a #GNode for one entry of a DEP-11 provides list.
  * @ctx: a #AsNodeContext.
  * @error: A #GError or %NULL.
  *
- * Populates the object from a DEP-11 node.
+ * Populates the object from a DEP-11 node. The kind is taken from the key
+ * of the list, e.g. "binaries", and is left as %AS_PROVIDE_KIND_UNKNOWN for
+ * lists that are not simple values.
  *
  * Returns: %TRUE for success
  *
@@ -279,6 +306,14 @@ gboolean
 as_provide_node_parse_dep11 (AsProvide *provide, GNode *node,
 			     AsNodeContext *ctx, GError **error)
 {
+	AsProvidePrivate *priv = GET_PRIVATE (provide);
+
+	if (node->parent == NULL)
+		return TRUE;
+	priv->kind = as_provide_kind_from_dep11_string (as_yaml_node_get_key (node->parent));
+	if (priv->kind == AS_PROVIDE_KIND_UNKNOWN)
+		return TRUE;
+	as_provide_set_value (provide, as_yaml_node_get_key (node));
 	return TRUE;
 }
 
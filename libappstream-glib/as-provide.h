@@ -71,6 +71,7 @@ struct _AsProvideClass
  * @AS_PROVIDE_KIND_PYTHON3:		A Python 3 module
  * @AS_PROVIDE_KIND_DBUS:		A D-Bus service
  * @AS_PROVIDE_KIND_DBUS_SYSTEM:	A D-Bus system service
+ * @AS_PROVIDE_KIND_ID:		An ID the component used previously
  *
  * The provide type.
  **/
@@ -85,6 +86,7 @@ typedef enum {
 	AS_PROVIDE_KIND_PYTHON3,
 	AS_PROVIDE_KIND_DBUS,		/* Since: 0.1.7 */
 	AS_PROVIDE_KIND_DBUS_SYSTEM,	/* Since: 0.2.4 */
+	AS_PROVIDE_KIND_ID,		/* Since: 0.5.0 */
 	/*< private >*/
 	AS_PROVIDE_KIND_LAST
 } AsProvideKind;
@@ -31,6 +31,7 @@
 
 G_BEGIN_DECLS
 
+guint		 as_release_get_generation	(void);
 GNode		*as_release_node_insert		(AsRelease	*release,
 						 GNode		*parent,
 						 AsNodeContext	*ctx);
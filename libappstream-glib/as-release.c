@@ -50,6 +50,7 @@ typedef struct _AsReleasePrivate	AsReleasePrivate;
 struct _AsReleasePrivate
 {
 	gchar			*version;
+	GBytes			*version_key;	/* parsed lazily */
 	GHashTable		*descriptions;
 	guint64			 timestamp;
 	GPtrArray		*locations;
@@ -70,6 +71,8 @@ as_release_finalize (GObject *object)
 	AsReleasePrivate *priv = GET_PRIVATE (release);
 
 	g_free (priv->version);
+	if (priv->version_key != NULL)
+		g_bytes_unref (priv->version_key);
 	g_ptr_array_unref (priv->checksums);
 	g_ptr_array_unref (priv->locations);
 	if (priv->descriptions != NULL)
@@ -99,6 +102,53 @@ as_release_class_init (AsReleaseClass *klass)
 	object_class->finalize = as_release_finalize;
 }
 
+/**
+ * as_release_get_version_key:
+ *
+ * The version is only parsed once however many times the release is
+ * compared, for instance when sorting.
+ **/
+static GBytes *
+as_release_get_version_key (AsRelease *release)
+{
+	AsReleasePrivate *priv = GET_PRIVATE (release);
+	if (priv->version_key == NULL)
+		priv->version_key = as_utils_version_key (priv->version);
+	return priv->version_key;
+}
+
+/* bumped whenever any release changes its sort order */
+static volatile gint as_release_generation = 0;
+
+/**
+ * as_release_get_generation:
+ *
+ * Gets a counter that changes each time the version or timestamp of any
+ * release is set, so that callers keeping releases in order know when to
+ * check that order again.
+ *
+ * Returns: a counter value
+ **/
+guint
+as_release_get_generation (void)
+{
+	return (guint) g_atomic_int_get (&as_release_generation);
+}
+
+/**
+ * as_release_set_version_key_invalid:
+ **/
+static void
+as_release_set_version_key_invalid (AsRelease *release)
+{
+	AsReleasePrivate *priv = GET_PRIVATE (release);
+	g_atomic_int_inc (&as_release_generation);
+	if (priv->version_key == NULL)
+		return;
+	g_bytes_unref (priv->version_key);
+	priv->version_key = NULL;
+}
+
 /**
  * as_release_vercmp:
  * @rel1: a #AsRelease instance.
@@ -118,7 +168,8 @@ as_release_vercmp (AsRelease *rel1, AsRelease *rel2)
 	gint val;
 
 	/* prefer the version strings */
-	val = as_utils_vercmp (priv2->version, priv1->version);
+	val = as_utils_vercmp_key (as_release_get_version_key (rel2),
+				   as_release_get_version_key (rel1));
 	if (val != G_MAXINT)
 		return val;
 
@@ -304,6 +355,7 @@ as_release_set_version (AsRelease *release, const gchar *version)
 	AsReleasePrivate *priv = GET_PRIVATE (release);
 	g_free (priv->version);
 	priv->version = g_strdup (version);
+	as_release_set_version_key_invalid (release);
 }
 
 /**
@@ -356,7 +408,10 @@ void
 as_release_set_timestamp (AsRelease *release, guint64 timestamp)
 {
 	AsReleasePrivate *priv = GET_PRIVATE (release);
+	if (priv->timestamp == timestamp)
+		return;
 	priv->timestamp = timestamp;
+	g_atomic_int_inc (&as_release_generation);
 }
 
 /**
@@ -459,6 +514,8 @@ as_release_node_parse (AsRelease *release, GNode *node,
 	AsReleasePrivate *priv = GET_PRIVATE (release);
 	GNode *n;
 	const gchar *tmp;
+	gboolean appstream;
+	gboolean got_description = FALSE;
 	gchar *taken;
 
 	tmp = as_node_get_attribute (node, "timestamp");
@@ -468,53 +525,52 @@ as_release_node_parse (AsRelease *release, GNode *node,
 	if (taken != NULL) {
 		g_free (priv->version);
 		priv->version = taken;
+		as_release_set_version_key_invalid (release);
 	}
+	appstream = as_node_context_get_source_kind (ctx) == AS_APP_SOURCE_KIND_APPSTREAM;
 
-	/* get optional locations */
+	/* parse locations, checksums and descriptions in one pass */
 	g_ptr_array_set_size (priv->locations, 0);
 	for (n = node->children; n != NULL; n = n->next) {
-		if (as_node_get_tag (n) != AS_TAG_LOCATION)
-			continue;
-		g_ptr_array_add (priv->locations, as_node_take_data (n));
-	}
-
-	/* get optional checksums */
-	for (n = node->children; n != NULL; n = n->next) {
-		_cleanup_object_unref_ AsChecksum *csum = NULL;
-		if (as_node_get_tag (n) != AS_TAG_CHECKSUM)
-			continue;
-		csum = as_checksum_new ();
-		if (!as_checksum_node_parse (csum, n, ctx, error))
-			return FALSE;
-		as_release_add_checksum (release, csum);
-	}
-
-	/* AppStream: multiple <description> tags */
-	if (as_node_context_get_source_kind (ctx) == AS_APP_SOURCE_KIND_APPSTREAM) {
-		for (n = node->children; n != NULL; n = n->next) {
-			_cleanup_string_free_ GString *xml = NULL;
-			if (as_node_get_tag (n) != AS_TAG_DESCRIPTION)
-				continue;
-			if (n->children == NULL)
-				continue;
-			xml = as_node_to_xml (n->children,
-					      AS_NODE_TO_XML_FLAG_INCLUDE_SIBLINGS);
-			if (xml == NULL)
-				continue;
-			as_release_set_description (release,
-						    as_node_get_attribute (n, "xml:lang"),
-						    xml->str);
-		}
-
-	/* AppData: mutliple languages encoded in one <description> tag */
-	} else {
-		n = as_node_find (node, "description");
-		if (n != NULL) {
-			if (priv->descriptions != NULL)
-				g_hash_table_unref (priv->descriptions);
-			priv->descriptions = as_node_get_localized_unwrap (n, error);
-			if (priv->descriptions == NULL)
+		switch (as_node_get_tag (n)) {
+		case AS_TAG_LOCATION:
+			g_ptr_array_add (priv->locations, as_node_take_data (n));
+			break;
+		case AS_TAG_CHECKSUM:
+		{
+			_cleanup_object_unref_ AsChecksum *csum = NULL;
+			csum = as_checksum_new ();
+			if (!as_checksum_node_parse (csum, n, ctx, error))
 				return FALSE;
+			as_release_add_checksum (release, csum);
+			break;
+		}
+		case AS_TAG_DESCRIPTION:
+			if (appstream) {
+				/* AppStream: multiple <description> tags */
+				_cleanup_string_free_ GString *xml = NULL;
+				if (n->children == NULL)
+					break;
+				xml = as_node_to_xml (n->children,
+						      AS_NODE_TO_XML_FLAG_INCLUDE_SIBLINGS);
+				if (xml == NULL)
+					break;
+				as_release_set_description (release,
+							    as_node_get_attribute (n, "xml:lang"),
+							    xml->str);
+			} else if (!got_description) {
+				/* AppData: mutliple languages encoded in one
+				 * <description> tag */
+				if (priv->descriptions != NULL)
+					g_hash_table_unref (priv->descriptions);
+				priv->descriptions = as_node_get_localized_unwrap (n, error);
+				if (priv->descriptions == NULL)
+					return FALSE;
+				got_description = TRUE;
+			}
+			break;
+		default:
+			break;
 		}
 	}
 
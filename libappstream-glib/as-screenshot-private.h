@@ -30,6 +30,7 @@
 
 #include "as-screenshot.h"
 #include "as-node-private.h"
+#include "as-yaml.h"
 
 G_BEGIN_DECLS
 
@@ -44,6 +45,8 @@ gboolean	 as_screenshot_node_parse_dep11	(AsScreenshot	*screenshot,
 						 GNode		*node,
 						 AsNodeContext	*ctx,
 						 GError		**error);
+void		 as_screenshot_node_emit_dep11	(AsScreenshot	*screenshot,
+						 AsYamlEmitter	*emitter);
 
 G_END_DECLS
 
@@ -397,12 +397,10 @@ as_screenshot_node_parse (AsScreenshot *screenshot, GNode *node,
 			  AsNodeContext *ctx, GError **error)
 {
 	AsScreenshotPrivate *priv = GET_PRIVATE (screenshot);
-	GList *l;
 	GNode *c;
 	const gchar *tmp;
 	guint size;
 	gint priority;
-	_cleanup_hashtable_unref_ GHashTable *captions = NULL;
 
 	tmp = as_node_get_attribute (node, "type");
 	if (tmp != NULL) {
@@ -413,19 +411,6 @@ as_screenshot_node_parse (AsScreenshot *screenshot, GNode *node,
 	if (priority != G_MAXINT)
 		as_screenshot_set_priority (screenshot, priority);
 
-	/* add captions */
-	captions = as_node_get_localized (node, "caption");
-	if (captions != NULL) {
-		_cleanup_list_free_ GList *keys = NULL;
-		keys = g_hash_table_get_keys (captions);
-		for (l = keys; l != NULL; l = l->next) {
-			tmp = l->data;
-			as_screenshot_set_caption (screenshot,
-						   tmp,
-						   g_hash_table_lookup (captions, tmp));
-		}
-	}
-
 	/* AppData files does not have <image> tags */
 	tmp = as_node_get_data (node);
 	if (tmp != NULL) {
@@ -442,19 +427,92 @@ as_screenshot_node_parse (AsScreenshot *screenshot, GNode *node,
 		g_ptr_array_add (priv->images, image);
 	}
 
-	/* add images */
+	/* add captions and images in one pass */
 	for (c = node->children; c != NULL; c = c->next) {
-		_cleanup_object_unref_ AsImage *image = NULL;
-		if (as_node_get_tag (c) != AS_TAG_IMAGE)
-			continue;
-		image = as_image_new ();
-		if (!as_image_node_parse (image, c, ctx, error))
-			return FALSE;
-		g_ptr_array_add (priv->images, g_object_ref (image));
+		switch (as_node_get_tag (c)) {
+		case AS_TAG_CAPTION:
+			tmp = as_node_get_data (c);
+			if (tmp == NULL)
+				break;
+			as_screenshot_set_caption (screenshot,
+						   as_node_get_attribute (c, "xml:lang"),
+						   tmp);
+			break;
+		case AS_TAG_IMAGE:
+		{
+			_cleanup_object_unref_ AsImage *image = NULL;
+			image = as_image_new ();
+			if (!as_image_node_parse (image, c, ctx, error))
+				return FALSE;
+			g_ptr_array_add (priv->images, g_object_ref (image));
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	/* avoid storing translations identical to the untranslated caption */
+	tmp = g_hash_table_lookup (priv->captions, "C");
+	if (tmp != NULL && g_hash_table_size (priv->captions) > 1) {
+		GHashTableIter iter;
+		gpointer key;
+		gpointer value;
+		g_hash_table_iter_init (&iter, priv->captions);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			if (value == tmp)
+				continue;
+			if (g_strcmp0 (value, tmp) == 0)
+				g_hash_table_iter_remove (&iter);
+		}
 	}
 	return TRUE;
 }
 
+/**
+ * as_screenshot_node_emit_dep11:
+ * @screenshot: a #AsScreenshot instance.
+ * @emitter: a #AsYamlEmitter.
+ *
+ * Writes the screenshot as a DEP-11 mapping.
+ **/
+void
+as_screenshot_node_emit_dep11 (AsScreenshot *screenshot, AsYamlEmitter *emitter)
+{
+	AsScreenshotPrivate *priv = GET_PRIVATE (screenshot);
+	AsImage *im;
+	guint i;
+	gboolean has_thumbnails = FALSE;
+
+	as_yaml_emitter_mapping_start (emitter);
+	as_yaml_emitter_key_value_plain (emitter, "default",
+					 priv->kind == AS_SCREENSHOT_KIND_DEFAULT ?
+					 "true" : "false");
+
+	/* the source image */
+	im = as_screenshot_get_source (screenshot);
+	if (im != NULL) {
+		as_yaml_emitter_scalar (emitter, "source-image");
+		as_image_node_emit_dep11 (im, emitter);
+	}
+
+	/* any thumbnails */
+	for (i = 0; i < priv->images->len; i++) {
+		im = g_ptr_array_index (priv->images, i);
+		if (as_image_get_kind (im) != AS_IMAGE_KIND_THUMBNAIL)
+			continue;
+		if (!has_thumbnails) {
+			as_yaml_emitter_scalar (emitter, "thumbnails");
+			as_yaml_emitter_sequence_start (emitter);
+			has_thumbnails = TRUE;
+		}
+		as_image_node_emit_dep11 (im, emitter);
+	}
+	if (has_thumbnails)
+		as_yaml_emitter_sequence_end (emitter);
+	as_yaml_emitter_mapping_end (emitter);
+}
+
 /**
  * as_screenshot_node_parse_dep11:
  * @screenshot: a #AsScreenshot instance.
@@ -21,9 +21,11 @@
 
 #include "config.h"
 
+#include <fnmatch.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "as-app-private.h"
 #include "as-bundle-private.h"
@@ -33,13 +35,15 @@
 #include "as-icon-private.h"
 #include "as-image-private.h"
 #include "as-inf.h"
+#include "as-key.h"
 #include "as-monitor.h"
 #include "as-node-private.h"
 #include "as-problem.h"
 #include "as-provide-private.h"
 #include "as-release-private.h"
+#include "as-resources.h"
 #include "as-screenshot-private.h"
-#include "as-store.h"
+#include "as-store-private.h"
 #include "as-tag.h"
 #include "as-utils-private.h"
 #include "as-yaml.h"
@@ -234,6 +238,80 @@ as_test_monitor_dir_func (void)
 	g_unlink (tmpfile_new);
 }
 
+static void
+monitor_test_batch_cb (AsMonitor *mon,
+		       gchar **added,
+		       gchar **removed,
+		       gchar **changed,
+		       guint *cnt)
+{
+	cnt[0]++;
+	cnt[1] += g_strv_length (added);
+	cnt[2] += g_strv_length (removed);
+	cnt[3] += g_strv_length (changed);
+	as_test_loop_quit ();
+}
+
+static void
+as_test_monitor_batch_func (void)
+{
+	gboolean ret;
+	guint i;
+	guint cnt[4] = { 0, 0, 0, 0 };
+	guint cnt_added = 0;
+	_cleanup_object_unref_ AsMonitor *mon = NULL;
+	_cleanup_error_free_ GError *error = NULL;
+	const gchar *tmpdir = "/tmp/monitor-test-batch";
+
+	g_mkdir_with_parents (tmpdir, 0700);
+	for (i = 0; i < 20; i++) {
+		_cleanup_free_ gchar *fn = NULL;
+		fn = g_strdup_printf ("%s/file%02u.txt", tmpdir, i);
+		g_unlink (fn);
+	}
+
+	mon = as_monitor_new ();
+	as_monitor_set_delay (mon, 500);
+	g_assert_cmpint (as_monitor_get_delay (mon), ==, 500);
+	g_signal_connect (mon, "added",
+			  G_CALLBACK (monitor_test_cb), &cnt_added);
+	g_signal_connect (mon, "batch",
+			  G_CALLBACK (monitor_test_batch_cb), cnt);
+	ret = as_monitor_add_directory (mon, tmpdir, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* lots of files at once, as a package transaction would */
+	for (i = 0; i < 20; i++) {
+		_cleanup_free_ gchar *fn = NULL;
+		fn = g_strdup_printf ("%s/file%02u.txt", tmpdir, i);
+		ret = g_file_set_contents (fn, "foo", -1, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+	}
+	as_test_loop_run_with_timeout (2000);
+	as_test_loop_quit ();
+	g_assert_cmpint (cnt[0], ==, 1);
+	g_assert_cmpint (cnt[1], ==, 20);
+	g_assert_cmpint (cnt[2], ==, 0);
+	g_assert_cmpint (cnt[3], ==, 0);
+	g_assert_cmpint (cnt_added, ==, 20);
+
+	/* remove them all */
+	memset (cnt, 0, sizeof (cnt));
+	for (i = 0; i < 20; i++) {
+		_cleanup_free_ gchar *fn = NULL;
+		fn = g_strdup_printf ("%s/file%02u.txt", tmpdir, i);
+		g_unlink (fn);
+	}
+	as_test_loop_run_with_timeout (2000);
+	as_test_loop_quit ();
+	g_assert_cmpint (cnt[0], ==, 1);
+	g_assert_cmpint (cnt[1], ==, 0);
+	g_assert_cmpint (cnt[2], ==, 20);
+	g_assert_cmpint (cnt[3], ==, 0);
+}
+
 static void
 as_test_monitor_file_func (void)
 {
@@ -318,6 +396,162 @@ as_test_monitor_file_func (void)
 	g_assert_cmpint (cnt_changed, ==, 1);
 }
 
+static void
+as_test_monitor_dir_recreate_func (void)
+{
+	gboolean ret;
+	guint cnt_added = 0;
+	guint cnt_removed = 0;
+	guint cnt_changed = 0;
+	_cleanup_object_unref_ AsMonitor *mon = NULL;
+	_cleanup_error_free_ GError *error = NULL;
+	const gchar *tmpdir = "/tmp/monitor-test-recreate/xmls";
+	const gchar *tmpfile = "/tmp/monitor-test-recreate/xmls/test.xml";
+
+	g_unlink (tmpfile);
+	g_mkdir_with_parents (tmpdir, 0700);
+
+	mon = as_monitor_new ();
+	as_monitor_set_delay (mon, 0);
+	g_signal_connect (mon, "added",
+			  G_CALLBACK (monitor_test_cb), &cnt_added);
+	g_signal_connect (mon, "removed",
+			  G_CALLBACK (monitor_test_cb), &cnt_removed);
+	g_signal_connect (mon, "changed",
+			  G_CALLBACK (monitor_test_cb), &cnt_changed);
+	ret = as_monitor_add_directory (mon, tmpdir, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* add a file */
+	ret = g_file_set_contents (tmpfile, "foo", -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	as_test_loop_run_with_timeout (500);
+	as_test_loop_quit ();
+	g_assert_cmpint (cnt_added, ==, 1);
+
+	/* remove the whole directory */
+	cnt_added = cnt_removed = cnt_changed = 0;
+	g_unlink (tmpfile);
+	g_rmdir (tmpdir);
+	as_test_loop_run_with_timeout (500);
+	as_test_loop_quit ();
+	g_assert_cmpint (cnt_added, ==, 0);
+	g_assert_cmpint (cnt_removed, ==, 1);
+	g_assert_cmpint (cnt_changed, ==, 0);
+
+	/* create it again, then add a file */
+	g_mkdir_with_parents (tmpdir, 0700);
+	as_test_loop_run_with_timeout (500);
+	as_test_loop_quit ();
+	ret = g_file_set_contents (tmpfile, "foo", -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	as_test_loop_run_with_timeout (500);
+	as_test_loop_quit ();
+	g_assert_cmpint (cnt_added, ==, 1);
+	g_assert_cmpint (cnt_removed, ==, 1);
+	g_assert_cmpint (cnt_changed, ==, 0);
+
+	/* and changes are still seen */
+	cnt_added = cnt_removed = cnt_changed = 0;
+	ret = g_file_set_contents (tmpfile, "bar", -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	as_test_loop_run_with_timeout (500);
+	as_test_loop_quit ();
+	g_assert_cmpint (cnt_added, ==, 0);
+	g_assert_cmpint (cnt_removed, ==, 0);
+	g_assert_cmpint (cnt_changed, ==, 1);
+
+	/* the directory and file created before the event is processed */
+	cnt_added = cnt_removed = cnt_changed = 0;
+	g_unlink (tmpfile);
+	g_rmdir (tmpdir);
+	g_mkdir_with_parents (tmpdir, 0700);
+	ret = g_file_set_contents (tmpfile, "foo", -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	as_test_loop_run_with_timeout (500);
+	as_test_loop_quit ();
+	g_assert_cmpint (cnt_added + cnt_changed, ==, 1);
+
+	g_unlink (tmpfile);
+}
+
+static void
+as_test_monitor_file_sibling_func (void)
+{
+	gboolean ret;
+	guint cnt_added = 0;
+	guint cnt_removed = 0;
+	guint cnt_changed = 0;
+	_cleanup_object_unref_ AsMonitor *mon = NULL;
+	_cleanup_error_free_ GError *error = NULL;
+	const gchar *tmpdir = "/tmp/monitor-test-sibling";
+	const gchar *tmpfile1 = "/tmp/monitor-test-sibling/one.txt";
+	const gchar *tmpfile2 = "/tmp/monitor-test-sibling/two.txt";
+	const gchar *tmpfile3 = "/tmp/monitor-test-sibling/three.txt";
+
+	g_mkdir_with_parents (tmpdir, 0700);
+	g_unlink (tmpfile1);
+	g_unlink (tmpfile2);
+	g_unlink (tmpfile3);
+
+	mon = as_monitor_new ();
+	as_monitor_set_delay (mon, 0);
+	g_signal_connect (mon, "added",
+			  G_CALLBACK (monitor_test_cb), &cnt_added);
+	g_signal_connect (mon, "removed",
+			  G_CALLBACK (monitor_test_cb), &cnt_removed);
+	g_signal_connect (mon, "changed",
+			  G_CALLBACK (monitor_test_cb), &cnt_changed);
+
+	/* two files in the same directory */
+	ret = as_monitor_add_file (mon, tmpfile1, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = as_monitor_add_file (mon, tmpfile2, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* a file that is not watched */
+	ret = g_file_set_contents (tmpfile3, "foo", -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	as_test_loop_run_with_timeout (500);
+	as_test_loop_quit ();
+	g_assert_cmpint (cnt_added, ==, 0);
+	g_assert_cmpint (cnt_removed, ==, 0);
+	g_assert_cmpint (cnt_changed, ==, 0);
+
+	/* both watched files */
+	ret = g_file_set_contents (tmpfile1, "foo", -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = g_file_set_contents (tmpfile2, "foo", -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	as_test_loop_run_with_timeout (500);
+	as_test_loop_quit ();
+	g_assert_cmpint (cnt_added, ==, 2);
+	g_assert_cmpint (cnt_removed, ==, 0);
+	g_assert_cmpint (cnt_changed, ==, 0);
+
+	/* moving the unwatched file over a watched one */
+	cnt_added = cnt_removed = cnt_changed = 0;
+	g_rename (tmpfile3, tmpfile1);
+	g_unlink (tmpfile2);
+	as_test_loop_run_with_timeout (500);
+	as_test_loop_quit ();
+	g_assert_cmpint (cnt_added, ==, 0);
+	g_assert_cmpint (cnt_removed, ==, 1);
+	g_assert_cmpint (cnt_changed, ==, 1);
+
+	g_unlink (tmpfile1);
+}
+
 static void
 as_test_tag_func (void)
 {
@@ -340,6 +574,50 @@ as_test_tag_func (void)
 		g_assert_cmpint (as_tag_from_string (as_tag_to_string (i)), ==, i);
 }
 
+static void
+as_test_key_func (void)
+{
+	/* simple test */
+	g_assert_cmpint (as_key_from_string ("Name"), ==, AS_KEY_NAME);
+	g_assert_cmpint (as_key_from_string ("_Name"), ==, AS_KEY_NAME);
+	g_assert_cmpint (as_key_from_string ("Screenshots"), ==, AS_KEY_SCREENSHOTS);
+	g_assert_cmpint (as_key_from_string ("X-DocPath"), ==, AS_KEY_X_DOC_PATH);
+	g_assert_cmpint (as_key_from_string ("name"), ==, AS_KEY_UNKNOWN);
+	g_assert_cmpint (as_key_from_string ("Nam"), ==, AS_KEY_UNKNOWN);
+	g_assert_cmpint (as_key_from_string (""), ==, AS_KEY_UNKNOWN);
+	g_assert_cmpint (as_key_from_string (NULL), ==, AS_KEY_UNKNOWN);
+
+	/* not NUL terminated */
+	g_assert_cmpint (as_key_from_data ("Name[de]", 4), ==, AS_KEY_NAME);
+	g_assert_cmpint (as_key_from_data ("Name[de]", 5), ==, AS_KEY_UNKNOWN);
+	g_assert_cmpint (as_key_from_data ("Keywords[fr]", 8), ==, AS_KEY_KEYWORDS);
+}
+
+static void
+as_test_key_speed_func (void)
+{
+	GTimer *timer;
+	guint i;
+	guint j;
+	guint loops = 100000;
+	const gchar *keys[] = { "Name", "Name[de]", "Comment[en_GB]",
+				"Keywords", "X-GNOME-UsesNotifications",
+				"X-Unknown-Key", "Screenshots", NULL };
+
+	timer = g_timer_new ();
+	for (i = 0; i < loops; i++) {
+		for (j = 0; keys[j] != NULL; j++) {
+			const gchar *tmp = strchr (keys[j], '[');
+			if (tmp != NULL)
+				as_key_from_data (keys[j], (gsize) (tmp - keys[j]));
+			else
+				as_key_from_string (keys[j]);
+		}
+	}
+	g_print ("%.0f ns: ", g_timer_elapsed (timer, NULL) * 1000000000 / (loops * 7));
+	g_timer_destroy (timer);
+}
+
 static void
 as_test_release_func (void)
 {
@@ -1081,6 +1359,7 @@ as_test_screenshot_func (void)
 	const gchar *src =
 		"<screenshot priority=\"-64\">\n"
 		"<caption>Hello</caption>\n"
+		"<caption xml:lang=\"de\">Hallo</caption>\n"
 		"<image type=\"source\" height=\"800\" width=\"600\">http://1.png</image>\n"
 		"<image type=\"thumbnail\" height=\"100\" width=\"100\">http://2.png</image>\n"
 		"</screenshot>\n";
@@ -1105,6 +1384,7 @@ as_test_screenshot_func (void)
 	g_assert_cmpint (as_screenshot_get_kind (screenshot), ==, AS_SCREENSHOT_KIND_NORMAL);
 	g_assert_cmpint (as_screenshot_get_priority (screenshot), ==, -64);
 	g_assert_cmpstr (as_screenshot_get_caption (screenshot, "C"), ==, "Hello");
+	g_assert_cmpstr (as_screenshot_get_caption (screenshot, "de"), ==, "Hallo");
 	images = as_screenshot_get_images (screenshot);
 	g_assert_cmpint (images->len, ==, 2);
 	im = as_screenshot_get_source (screenshot);
@@ -1835,6 +2115,72 @@ as_test_app_parse_file_desktop_func (void)
 	g_clear_error (&error);
 }
 
+static void
+as_test_app_parse_file_desktop_escapes_func (void)
+{
+	GError *error = NULL;
+	GPtrArray *keywords;
+	gboolean ret;
+	guint i;
+	const gchar *filename = "/tmp/as-self-test.desktop";
+	_cleanup_object_unref_ AsApp *app = NULL;
+
+	ret = g_file_set_contents (filename,
+		"# a comment\n"
+		"[Desktop Entry]\n"
+		"Type=Application\n"
+		"Name = Foo\\\\Bar\r\n"
+		"Comment[de]=Hallo\\sWelt\n"
+		"Keywords=a\\;b;c;\n"
+		"Icon=foo\n"
+		"[Desktop Action New]\n"
+		"Name=Ignored\n", -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	app = as_app_new ();
+	ret = as_app_parse_file (app, filename, 0, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpstr (as_app_get_name (app, "C"), ==, "Foo\\Bar");
+	g_assert_cmpstr (as_app_get_comment (app, "de"), ==, "Hallo Welt");
+	keywords = as_app_get_keywords (app, "C");
+	g_assert_cmpint (keywords->len, ==, 2);
+	g_assert_cmpstr (g_ptr_array_index (keywords, 0), ==, "a;b");
+	g_assert_cmpstr (g_ptr_array_index (keywords, 1), ==, "c");
+
+	/* the last of any duplicate keys wins, as with GKeyFile */
+	ret = g_file_set_contents (filename,
+		"[Desktop Entry]\n"
+		"Type=Application\n"
+		"Name=Old\n"
+		"Icon=old\n"
+		"Name=New\n"
+		"Icon=new\n", -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	for (i = 0; i < 2; i++) {
+		AsAppParseFlags flags[] = { AS_APP_PARSE_FLAG_NONE,
+					    AS_APP_PARSE_FLAG_KEEP_COMMENTS };
+		_cleanup_object_unref_ AsApp *app_tmp = as_app_new ();
+		ret = as_app_parse_file (app_tmp, filename, flags[i], &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+		g_assert_cmpstr (as_app_get_name (app_tmp, "C"), ==, "New");
+		g_assert_cmpint (as_app_get_icons (app_tmp)->len, ==, 1);
+		g_assert_cmpstr (as_icon_get_name (as_app_get_icon_default (app_tmp)), ==, "new");
+	}
+
+	/* keys outside of any group */
+	ret = g_file_set_contents (filename, "Name=Foo\n", -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	ret = as_app_parse_file (app, filename, 0, &error);
+	g_assert_error (error, AS_APP_ERROR, AS_APP_ERROR_INVALID_TYPE);
+	g_assert (!ret);
+	g_clear_error (&error);
+}
+
 static void
 as_test_app_parse_file_inf_func (void)
 {
@@ -1961,6 +2307,97 @@ as_test_node_reflow_text_func (void)
 	g_free (tmp);
 }
 
+/* the line-splitting implementation, kept to check the new one against */
+static gchar *
+as_test_node_reflow_text_reference (const gchar *text)
+{
+	GString *tmp;
+	guint i;
+	guint newline_count = 0;
+	_cleanup_strv_free_ gchar **split = NULL;
+
+	tmp = g_string_new ("");
+	split = g_strsplit (text, "\n", -1);
+	for (i = 0; split[i] != NULL; i++) {
+		g_strstrip (split[i]);
+		if (split[i][0] == '\0') {
+			newline_count++;
+			continue;
+		}
+		if (newline_count == 1 && tmp->len > 0)
+			g_string_append (tmp, " ");
+		if (newline_count > 1)
+			g_string_append (tmp, "\n\n");
+		g_string_append (tmp, split[i]);
+		newline_count = 1;
+	}
+	return g_string_free (tmp, FALSE);
+}
+
+static void
+as_test_node_reflow_text_fuzz_func (void)
+{
+	guint i;
+	guint j;
+	const gchar *tokens[] = { " ", "\t", "\n", "\r", "\v", "a", "bc",
+				  "\xc3\xa9", "&amp;", "&lt;", "&", "<", ">",
+				  "                ", NULL };
+
+	for (i = 0; i < 10000; i++) {
+		guint len = (guint) g_test_rand_int_range (0, 80);
+		_cleanup_free_ gchar *tmp1 = NULL;
+		_cleanup_free_ gchar *tmp2 = NULL;
+		_cleanup_string_free_ GString *str = NULL;
+		_cleanup_error_free_ GError *error = NULL;
+		_cleanup_string_free_ GString *xml = NULL;
+		_cleanup_string_free_ GString *xml2 = NULL;
+		_cleanup_node_unref_ GNode *root = NULL;
+		_cleanup_node_unref_ GNode *root2 = NULL;
+		_cleanup_node_unref_ GNode *root3 = NULL;
+
+		/* random text, including runs longer than one SSE2 block */
+		str = g_string_new ("");
+		for (j = 0; j < len; j++) {
+			gint idx = g_test_rand_int_range (0, G_N_ELEMENTS (tokens) - 1);
+			g_string_append (str, tokens[idx]);
+		}
+		tmp1 = as_node_reflow_text (str->str, str->len);
+		tmp2 = as_test_node_reflow_text_reference (str->str);
+		g_assert_cmpstr (tmp1, ==, tmp2);
+
+		/* escaping and unescaping round trips */
+		root = as_node_new ();
+		as_node_insert (root, "p", str->str, AS_NODE_INSERT_FLAG_NONE, NULL);
+		xml = as_node_to_xml (root->children, AS_NODE_TO_XML_FLAG_NONE);
+		g_assert (g_strstr_len (xml->str, -1, "&&") == NULL);
+		g_assert_cmpstr (as_node_get_data (as_node_find (root, "p")), ==, str->str);
+
+		/* parsing the XML again gives the same tree */
+		root2 = as_node_from_xml (xml->str,
+					  AS_NODE_FROM_XML_FLAG_LITERAL_TEXT,
+					  &error);
+		g_assert_no_error (error);
+		g_assert (root2 != NULL);
+		if (tmp1[0] == '\0') {
+			/* whitespace-only text is not kept */
+			g_assert_cmpstr (as_node_get_data (as_node_find (root2, "p")), ==, NULL);
+		} else {
+			xml2 = as_node_to_xml (root2->children, AS_NODE_TO_XML_FLAG_NONE);
+			g_assert_cmpstr (xml2->str, ==, xml->str);
+			g_assert_cmpstr (as_node_get_data (as_node_find (root2, "p")), ==, str->str);
+		}
+
+		/* and is reflowed when not parsed literally */
+		root3 = as_node_from_xml (xml->str, AS_NODE_FROM_XML_FLAG_NONE, &error);
+		g_assert_no_error (error);
+		g_assert (root3 != NULL);
+		if (tmp1[0] == '\0')
+			g_assert_cmpstr (as_node_get_data (as_node_find (root3, "p")), ==, NULL);
+		else
+			g_assert_cmpstr (as_node_get_data (as_node_find (root3, "p")), ==, tmp1);
+	}
+}
+
 static void
 as_test_node_sort_func (void)
 {
@@ -2389,12 +2826,116 @@ as_test_app_subsume_func (void)
 	g_assert_cmpint (as_app_get_screenshots(app)->len, ==, 1);
 }
 
+static void
+as_test_app_releases_func (void)
+{
+	AsRelease *rel;
+	GPtrArray *releases;
+	guint i;
+	const gchar *versions[] = { "0.2.0", "1.0.0", "0.10.0", "0.9.1", NULL };
+	_cleanup_object_unref_ AsApp *app = NULL;
+
+	/* added in any order */
+	app = as_app_new ();
+	g_assert (as_app_get_release_default (app) == NULL);
+	for (i = 0; versions[i] != NULL; i++) {
+		_cleanup_object_unref_ AsRelease *tmp = as_release_new ();
+		as_release_set_version (tmp, versions[i]);
+		as_app_add_release (app, tmp);
+	}
+
+	/* kept newest first */
+	releases = as_app_get_releases (app);
+	g_assert_cmpint (releases->len, ==, 4);
+	g_assert_cmpstr (as_release_get_version (g_ptr_array_index (releases, 0)), ==, "1.0.0");
+	g_assert_cmpstr (as_release_get_version (g_ptr_array_index (releases, 1)), ==, "0.10.0");
+	g_assert_cmpstr (as_release_get_version (g_ptr_array_index (releases, 2)), ==, "0.9.1");
+	g_assert_cmpstr (as_release_get_version (g_ptr_array_index (releases, 3)), ==, "0.2.0");
+	rel = as_app_get_release_default (app);
+	g_assert_cmpstr (as_release_get_version (rel), ==, "1.0.0");
+
+	/* a release without a version takes one from a duplicate */
+	{
+		_cleanup_object_unref_ AsApp *app2 = as_app_new ();
+		_cleanup_object_unref_ AsRelease *rel1 = as_release_new ();
+		_cleanup_object_unref_ AsRelease *rel2 = as_release_new ();
+		_cleanup_object_unref_ AsRelease *rel3 = as_release_new ();
+		as_release_set_version (rel1, "0.1.0");
+		as_app_add_release (app2, rel1);
+		as_release_set_timestamp (rel2, 123);
+		as_app_add_release (app2, rel2);
+		as_release_set_version (rel3, "0.2.0");
+		as_app_add_release (app2, rel3);
+		releases = as_app_get_releases (app2);
+		g_assert_cmpint (releases->len, ==, 2);
+		rel = as_app_get_release_default (app2);
+		g_assert_cmpstr (as_release_get_version (rel), ==, "0.2.0");
+		g_assert_cmpint (as_release_get_timestamp (rel), ==, 123);
+	}
+
+	/* ordered by timestamp when the versions cannot be compared, and
+	 * still in order after a release is changed */
+	{
+		_cleanup_object_unref_ AsApp *app2 = as_app_new ();
+		_cleanup_object_unref_ AsRelease *rel1 = as_release_new ();
+		_cleanup_object_unref_ AsRelease *rel2 = as_release_new ();
+		as_release_set_version (rel1, "3.18.0-beta");
+		as_release_set_timestamp (rel1, 100);
+		as_app_add_release (app2, rel1);
+		as_release_set_version (rel2, "3.18.0-rc");
+		as_release_set_timestamp (rel2, 200);
+		as_app_add_release (app2, rel2);
+		rel = as_app_get_release_default (app2);
+		g_assert_cmpstr (as_release_get_version (rel), ==, "3.18.0-rc");
+		as_release_set_timestamp (rel1, 300);
+		rel = as_app_get_release_default (app2);
+		g_assert_cmpstr (as_release_get_version (rel), ==, "3.18.0-beta");
+		releases = as_app_get_releases (app2);
+		g_assert (g_ptr_array_index (releases, 0) == rel1);
+		g_assert (g_ptr_array_index (releases, 1) == rel2);
+		as_release_set_version (rel2, "3.18.1");
+		rel = as_app_get_release_default (app2);
+		g_assert (rel == rel2);
+	}
+}
+
+static void
+as_test_app_subsume_shared_func (void)
+{
+	_cleanup_object_unref_ AsApp *app = NULL;
+	_cleanup_object_unref_ AsApp *donor = NULL;
+
+	donor = as_app_new ();
+	as_app_set_description (donor, NULL, "<p>Donor</p>");
+	as_app_set_description (donor, "pl", "<p>Dawca</p>");
+	as_app_set_name (donor, NULL, "Donor");
+	app = as_app_new ();
+	as_app_set_name (app, NULL, "App");
+
+	/* the data is visible in both */
+	as_app_subsume_full (app, donor, AS_APP_SUBSUME_FLAG_BOTH_WAYS);
+	g_assert_cmpstr (as_app_get_description (app, "pl"), ==, "<p>Dawca</p>");
+	g_assert_cmpstr (as_app_get_name (app, NULL), ==, "App");
+	g_assert_cmpstr (as_app_get_name (donor, NULL), ==, "Donor");
+
+	/* changing one copy does not change the other */
+	as_app_set_description (app, NULL, "<p>App</p>");
+	g_assert_cmpstr (as_app_get_description (app, NULL), ==, "<p>App</p>");
+	g_assert_cmpstr (as_app_get_description (donor, NULL), ==, "<p>Donor</p>");
+	as_app_set_description (donor, "pl", "<p>Nowy</p>");
+	g_assert_cmpstr (as_app_get_description (app, "pl"), ==, "<p>Dawca</p>");
+	g_assert_cmpstr (as_app_get_description (donor, "pl"), ==, "<p>Nowy</p>");
+	g_assert_cmpint (as_app_get_description_size (app), ==, 2);
+	g_assert_cmpint (as_app_get_description_size (donor), ==, 2);
+}
+
 static void
 as_test_app_search_func (void)
 {
 	const gchar *all[] = { "gnome", "install", "software", NULL };
 	const gchar *none[] = { "gnome", "xxx", "software", NULL };
 	const gchar *mime[] = { "vnd", "oasis", "opendocument","text", NULL };
+	const gchar *soft[] = { "soft", NULL };
 	_cleanup_object_unref_ AsApp *app = NULL;
 
 	app = as_app_new ();
@@ -2417,21 +2958,97 @@ as_test_app_search_func (void)
 
 	/* do not add short or common keywords */
 	g_assert_cmpint (as_app_search_matches (app, "and"), ==, 0);
+
+	/* ranked matches count every token, and exact more than prefix */
+	g_assert_cmpint (as_app_search_matches_ranked (app, (gchar**) all), ==, 1120);
+	g_assert_cmpint (as_app_search_matches_ranked (app, (gchar**) none), ==, 0);
+	g_assert_cmpint (as_app_search_matches_ranked (app, (gchar**) mime), ==, 16);
+	g_assert_cmpint (as_app_search_matches_ranked (app, (gchar**) soft), ==, 280);
+
+	/* the tokens are worked out again when the data changes */
+	as_app_add_keyword (app, NULL, "appstore");
+	g_assert_cmpint (as_app_search_matches (app, "appstore"), ==, 90);
+	as_app_set_name (app, NULL, "Store");
+	g_assert_cmpint (as_app_search_matches (app, "gnome"), ==, 0);
 }
 
-/* load and save embedded icons */
 static void
-as_test_store_embedded_func (void)
+as_test_store_search_func (void)
 {
 	AsApp *app;
-	AsIcon *icon;
+	GError *error = NULL;
 	gboolean ret;
-	_cleanup_error_free_ GError *error = NULL;
+	const gchar *image[] = { "image", NULL };
+	const gchar *edit[] = { "edit", NULL };
+	const gchar *none[] = { "xxx", NULL };
+	const gchar *xml =
+		"<components version=\"0.6\">"
+		"<component type=\"desktop\">"
+		"<id>gimp.desktop</id>"
+		"<name>GIMP</name>"
+		"<summary>Edit images</summary>"
+		"</component>"
+		"<component type=\"desktop\">"
+		"<id>eog.desktop</id>"
+		"<name>Image Viewer</name>"
+		"<summary>Browse and rotate images</summary>"
+		"<keywords><keyword>image</keyword></keywords>"
+		"</component>"
+		"<component type=\"desktop\">"
+		"<id>gedit.desktop</id>"
+		"<name>Text Editor</name>"
+		"<summary>Edit text files</summary>"
+		"</component>"
+		"</components>";
 	_cleanup_object_unref_ AsStore *store = NULL;
-	_cleanup_string_free_ GString *xml = NULL;
-	const gchar *xml_src =
-"<components version=\"0.6\" origin=\"origin\">"
-"<component type=\"desktop\">"
+	_cleanup_ptrarray_unref_ GPtrArray *apps1 = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *apps2 = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *apps3 = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *apps4 = NULL;
+
+	store = as_store_new ();
+	ret = as_store_from_xml (store, xml, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* best match first */
+	apps1 = as_store_search (store, (gchar **) image, 0);
+	g_assert_cmpint (apps1->len, ==, 2);
+	app = g_ptr_array_index (apps1, 0);
+	g_assert_cmpstr (as_app_get_id (app), ==, "eog.desktop");
+	app = g_ptr_array_index (apps1, 1);
+	g_assert_cmpstr (as_app_get_id (app), ==, "gimp.desktop");
+
+	/* only the top result */
+	apps2 = as_store_search (store, (gchar **) edit, 1);
+	g_assert_cmpint (apps2->len, ==, 1);
+	app = g_ptr_array_index (apps2, 0);
+	g_assert_cmpstr (as_app_get_id (app), ==, "gedit.desktop");
+
+	/* more results allowed than exist */
+	apps3 = as_store_search (store, (gchar **) edit, 10);
+	g_assert_cmpint (apps3->len, ==, 2);
+	app = g_ptr_array_index (apps3, 1);
+	g_assert_cmpstr (as_app_get_id (app), ==, "gimp.desktop");
+
+	/* no matches */
+	apps4 = as_store_search (store, (gchar **) none, 0);
+	g_assert_cmpint (apps4->len, ==, 0);
+}
+
+/* load and save embedded icons */
+static void
+as_test_store_embedded_func (void)
+{
+	AsApp *app;
+	AsIcon *icon;
+	gboolean ret;
+	_cleanup_error_free_ GError *error = NULL;
+	_cleanup_object_unref_ AsStore *store = NULL;
+	_cleanup_string_free_ GString *xml = NULL;
+	const gchar *xml_src =
+"<components version=\"0.6\" origin=\"origin\">"
+"<component type=\"desktop\">"
 "<id>eog.desktop</id>"
 "<pkgname>eog</pkgname>"
 "<name>Image Viewer</name>"
@@ -2661,6 +3278,316 @@ as_test_store_auto_reload_file_func (void)
 	g_assert (app == NULL);
 }
 
+static void
+store_apps_changed_cb (AsStore *store,
+		       GPtrArray *added,
+		       GPtrArray *removed,
+		       GPtrArray *updated,
+		       guint *changes)
+{
+	changes[0] = added->len;
+	changes[1] = removed->len;
+	changes[2] = updated->len;
+}
+
+/* parse changed files without blocking the main loop */
+static void
+as_test_store_auto_reload_background_func (void)
+{
+	AsApp *app;
+	AsRelease *rel;
+	gboolean ret;
+	guint cnt = 0;
+	_cleanup_error_free_ GError *error = NULL;
+	_cleanup_object_unref_ AsStore *store = NULL;
+	_cleanup_object_unref_ GFile *file = NULL;
+
+	/* set initial file */
+	ret = g_file_set_contents ("/tmp/as-self-test-background.xml",
+				   "<components version=\"0.6\">"
+				   "<component type=\"desktop\">"
+				   "<id>test.desktop</id>"
+				   "<releases>"
+				   "<release version=\"0.1.2\" timestamp=\"123\"/>"
+				   "</releases>"
+				   "</component>"
+				   "</components>",
+				   -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* add this file to a store */
+	store = as_store_new ();
+	g_signal_connect (store, "changed",
+			  G_CALLBACK (store_changed_cb), &cnt);
+	as_store_set_watch_flags (store, AS_STORE_WATCH_FLAG_ADDED |
+					   AS_STORE_WATCH_FLAG_REMOVED |
+					   AS_STORE_WATCH_FLAG_BACKGROUND);
+	file = g_file_new_for_path ("/tmp/as-self-test-background.xml");
+	ret = as_store_from_file (store, file, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (cnt, ==, 1);
+
+	/* change the file, and wait for the worker to finish */
+	ret = g_file_set_contents ("/tmp/as-self-test-background.xml",
+				   "<components version=\"0.6\">"
+				   "<component type=\"desktop\">"
+				   "<id>test.desktop</id>"
+				   "<releases>"
+				   "<release version=\"0.1.3\" timestamp=\"456\"/>"
+				   "</releases>"
+				   "</component>"
+				   "<component type=\"desktop\">"
+				   "<id>added.desktop</id>"
+				   "</component>"
+				   "</components>",
+				   -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	as_test_loop_run_with_timeout (2000);
+	g_assert_cmpint (cnt, ==, 2);
+
+	/* verify */
+	g_assert_cmpint (as_store_get_size (store), ==, 2);
+	g_assert (as_store_get_app_by_id (store, "added.desktop") != NULL);
+	app = as_store_get_app_by_id (store, "test.desktop");
+	g_assert (app != NULL);
+	rel = as_app_get_release_default (app);
+	g_assert_cmpstr (as_release_get_version (rel), ==, "0.1.3");
+
+	/* remove file */
+	g_unlink ("/tmp/as-self-test-background.xml");
+	as_test_loop_run_with_timeout (2000);
+	g_assert_cmpint (cnt, ==, 3);
+	g_assert_cmpint (as_store_get_size (store), ==, 0);
+}
+
+/* only apply the result of the latest background reload */
+static void
+as_test_store_reload_background_superseded_func (void)
+{
+	AsApp *app;
+	AsRelease *rel;
+	gboolean ret;
+	guint cnt = 0;
+	_cleanup_error_free_ GError *error = NULL;
+	_cleanup_object_unref_ AsStore *store = NULL;
+	_cleanup_object_unref_ GFile *file = NULL;
+
+	/* set initial file */
+	ret = g_file_set_contents ("/tmp/as-self-test-superseded.xml",
+				   "<components version=\"0.6\">"
+				   "<component type=\"desktop\">"
+				   "<id>test.desktop</id>"
+				   "<releases>"
+				   "<release version=\"0.1.2\" timestamp=\"123\"/>"
+				   "</releases>"
+				   "</component>"
+				   "</components>",
+				   -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	store = as_store_new ();
+	g_signal_connect (store, "changed",
+			  G_CALLBACK (store_changed_cb), &cnt);
+	file = g_file_new_for_path ("/tmp/as-self-test-superseded.xml");
+	ret = as_store_from_file (store, file, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (cnt, ==, 1);
+
+	/* change the file twice before either worker has been applied */
+	ret = g_file_set_contents ("/tmp/as-self-test-superseded.xml",
+				   "<components version=\"0.6\">"
+				   "<component type=\"desktop\">"
+				   "<id>test.desktop</id>"
+				   "<releases>"
+				   "<release version=\"0.1.3\" timestamp=\"456\"/>"
+				   "</releases>"
+				   "</component>"
+				   "<component type=\"desktop\">"
+				   "<id>stale.desktop</id>"
+				   "</component>"
+				   "</components>",
+				   -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	as_store_reload_file_background (store, "/tmp/as-self-test-superseded.xml");
+	ret = g_file_set_contents ("/tmp/as-self-test-superseded.xml",
+				   "<components version=\"0.6\">"
+				   "<component type=\"desktop\">"
+				   "<id>test.desktop</id>"
+				   "<releases>"
+				   "<release version=\"0.1.4\" timestamp=\"789\"/>"
+				   "</releases>"
+				   "</component>"
+				   "</components>",
+				   -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	as_store_reload_file_background (store, "/tmp/as-self-test-superseded.xml");
+
+	/* the first result is dropped, the second applied */
+	as_test_loop_run_with_timeout (2000);
+	g_assert_cmpint (cnt, ==, 2);
+	as_test_loop_run_with_timeout (200);
+	g_assert_cmpint (cnt, ==, 2);
+	g_assert_cmpint (as_store_get_size (store), ==, 1);
+	g_assert (as_store_get_app_by_id (store, "stale.desktop") == NULL);
+	app = as_store_get_app_by_id (store, "test.desktop");
+	g_assert (app != NULL);
+	rel = as_app_get_release_default (app);
+	g_assert_cmpstr (as_release_get_version (rel), ==, "0.1.4");
+
+	g_unlink ("/tmp/as-self-test-superseded.xml");
+}
+
+/* destroying the store cancels a background reload */
+static void
+as_test_store_reload_background_dispose_func (void)
+{
+	AsStore *store;
+	gboolean ret;
+	guint cnt = 0;
+	_cleanup_error_free_ GError *error = NULL;
+	_cleanup_object_unref_ GFile *file = NULL;
+
+	/* set initial file */
+	ret = g_file_set_contents ("/tmp/as-self-test-dispose.xml",
+				   "<components version=\"0.6\">"
+				   "<component type=\"desktop\">"
+				   "<id>test.desktop</id>"
+				   "</component>"
+				   "</components>",
+				   -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	store = as_store_new ();
+	g_signal_connect (store, "changed",
+			  G_CALLBACK (store_changed_cb), &cnt);
+	file = g_file_new_for_path ("/tmp/as-self-test-dispose.xml");
+	ret = as_store_from_file (store, file, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (cnt, ==, 1);
+
+	/* the pending reload does not keep the store alive */
+	as_store_reload_file_background (store, "/tmp/as-self-test-dispose.xml");
+	g_object_add_weak_pointer (G_OBJECT (store), (gpointer *) &store);
+	g_object_unref (store);
+	g_assert (store == NULL);
+
+	/* the cancelled worker finishes without touching the store */
+	as_test_loop_run_with_timeout (200);
+	g_assert_cmpint (cnt, ==, 1);
+
+	g_unlink ("/tmp/as-self-test-dispose.xml");
+}
+
+/* only apply the components that changed */
+static void
+as_test_store_auto_reload_incremental_func (void)
+{
+	AsApp *app;
+	AsApp *app_unchanged;
+	AsRelease *rel;
+	gboolean ret;
+	guint cnt = 0;
+	guint changes[3] = { 0, 0, 0 };
+	_cleanup_error_free_ GError *error = NULL;
+	_cleanup_object_unref_ AsStore *store = NULL;
+	_cleanup_object_unref_ GFile *file = NULL;
+
+	/* set initial file */
+	ret = g_file_set_contents ("/tmp/as-self-test-incremental.xml",
+				   "<components version=\"0.6\">"
+				   "<component type=\"desktop\">"
+				   "<id>removed.desktop</id>"
+				   "</component>"
+				   "<component type=\"desktop\">"
+				   "<id>unchanged.desktop</id>"
+				   "<name>Unchanged</name>"
+				   "</component>"
+				   "<component type=\"desktop\">"
+				   "<id>changed.desktop</id>"
+				   "<releases>"
+				   "<release version=\"0.1.2\" timestamp=\"123\"/>"
+				   "</releases>"
+				   "</component>"
+				   "</components>",
+				   -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* add this file to a store */
+	store = as_store_new ();
+	g_signal_connect (store, "changed",
+			  G_CALLBACK (store_changed_cb), &cnt);
+	g_signal_connect (store, "apps-changed",
+			  G_CALLBACK (store_apps_changed_cb), changes);
+	as_store_set_watch_flags (store, AS_STORE_WATCH_FLAG_ADDED |
+					   AS_STORE_WATCH_FLAG_REMOVED |
+					   AS_STORE_WATCH_FLAG_INCREMENTAL);
+	file = g_file_new_for_path ("/tmp/as-self-test-incremental.xml");
+	ret = as_store_from_file (store, file, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (cnt, ==, 1);
+	g_assert_cmpint (as_store_get_size (store), ==, 3);
+	g_assert_cmpint (changes[0], ==, 3);
+	g_assert_cmpint (changes[1], ==, 0);
+	g_assert_cmpint (changes[2], ==, 0);
+	app_unchanged = as_store_get_app_by_id (store, "unchanged.desktop");
+	g_assert (app_unchanged != NULL);
+
+	/* change the file, and ensure we get one callback */
+	ret = g_file_set_contents ("/tmp/as-self-test-incremental.xml",
+				   "<components version=\"0.6\">"
+				   "<component type=\"desktop\">"
+				   "<id>unchanged.desktop</id>"
+				   "<name>Unchanged</name>"
+				   "</component>"
+				   "<component type=\"desktop\">"
+				   "<id>changed.desktop</id>"
+				   "<releases>"
+				   "<release version=\"0.1.3\" timestamp=\"456\"/>"
+				   "</releases>"
+				   "</component>"
+				   "<component type=\"desktop\">"
+				   "<id>added.desktop</id>"
+				   "</component>"
+				   "</components>",
+				   -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	as_test_loop_run_with_timeout (2000);
+	g_assert_cmpint (cnt, ==, 2);
+
+	/* the changed component is a new object, but with the same ID */
+	g_assert_cmpint (changes[0], ==, 1);
+	g_assert_cmpint (changes[1], ==, 1);
+	g_assert_cmpint (changes[2], ==, 1);
+
+	/* verify */
+	g_assert_cmpint (as_store_get_size (store), ==, 3);
+	g_assert (as_store_get_app_by_id (store, "removed.desktop") == NULL);
+	g_assert (as_store_get_app_by_id (store, "added.desktop") != NULL);
+	g_assert (as_store_get_app_by_id (store, "unchanged.desktop") == app_unchanged);
+	app = as_store_get_app_by_id (store, "changed.desktop");
+	g_assert (app != NULL);
+	rel = as_app_get_release_default (app);
+	g_assert_cmpstr (as_release_get_version (rel), ==, "0.1.3");
+
+	/* remove file */
+	g_unlink ("/tmp/as-self-test-incremental.xml");
+	as_test_loop_run_with_timeout (2000);
+	g_assert_cmpint (cnt, ==, 3);
+	g_assert_cmpint (as_store_get_size (store), ==, 0);
+	g_assert_cmpint (changes[0], ==, 0);
+	g_assert_cmpint (changes[1], ==, 3);
+}
+
 /* demote the .desktop "application" to an addon */
 static void
 as_test_store_demote_func (void)
@@ -2781,6 +3708,175 @@ as_test_store_merges_func (void)
 	g_assert_cmpint (as_app_get_state (app_tmp), ==, AS_APP_STATE_INSTALLED);
 }
 
+static void
+as_test_store_dedup_func (void)
+{
+	AsApp *app;
+	AsApp *app_tmp;
+	GError *error = NULL;
+	gboolean ret;
+	guint changes[3] = { 0, 0, 0 };
+	_cleanup_free_ gchar *hash = NULL;
+	_cleanup_object_unref_ AsStore *store = NULL;
+	const gchar *xml1 =
+		"<components version=\"0.8\" origin=\"fedora\">"
+		"<component type=\"desktop\">"
+		"<id>test.desktop</id>"
+		"<name>Test</name>"
+		"<pkgname>test</pkgname>"
+		"</component>"
+		"</components>";
+	const gchar *xml2 =
+		"<components version=\"0.8\" origin=\"updates\">"
+		"<component type=\"desktop\">"
+		"<id>test.desktop</id>"
+		"<name>Test</name>"
+		"<pkgname>test</pkgname>"
+		"</component>"
+		"</components>";
+	const gchar *xml3 =
+		"<components version=\"0.8\" origin=\"updates\">"
+		"<component type=\"desktop\">"
+		"<id>test.desktop</id>"
+		"<name>Test</name>"
+		"<pkgname>test-common</pkgname>"
+		"</component>"
+		"</components>";
+
+	/* load the component from one catalogue */
+	store = as_store_new ();
+	g_signal_connect (store, "apps-changed",
+			  G_CALLBACK (store_apps_changed_cb), changes);
+	ret = as_store_from_xml (store, xml1, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (changes[0], ==, 1);
+	app = as_store_get_app_by_id (store, "test.desktop");
+	g_assert (app != NULL);
+	g_assert_cmpint (strlen (as_app_get_content_hash (app)), ==, 40);
+	hash = g_strdup (as_app_get_content_hash (app));
+
+	/* loading the same catalogue again is ignored */
+	memset (changes, 0, sizeof (changes));
+	ret = as_store_from_xml (store, xml1, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (changes[0], ==, 0);
+	g_assert_cmpint (changes[2], ==, 0);
+	g_assert_cmpint (as_store_get_size (store), ==, 1);
+	app_tmp = as_store_get_app_by_id (store, "test.desktop");
+	g_assert (app_tmp == app);
+	g_assert_cmpstr (as_app_get_content_hash (app_tmp), ==, hash);
+
+	/* the same metadata from another catalogue is not merged, but the
+	 * origin of the newer catalogue is recorded */
+	memset (changes, 0, sizeof (changes));
+	ret = as_store_from_xml (store, xml2, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (changes[0], ==, 0);
+	g_assert_cmpint (changes[2], ==, 0);
+	g_assert_cmpint (as_store_get_size (store), ==, 1);
+	app_tmp = as_store_get_app_by_id (store, "test.desktop");
+	g_assert (app_tmp == app);
+	g_assert_cmpstr (as_app_get_content_hash (app_tmp), ==, hash);
+	g_assert_cmpstr (as_app_get_origin (app_tmp), ==, "updates");
+	g_assert_cmpint (as_app_get_pkgnames(app_tmp)->len, ==, 1);
+
+	/* as is different metadata */
+	ret = as_store_from_xml (store, xml3, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (as_store_get_size (store), ==, 1);
+	app_tmp = as_store_get_app_by_id (store, "test.desktop");
+	g_assert_cmpint (as_app_get_pkgnames(app_tmp)->len, ==, 2);
+}
+
+static void
+as_test_store_id_renames_func (void)
+{
+	AsApp *app;
+	GError *error = NULL;
+	gboolean ret;
+	const gchar *tmpfile = "/tmp/as-self-test-renames.yml";
+	_cleanup_object_unref_ AsApp *app_cheese = NULL;
+	_cleanup_object_unref_ AsApp *app_test = NULL;
+	_cleanup_object_unref_ AsStore *store = NULL;
+	_cleanup_object_unref_ GFile *file = NULL;
+	const gchar *xml =
+		"<components version=\"0.8\">"
+		"<component type=\"desktop\">"
+		"<id>org.example.Test.desktop</id>"
+		"<provides>"
+		"<id>test.desktop</id>"
+		"<binary>test</binary>"
+		"</provides>"
+		"</component>"
+		"</components>";
+
+	store = as_store_new ();
+
+	/* built-in rename, in both directions */
+	app_cheese = as_app_new ();
+	as_app_set_id (app_cheese, "org.gnome.Cheese.desktop");
+	as_store_add_app (store, app_cheese);
+	app = as_store_get_app_by_id_with_fallbacks (store, "cheese.desktop");
+	g_assert (app == app_cheese);
+	as_store_remove_app (store, app_cheese);
+	as_app_set_id (app_cheese, "cheese.desktop");
+	as_store_add_app (store, app_cheese);
+	app = as_store_get_app_by_id_with_fallbacks (store, "org.gnome.Cheese.desktop");
+	g_assert (app == app_cheese);
+
+	/* rename listed in the metadata */
+	ret = as_store_from_xml (store, xml, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert (as_store_get_app_by_id (store, "test.desktop") == NULL);
+	app = as_store_get_app_by_id_with_fallbacks (store, "test.desktop");
+	g_assert (app != NULL);
+	g_assert_cmpstr (as_app_get_id (app), ==, "org.example.Test.desktop");
+
+	/* unknown */
+	app = as_store_get_app_by_id_with_fallbacks (store, "test");
+	g_assert (app == NULL);
+
+	/* the rename is forgotten when the component is removed */
+	as_store_remove_app_by_id (store, "org.example.Test.desktop");
+	app_test = as_app_new ();
+	as_app_set_id (app_test, "test.desktop");
+	as_store_add_app (store, app_test);
+	app = as_store_get_app_by_id_with_fallbacks (store, "org.example.Test.desktop");
+	g_assert (app == NULL);
+	as_store_remove_all (store);
+
+	/* rename listed in DEP-11 */
+	ret = g_file_set_contents (tmpfile,
+				   "---\n"
+				   "File: DEP-11\n"
+				   "Origin: aequorea\n"
+				   "Version: '0.8'\n"
+				   "---\n"
+				   "Type: desktop-app\n"
+				   "ID: org.example.Dave.desktop\n"
+				   "Provides:\n"
+				   "  binaries:\n"
+				   "  - dave\n"
+				   "  ids:\n"
+				   "  - dave.desktop\n", -1, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	file = g_file_new_for_path (tmpfile);
+	ret = as_store_from_file (store, file, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	app = as_store_get_app_by_id_with_fallbacks (store, "dave.desktop");
+	g_assert (app != NULL);
+	g_assert_cmpstr (as_app_get_id (app), ==, "org.example.Dave.desktop");
+	g_assert_cmpint (as_app_get_provides (app)->len, ==, 2);
+	g_unlink (tmpfile);
+}
+
 static void
 as_test_store_merges_local_func (void)
 {
@@ -3103,84 +4199,337 @@ as_test_node_no_dup_c_func (void)
 }
 
 static void
-as_test_store_origin_func (void)
+as_test_store_origin_func (void)
+{
+	AsApp *app;
+	GError *error = NULL;
+	gboolean ret;
+	_cleanup_free_ gchar *filename = NULL;
+	_cleanup_object_unref_ AsStore *store = NULL;
+	_cleanup_object_unref_ GFile *file = NULL;
+
+	/* load a file to the store */
+	store = as_store_new ();
+	filename = as_test_get_filename ("origin.xml");
+	file = g_file_new_for_path (filename);
+	ret = as_store_from_file (store, file, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* test icon path */
+	g_assert_cmpstr (as_store_get_origin (store), ==, "fedora-21");
+	g_assert_cmpint (as_store_get_size (store), ==, 1);
+	app = as_store_get_app_by_id (store, "test.desktop");
+	g_assert (app != NULL);
+	g_assert_cmpstr (as_app_get_icon_path (app), ==,
+		"/usr/share/app-info/icons/fedora-21");
+	g_assert_cmpstr (as_app_get_origin (app), ==, "fedora-21");
+	g_assert_cmpstr (as_app_get_source_file (app), ==, filename);
+}
+
+static void
+as_test_store_speed_appstream_func (void)
+{
+	GError *error = NULL;
+	gboolean ret;
+	guint i;
+	guint loops = 10;
+	_cleanup_free_ gchar *filename = NULL;
+	_cleanup_object_unref_ GFile *file = NULL;
+	_cleanup_timer_destroy_ GTimer *timer = NULL;
+
+	filename = as_test_get_filename ("example-v04.xml.gz");
+	file = g_file_new_for_path (filename);
+	timer = g_timer_new ();
+	for (i = 0; i < loops; i++) {
+		_cleanup_object_unref_ AsStore *store = NULL;
+		store = as_store_new ();
+		ret = as_store_from_file (store, file, NULL, NULL, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+		g_assert_cmpint (as_store_get_apps (store)->len, >=, 1415);
+		g_assert (as_store_get_app_by_id (store, "org.gnome.Software.desktop") != NULL);
+		g_assert (as_store_get_app_by_pkgname (store, "gnome-software") != NULL);
+	}
+	g_print ("%.0f ms: ", g_timer_elapsed (timer, NULL) * 1000 / loops);
+}
+
+static void
+as_test_store_speed_validate_func (void)
+{
+	GError *error = NULL;
+	gboolean ret;
+	guint i;
+	guint loops = 10;
+	_cleanup_free_ gchar *filename = NULL;
+	_cleanup_object_unref_ AsStore *store = NULL;
+	_cleanup_object_unref_ GFile *file = NULL;
+	_cleanup_timer_destroy_ GTimer *timer = NULL;
+
+	filename = as_test_get_filename ("example-v04.xml.gz");
+	file = g_file_new_for_path (filename);
+	store = as_store_new ();
+	ret = as_store_from_file (store, file, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* this checks every category, environment, icon and license */
+	timer = g_timer_new ();
+	for (i = 0; i < loops; i++) {
+		_cleanup_ptrarray_unref_ GPtrArray *probs = NULL;
+		probs = as_store_validate (store,
+					   AS_APP_VALIDATE_FLAG_ALL_APPS |
+					   AS_APP_VALIDATE_FLAG_NO_NETWORK,
+					   &error);
+		g_assert_no_error (error);
+		g_assert (probs != NULL);
+	}
+	g_print ("%.0f ms: ", g_timer_elapsed (timer, NULL) * 1000 / loops);
+}
+
+static void
+as_test_store_search_fuzzy_func (void)
+{
+	AsApp *app;
+	GError *error = NULL;
+	gboolean ret;
+	const gchar *typo[] = { "libreofice", NULL };
+	const gchar *typos[] = { "libreofice", "writter", NULL };
+	const gchar *prefix[] = { "libreof", NULL };
+	const gchar *exact[] = { "calc", NULL };
+	const gchar *merged[] = { "notepad", NULL };
+	const gchar *xml =
+		"<components version=\"0.6\">"
+		"<component type=\"desktop\">"
+		"<id>libreoffice-writer.desktop</id>"
+		"<name>LibreOffice Writer</name>"
+		"<summary>Create and edit text documents</summary>"
+		"</component>"
+		"<component type=\"desktop\">"
+		"<id>libreoffice-calc.desktop</id>"
+		"<name>LibreOffice Calc</name>"
+		"<summary>Perform calculations and analyze information</summary>"
+		"</component>"
+		"<component type=\"desktop\">"
+		"<id>gedit.desktop</id>"
+		"<name>Text Editor</name>"
+		"<summary>Edit text files</summary>"
+		"</component>"
+		"</components>";
+	_cleanup_object_unref_ AsApp *app_dup = NULL;
+	_cleanup_object_unref_ AsStore *store = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *apps1 = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *apps2 = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *apps3 = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *apps4 = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *apps5 = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *apps6 = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *apps7 = NULL;
+
+	store = as_store_new ();
+	ret = as_store_from_xml (store, xml, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* no edits allowed */
+	apps1 = as_store_search_fuzzy (store, (gchar **) typo, 0, 0);
+	g_assert_cmpint (apps1->len, ==, 0);
+
+	/* one edit allowed */
+	apps2 = as_store_search_fuzzy (store, (gchar **) typo, 1, 0);
+	g_assert_cmpint (apps2->len, ==, 2);
+
+	/* all terms have to match */
+	apps3 = as_store_search_fuzzy (store, (gchar **) typos, 1, 0);
+	g_assert_cmpint (apps3->len, ==, 1);
+	app = g_ptr_array_index (apps3, 0);
+	g_assert_cmpstr (as_app_get_id (app), ==, "libreoffice-writer.desktop");
+
+	/* exact matches still work */
+	apps4 = as_store_search_fuzzy (store, (gchar **) exact, 2, 0);
+	g_assert_cmpint (apps4->len, >=, 1);
+	app = g_ptr_array_index (apps4, 0);
+	g_assert_cmpstr (as_app_get_id (app), ==, "libreoffice-calc.desktop");
+
+	/* the start of a word matches without any edits */
+	apps7 = as_store_search_fuzzy (store, (gchar **) prefix, 0, 0);
+	g_assert_cmpint (apps7->len, ==, 2);
+
+	/* keywords merged from a duplicate are found */
+	apps5 = as_store_search_fuzzy (store, (gchar **) merged, 0, 0);
+	g_assert_cmpint (apps5->len, ==, 0);
+	app_dup = as_app_new ();
+	as_app_set_id (app_dup, "gedit.desktop");
+	as_app_set_source_kind (app_dup, AS_APP_SOURCE_KIND_APPSTREAM);
+	as_app_add_keyword (app_dup, "C", "notepad");
+	as_store_add_app (store, app_dup);
+	g_assert_cmpint (as_store_get_size (store), ==, 3);
+	apps6 = as_store_search_fuzzy (store, (gchar **) merged, 0, 0);
+	g_assert_cmpint (apps6->len, ==, 1);
+	app = g_ptr_array_index (apps6, 0);
+	g_assert_cmpstr (as_app_get_id (app), ==, "gedit.desktop");
+}
+
+static void
+as_test_store_speed_search_fuzzy_func (void)
+{
+	guint i;
+	guint loops = 10;
+	const gchar *search[] = { "chnage", NULL };
+	_cleanup_object_unref_ AsStore *store = NULL;
+	_cleanup_timer_destroy_ GTimer *timer = NULL;
+
+	/* a large vocabulary of distinct words */
+	store = as_store_new ();
+	for (i = 0; i < 10000; i++) {
+		_cleanup_free_ gchar *id = NULL;
+		_cleanup_free_ gchar *name = NULL;
+		_cleanup_object_unref_ AsApp *app = NULL;
+		id = g_strdup_printf ("app%05u.desktop", i);
+		name = g_strdup_printf ("Editor%05u", i);
+		app = as_app_new ();
+		as_app_set_id (app, id);
+		as_app_set_name (app, NULL, name);
+		as_app_set_comment (app, NULL, "Change text files");
+		as_store_add_app (store, app);
+	}
+
+	/* the index is only built once */
+	timer = g_timer_new ();
+	for (i = 0; i < loops; i++) {
+		_cleanup_ptrarray_unref_ GPtrArray *apps = NULL;
+		apps = as_store_search_fuzzy (store, (gchar **) search, 2, 10);
+		g_assert_cmpint (apps->len, ==, 10);
+		if (i == 0) {
+			g_print ("%.0f ms index, ",
+				 g_timer_elapsed (timer, NULL) * 1000);
+			g_timer_reset (timer);
+		}
+	}
+	g_print ("%.1f ms: ", g_timer_elapsed (timer, NULL) * 1000 / (loops - 1));
+}
+
+static void
+as_test_store_search_parallel_func (void)
 {
-	AsApp *app;
 	GError *error = NULL;
 	gboolean ret;
+	guint i;
+	guint j;
+	const guint max_results[] = { 0, 10, 1 };
+	const gchar *search[] = { "gnome", NULL };
 	_cleanup_free_ gchar *filename = NULL;
 	_cleanup_object_unref_ AsStore *store = NULL;
 	_cleanup_object_unref_ GFile *file = NULL;
 
-	/* load a file to the store */
-	store = as_store_new ();
-	filename = as_test_get_filename ("origin.xml");
+	filename = as_test_get_filename ("example-v04.xml.gz");
 	file = g_file_new_for_path (filename);
+	store = as_store_new ();
 	ret = as_store_from_file (store, file, NULL, NULL, &error);
 	g_assert_no_error (error);
 	g_assert (ret);
 
-	/* test icon path */
-	g_assert_cmpstr (as_store_get_origin (store), ==, "fedora-21");
-	g_assert_cmpint (as_store_get_size (store), ==, 1);
-	app = as_store_get_app_by_id (store, "test.desktop");
-	g_assert (app != NULL);
-	g_assert_cmpstr (as_app_get_icon_path (app), ==,
-		"/usr/share/app-info/icons/fedora-21");
-	g_assert_cmpstr (as_app_get_origin (app), ==, "fedora-21");
-	g_assert_cmpstr (as_app_get_source_file (app), ==, filename);
+	/* the parallel search has to return exactly the same results */
+	for (i = 0; i < G_N_ELEMENTS (max_results); i++) {
+		_cleanup_ptrarray_unref_ GPtrArray *apps1 = NULL;
+		_cleanup_ptrarray_unref_ GPtrArray *apps2 = NULL;
+		apps1 = as_store_search (store, (gchar **) search, max_results[i]);
+		apps2 = as_store_search_parallel (store, (gchar **) search,
+						  max_results[i], 4);
+		g_assert_cmpint (apps1->len, >, 0);
+		g_assert_cmpint (apps1->len, ==, apps2->len);
+		if (max_results[i] > 0)
+			g_assert_cmpint (apps1->len, <=, max_results[i]);
+		for (j = 0; j < apps1->len; j++) {
+			g_assert (g_ptr_array_index (apps1, j) ==
+				  g_ptr_array_index (apps2, j));
+		}
+	}
 }
 
 static void
-as_test_store_speed_appstream_func (void)
+as_test_store_speed_appdata_func (void)
 {
 	GError *error = NULL;
 	gboolean ret;
 	guint i;
 	guint loops = 10;
 	_cleanup_free_ gchar *filename = NULL;
-	_cleanup_object_unref_ GFile *file = NULL;
 	_cleanup_timer_destroy_ GTimer *timer = NULL;
 
-	filename = as_test_get_filename ("example-v04.xml.gz");
-	file = g_file_new_for_path (filename);
+	filename = as_test_get_filename (".");
 	timer = g_timer_new ();
 	for (i = 0; i < loops; i++) {
 		_cleanup_object_unref_ AsStore *store = NULL;
 		store = as_store_new ();
-		ret = as_store_from_file (store, file, NULL, NULL, &error);
+		as_store_set_destdir (store, filename);
+		g_test_expect_message (G_LOG_DOMAIN,
+				       G_LOG_LEVEL_WARNING,
+				       "ignoring description '*' from */broken.appdata.xml: Unknown tag '_p'");
+		ret = as_store_load (store, AS_STORE_LOAD_FLAG_APPDATA, NULL, &error);
 		g_assert_no_error (error);
 		g_assert (ret);
-		g_assert_cmpint (as_store_get_apps (store)->len, >=, 1415);
-		g_assert (as_store_get_app_by_id (store, "org.gnome.Software.desktop") != NULL);
-		g_assert (as_store_get_app_by_pkgname (store, "gnome-software") != NULL);
+		g_assert_cmpint (as_store_get_apps (store)->len, >, 0);
 	}
 	g_print ("%.0f ms: ", g_timer_elapsed (timer, NULL) * 1000 / loops);
 }
 
 static void
-as_test_store_speed_appdata_func (void)
+as_test_store_speed_merge_func (void)
 {
-	GError *error = NULL;
-	gboolean ret;
 	guint i;
+	guint j;
 	guint loops = 10;
-	_cleanup_free_ gchar *filename = NULL;
+	const gchar *locales[] = { "C", "ar", "ca", "cs", "da", "de", "el",
+				   "en_GB", "es", "eu", "fi", "fr", "gl",
+				   "he", "hu", "id", "it", "ja", "ko", "lt",
+				   "nb", "nl", "pl", "pt_BR", "ru", "sk",
+				   "sr", "sv", "tr", "uk", "zh_CN", NULL };
+	_cleanup_ptrarray_unref_ GPtrArray *apps = NULL;
 	_cleanup_timer_destroy_ GTimer *timer = NULL;
 
-	filename = as_test_get_filename (".");
+	/* installed desktop files and AppData with the same IDs */
+	apps = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (i = 0; i < 500; i++) {
+		AsApp *desktop;
+		AsApp *appdata;
+		_cleanup_free_ gchar *id = NULL;
+		id = g_strdup_printf ("app%04u.desktop", i);
+		desktop = as_app_new ();
+		as_app_set_id (desktop, id);
+		as_app_set_source_kind (desktop, AS_APP_SOURCE_KIND_DESKTOP);
+		as_app_add_category (desktop, "Utility");
+		appdata = as_app_new ();
+		as_app_set_id (appdata, id);
+		as_app_set_source_kind (appdata, AS_APP_SOURCE_KIND_APPDATA);
+		for (j = 0; locales[j] != NULL; j++) {
+			as_app_set_name (desktop, locales[j], "Application name");
+			as_app_set_comment (desktop, locales[j], "Application summary");
+			as_app_set_description (appdata, locales[j],
+						"<p>This is a long translated "
+						"description of the application "
+						"that would be shown in a "
+						"software center.</p>");
+		}
+		g_ptr_array_add (apps, desktop);
+		g_ptr_array_add (apps, appdata);
+	}
+
+	/* merge them all */
 	timer = g_timer_new ();
 	for (i = 0; i < loops; i++) {
 		_cleanup_object_unref_ AsStore *store = NULL;
 		store = as_store_new ();
-		as_store_set_destdir (store, filename);
-		g_test_expect_message (G_LOG_DOMAIN,
-				       G_LOG_LEVEL_WARNING,
-				       "ignoring description '*' from */broken.appdata.xml: Unknown tag '_p'");
-		ret = as_store_load (store, AS_STORE_LOAD_FLAG_APPDATA, NULL, &error);
-		g_assert_no_error (error);
-		g_assert (ret);
-		g_assert_cmpint (as_store_get_apps (store)->len, >, 0);
+		for (j = 0; j < apps->len; j++) {
+			AsApp *tmp = g_ptr_array_index (apps, j);
+			_cleanup_object_unref_ AsApp *app = NULL;
+			app = as_app_new ();
+			as_app_set_id (app, as_app_get_id (tmp));
+			as_app_set_source_kind (app, as_app_get_source_kind (tmp));
+			as_app_subsume (app, tmp);
+			as_store_add_app (store, app);
+		}
+		g_assert_cmpint (as_store_get_size (store), ==, 500);
 	}
 	g_print ("%.0f ms: ", g_timer_elapsed (timer, NULL) * 1000 / loops);
 }
@@ -3359,6 +4708,102 @@ as_test_utils_spdx_token_func (void)
 	g_assert (as_utils_is_spdx_license ("CC0 and GFDL-1.3"));
 	g_assert (as_utils_is_spdx_license ("CC0 AND GFDL-1.3"));
 	g_assert (!as_utils_is_spdx_license ("CC0 dave"));
+
+	/* SPDX license IDs */
+	g_assert (as_utils_is_spdx_license_id ("CC0-1.0"));
+	g_assert (as_utils_is_spdx_license_id ("GPL-2.0+"));
+	g_assert (!as_utils_is_spdx_license_id ("GPL-2.0-dave"));
+	g_assert (!as_utils_is_spdx_license_id ("GPL"));
+	g_assert (!as_utils_is_spdx_license_id (""));
+
+	/* remembered results are copies and still correct */
+	tok = as_utils_spdx_license_tokenize ("CC0 and GFDL-1.3");
+	g_free (tok[0]);
+	tok[0] = g_strdup ("dave");
+	g_strfreev (tok);
+	tok = as_utils_spdx_license_tokenize ("CC0 and GFDL-1.3");
+	tmp = g_strjoinv ("  ", tok);
+	g_assert_cmpstr (tmp, ==, "@CC0-1.0  &  @GFDL-1.3");
+	g_strfreev (tok);
+	g_free (tmp);
+	g_assert (as_utils_is_spdx_license ("CC0 and GFDL-1.3"));
+	g_assert (!as_utils_is_spdx_license ("CC0 dave"));
+}
+
+static void
+as_test_utils_spdx_speed_func (void)
+{
+	_cleanup_timer_destroy_ GTimer *timer = NULL;
+	guint i;
+	guint loops = 10000;
+
+	timer = g_timer_new ();
+	for (i = 0; i < loops; i++) {
+		g_assert (as_utils_is_spdx_license ("LGPL-2.0+ AND (GPL-2.0 OR MIT)"));
+		g_assert (!as_utils_is_spdx_license ("LGPLv2+ and (QPL or GPLv2)"));
+	}
+	g_print ("%.0f ns: ", g_timer_elapsed (timer, NULL) * 1000000000 / (loops * 2));
+}
+
+/* the matcher used before the blacklist was compiled */
+static gboolean
+as_test_utils_blacklisted_id_fnmatch (const gchar *desktop_id)
+{
+	guint i;
+	_cleanup_bytes_unref_ GBytes *data = NULL;
+	_cleanup_strv_free_ gchar **split = NULL;
+
+	data = g_resource_lookup_data (as_get_resource (),
+				       "/org/freedesktop/appstream-glib/as-blacklist-ids.txt",
+				       G_RESOURCE_LOOKUP_FLAGS_NONE,
+				       NULL);
+	g_assert (data != NULL);
+	split = g_strsplit (g_bytes_get_data (data, NULL), "\n", -1);
+	for (i = 0; split[i] != NULL; i++) {
+		if (fnmatch (split[i], desktop_id, 0) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+as_test_utils_blacklist_speed_func (void)
+{
+	_cleanup_timer_destroy_ GTimer *timer = NULL;
+	gdouble elapsed_compiled;
+	gdouble elapsed_fnmatch;
+	guint i;
+	guint j;
+	guint loops = 1000;
+	const gchar *ids[] = { "gimp.desktop",
+			       "active-about.desktop",
+			       "kcmshell.desktop",
+			       "doom-shareware-demo.desktop",
+			       "org.gnome.Software.desktop",
+			       "zzz.desktop",
+			       NULL };
+
+	/* both give the same answer */
+	for (j = 0; ids[j] != NULL; j++) {
+		g_assert_cmpint (as_utils_is_blacklisted_id (ids[j]), ==,
+				 as_test_utils_blacklisted_id_fnmatch (ids[j]));
+	}
+
+	timer = g_timer_new ();
+	for (i = 0; i < loops; i++) {
+		for (j = 0; ids[j] != NULL; j++)
+			as_test_utils_blacklisted_id_fnmatch (ids[j]);
+	}
+	elapsed_fnmatch = g_timer_elapsed (timer, NULL);
+	g_timer_reset (timer);
+	for (i = 0; i < loops; i++) {
+		for (j = 0; ids[j] != NULL; j++)
+			as_utils_is_blacklisted_id (ids[j]);
+	}
+	elapsed_compiled = g_timer_elapsed (timer, NULL);
+	g_print ("%.0f ns vs %.0f ns: ",
+		 elapsed_compiled * 1000000000 / (loops * 6),
+		 elapsed_fnmatch * 1000000000 / (loops * 6));
 }
 
 static void
@@ -3368,6 +4813,7 @@ as_test_utils_func (void)
 	gchar *tmp;
 	gchar **tokens;
 	GError *error = NULL;
+	GString *str;
 
 	/* as_utils_is_stock_icon_name */
 	g_assert (!as_utils_is_stock_icon_name (NULL));
@@ -3376,6 +4822,7 @@ as_test_utils_func (void)
 	g_assert (as_utils_is_stock_icon_name ("accessories-calculator"));
 	g_assert (as_utils_is_stock_icon_name ("insert-image"));
 	g_assert (as_utils_is_stock_icon_name ("zoom-out"));
+	g_assert (as_utils_is_stock_icon_name ("computer"));
 
 	/* environments */
 	g_assert (as_utils_is_environment_id ("GNOME"));
@@ -3384,11 +4831,36 @@ as_test_utils_func (void)
 	/* categories */
 	g_assert (as_utils_is_category_id ("AudioVideoEditing"));
 	g_assert (!as_utils_is_category_id ("SpellEditing"));
+	g_assert (!as_utils_is_category_id (""));
 
 	/* blacklist */
 	g_assert (as_utils_is_blacklisted_id ("gnome-system-monitor-kde.desktop"));
 	g_assert (as_utils_is_blacklisted_id ("doom-*-demo.desktop"));
 	g_assert (!as_utils_is_blacklisted_id ("gimp.desktop"));
+	g_assert (as_utils_is_blacklisted_id ("active-about.desktop"));
+	g_assert (as_utils_is_blacklisted_id ("kcmshell.desktop"));
+	g_assert (!as_utils_is_blacklisted_id (NULL));
+
+	/* site-specific blacklist */
+	g_assert (!as_utils_is_blacklisted_id ("as-self-test-site.desktop"));
+	as_utils_add_blacklisted_id ("as-self-test-site.desktop");
+	as_utils_add_blacklisted_id ("as-self-test-*-helper.desktop");
+	as_utils_add_blacklisted_id ("*-as-self-test-[0-9].desktop");
+	g_assert (as_utils_is_blacklisted_id ("as-self-test-site.desktop"));
+	g_assert (as_utils_is_blacklisted_id ("as-self-test-foo-helper.desktop"));
+	g_assert (as_utils_is_blacklisted_id ("foo-as-self-test-3.desktop"));
+	g_assert (!as_utils_is_blacklisted_id ("as-self-test-foo.desktop"));
+	g_assert (!as_utils_is_blacklisted_id ("foo-as-self-test-x.desktop"));
+	g_assert (!as_utils_is_blacklisted_id ("gimp.desktop"));
+	g_assert (as_utils_remove_blacklisted_id ("as-self-test-site.desktop"));
+	g_assert (as_utils_remove_blacklisted_id ("as-self-test-*-helper.desktop"));
+	g_assert (as_utils_remove_blacklisted_id ("*-as-self-test-[0-9].desktop"));
+	g_assert (!as_utils_remove_blacklisted_id ("as-self-test-site.desktop"));
+	g_assert (!as_utils_remove_blacklisted_id ("kcm*.desktop"));
+	g_assert (!as_utils_is_blacklisted_id ("as-self-test-site.desktop"));
+	g_assert (!as_utils_is_blacklisted_id ("as-self-test-foo-helper.desktop"));
+	g_assert (!as_utils_is_blacklisted_id ("foo-as-self-test-3.desktop"));
+	g_assert (as_utils_is_blacklisted_id ("kcmshell.desktop"));
 
 	/* valid description markup */
 	tmp = as_markup_convert_simple ("<p>Hello world!</p>", &error);
@@ -3434,6 +4906,24 @@ as_test_utils_func (void)
 	g_assert_cmpstr (tmp, ==, NULL);
 	g_clear_error (&error);
 
+	/* appending to an existing buffer */
+	str = g_string_new ("Description: ");
+	ret = as_markup_convert_to_string ("<p>Hello\n  world</p>"
+					   "<ol><li>One</li><li>Two</li></ol>",
+					   -1, AS_MARKUP_CONVERT_FORMAT_SIMPLE,
+					   str, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpstr (str->str, ==, "Description: Hello world\n • One\n • Two");
+	g_string_truncate (str, 0);
+	ret = as_markup_convert_to_string ("<p>Hello</p><li>Item</li>", -1,
+					   AS_MARKUP_CONVERT_FORMAT_SIMPLE,
+					   str, &error);
+	g_assert_error (error, AS_NODE_ERROR, AS_NODE_ERROR_FAILED);
+	g_assert (!ret);
+	g_clear_error (&error);
+	g_string_free (str, TRUE);
+
 	/* invalid URLs */
 	ret = as_utils_check_url_exists ("hello dave", 1, &error);
 	g_assert (!ret);
@@ -3549,6 +5039,15 @@ as_test_store_metadata_index_func (void)
 	g_print ("%.0fms: ", g_timer_elapsed (timer, NULL) * 1000);
 }
 
+static gboolean
+as_test_yaml_count_cb (GNode *node, gpointer user_data, GError **error)
+{
+	guint *cnt = (guint *) user_data;
+	g_assert (node->children != NULL);
+	(*cnt)++;
+	return TRUE;
+}
+
 static void
 as_test_yaml_func (void)
 {
@@ -3556,6 +5055,8 @@ as_test_yaml_func (void)
 	GError *error = NULL;
 	GString *str;
 	const gchar *expected;
+	gboolean ret;
+	guint cnt = 0;
 	_cleanup_free_ gchar *filename = NULL;
 	_cleanup_object_unref_ GFile *file = NULL;
 
@@ -3657,6 +5158,17 @@ as_test_yaml_func (void)
 	g_string_free (str, TRUE);
 	as_yaml_unref (node);
 
+	/* one document at a time */
+	ret = as_yaml_from_file_foreach (file, as_test_yaml_count_cb, &cnt, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (cnt, ==, 3);
+
+	/* invalid */
+	node = as_yaml_from_data ("Name: [\n", -1, &error);
+	g_assert_error (error, AS_NODE_ERROR, AS_NODE_ERROR_FAILED);
+	g_assert (node == NULL);
+	g_clear_error (&error);
 }
 
 static void
@@ -3724,6 +5236,301 @@ as_test_store_yaml_func (void)
 	g_assert_cmpstr (as_app_get_origin (app), ==, "aequorea");
 }
 
+static void
+as_test_store_yaml_write_func (void)
+{
+	GError *error = NULL;
+	gboolean ret;
+	guint i;
+	const gchar *tmpfiles[] = { "/tmp/as-self-test.yml",
+				    "/tmp/as-self-test.yml.gz",
+				    NULL };
+	_cleanup_free_ gchar *filename = NULL;
+	_cleanup_free_ gchar *icon_root = NULL;
+	_cleanup_object_unref_ AsStore *store = NULL;
+	_cleanup_object_unref_ GFile *file = NULL;
+	_cleanup_string_free_ GString *xml = NULL;
+
+	/* load store */
+	store = as_store_new ();
+	filename = as_test_get_filename ("example.yml");
+	icon_root = as_test_get_filename ("usr/share/app-install/icons");
+	file = g_file_new_for_path (filename);
+	ret = as_store_from_file (store, file, icon_root, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	xml = as_store_to_xml (store, AS_NODE_TO_XML_FLAG_FORMAT_MULTILINE);
+
+	/* write it back as DEP-11 and load it again */
+	for (i = 0; tmpfiles[i] != NULL; i++) {
+		_cleanup_object_unref_ AsStore *store2 = NULL;
+		_cleanup_object_unref_ GFile *file2 = NULL;
+		_cleanup_string_free_ GString *xml2 = NULL;
+
+		file2 = g_file_new_for_path (tmpfiles[i]);
+		ret = as_store_to_file (store, file2, AS_NODE_TO_XML_FLAG_NONE, NULL, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+
+		store2 = as_store_new ();
+		ret = as_store_from_file (store2, file2, icon_root, NULL, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+		g_assert_cmpstr (as_store_get_origin (store2), ==, "aequorea");
+		g_assert_cmpint (as_store_get_size (store2), ==, 2);
+		xml2 = as_store_to_xml (store2, AS_NODE_TO_XML_FLAG_FORMAT_MULTILINE);
+		g_assert_cmpstr (xml2->str, ==, xml->str);
+		g_unlink (tmpfiles[i]);
+	}
+}
+
+static void
+as_test_store_yaml_write_quoted_func (void)
+{
+	AsApp *app;
+	GError *error = NULL;
+	gboolean ret;
+	const gchar *tmpfile = "/tmp/as-self-test-quoted.yml";
+	_cleanup_free_ gchar *data = NULL;
+	_cleanup_object_unref_ AsApp *app_tmp = NULL;
+	_cleanup_object_unref_ AsStore *store = NULL;
+	_cleanup_object_unref_ AsStore *store2 = NULL;
+	_cleanup_object_unref_ GFile *file = NULL;
+
+	/* values that look like a float or a boolean */
+	store = as_store_new ();
+	as_store_set_api_version (store, 0.8);
+	app_tmp = as_app_new ();
+	as_app_set_id (app_tmp, "test.desktop");
+	as_app_set_id_kind (app_tmp, AS_ID_KIND_DESKTOP);
+	as_app_set_name (app_tmp, "C", "yes");
+	as_app_set_name (app_tmp, "no", "Nei");
+	as_app_add_keyword (app_tmp, "no", "nei");
+	as_app_add_pkgname (app_tmp, "1.10");
+	as_store_add_app (store, app_tmp);
+	file = g_file_new_for_path (tmpfile);
+	ret = as_store_to_file (store, file, AS_NODE_TO_XML_FLAG_NONE, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* keys are plain unless they look like a boolean, values are quoted */
+	ret = g_file_get_contents (tmpfile, &data, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert (g_strstr_len (data, -1, "Version: '0.8'") != NULL);
+	g_assert (g_strstr_len (data, -1, "C: 'yes'") != NULL);
+	g_assert (g_strstr_len (data, -1, "'no': 'Nei'") != NULL);
+	g_assert (g_strstr_len (data, -1, "'no':\n") != NULL);
+	g_assert (g_strstr_len (data, -1, "- '1.10'") != NULL);
+
+	/* and they survive the round trip */
+	store2 = as_store_new ();
+	ret = as_store_from_file (store2, file, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	app = as_store_get_app_by_id (store2, "test.desktop");
+	g_assert (app != NULL);
+	g_assert_cmpstr (as_app_get_name (app, "C"), ==, "yes");
+	g_assert_cmpstr (as_app_get_name (app, "no"), ==, "Nei");
+	g_assert_cmpint (as_app_get_keywords (app, "no")->len, ==, 1);
+	g_assert_cmpstr (as_app_get_pkgname_default (app), ==, "1.10");
+	g_unlink (tmpfile);
+}
+
+static void
+as_test_store_convert_descriptions_func (void)
+{
+	guint i;
+	_cleanup_object_unref_ AsStore *store = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *results1 = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *results2 = NULL;
+
+	store = as_store_new ();
+	for (i = 0; i < 100; i++) {
+		_cleanup_free_ gchar *desc = NULL;
+		_cleanup_free_ gchar *id = NULL;
+		_cleanup_object_unref_ AsApp *app = NULL;
+		app = as_app_new ();
+		id = g_strdup_printf ("app%03u.desktop", i);
+		as_app_set_id (app, id);
+		if (i % 10 == 1) {
+			as_app_set_description (app, "C", "<p>Unclosed");
+		} else if (i % 10 != 0) {
+			desc = g_strdup_printf ("<p>App %u</p><ul><li>Item</li></ul>", i);
+			as_app_set_description (app, "C", desc);
+		}
+		as_store_add_app (store, app);
+	}
+
+	/* serial and parallel give the same results */
+	results1 = as_store_convert_descriptions (store, "C",
+						  AS_MARKUP_CONVERT_FORMAT_SIMPLE, 1);
+	results2 = as_store_convert_descriptions (store, "C",
+						  AS_MARKUP_CONVERT_FORMAT_SIMPLE, 4);
+	g_assert_cmpint (results1->len, ==, 100);
+	g_assert_cmpint (results2->len, ==, 100);
+	for (i = 0; i < results1->len; i++) {
+		g_assert_cmpstr (g_ptr_array_index (results1, i), ==,
+				 g_ptr_array_index (results2, i));
+	}
+	g_assert_cmpstr (g_ptr_array_index (results1, 0), ==, NULL);
+	g_assert_cmpstr (g_ptr_array_index (results1, 1), ==, NULL);
+	g_assert_cmpstr (g_ptr_array_index (results1, 2), ==, "App 2\n • Item");
+}
+
+static void
+as_test_store_installed_parallel_func (void)
+{
+	GError *error = NULL;
+	GPtrArray *apps1;
+	GPtrArray *apps2;
+	gboolean ret;
+	guint i;
+	const gchar *tmpdir = "/tmp/as-self-test-appdata";
+	_cleanup_object_unref_ AsStore *store1 = NULL;
+	_cleanup_object_unref_ AsStore *store2 = NULL;
+	_cleanup_string_free_ GString *xml1 = NULL;
+	_cleanup_string_free_ GString *xml2 = NULL;
+
+	/* lots of small AppData files */
+	g_mkdir_with_parents (tmpdir, 0700);
+	for (i = 0; i < 50; i++) {
+		_cleanup_free_ gchar *data = NULL;
+		_cleanup_free_ gchar *filename = NULL;
+		filename = g_strdup_printf ("%s/app%02u.appdata.xml", tmpdir, i);
+		data = g_strdup_printf ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+					"<component type=\"desktop\">\n"
+					"<id>app%02u.desktop</id>\n"
+					"<name>App %u</name>\n"
+					"<summary>Summary %u</summary>\n"
+					"</component>\n", i, i, i);
+		ret = g_file_set_contents (filename, data, -1, &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+	}
+
+	/* load serially */
+	store1 = as_store_new ();
+	ret = as_store_load_path (store1, tmpdir, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* load in parallel */
+	store2 = as_store_new ();
+	as_store_set_max_threads (store2, 4);
+	ret = as_store_load_path (store2, tmpdir, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* same applications and order */
+	apps1 = as_store_get_apps (store1);
+	apps2 = as_store_get_apps (store2);
+	g_assert_cmpint (apps2->len, ==, 50);
+	g_assert_cmpint (apps1->len, ==, apps2->len);
+	for (i = 0; i < apps1->len; i++) {
+		AsApp *app1 = g_ptr_array_index (apps1, i);
+		AsApp *app2 = g_ptr_array_index (apps2, i);
+		g_assert_cmpstr (as_app_get_id (app1), ==, as_app_get_id (app2));
+		g_assert_cmpint (as_app_get_state (app2), ==, AS_APP_STATE_INSTALLED);
+	}
+	xml1 = as_store_to_xml (store1, AS_NODE_TO_XML_FLAG_NONE);
+	xml2 = as_store_to_xml (store2, AS_NODE_TO_XML_FLAG_NONE);
+	g_assert_cmpstr (xml1->str, ==, xml2->str);
+}
+
+static void
+as_test_store_yaml_truncated_func (void)
+{
+	gboolean ret;
+	guint i;
+	guint threads[] = { 1, 4 };
+	const gchar *tmpfile = "/tmp/as-self-test-truncated.yml";
+	_cleanup_object_unref_ GFile *file = NULL;
+
+	/* the second component is cut off in the middle of a value */
+	ret = g_file_set_contents (tmpfile,
+				   "---\n"
+				   "File: DEP-11\n"
+				   "Origin: aequorea\n"
+				   "Version: '0.8'\n"
+				   "---\n"
+				   "Type: desktop-app\n"
+				   "ID: dave.desktop\n"
+				   "Name:\n"
+				   "  C: dave\n"
+				   "---\n"
+				   "Type: desktop-app\n"
+				   "ID: iceweasel.desktop\n"
+				   "Name:\n"
+				   "  C: \"Icewea", -1, NULL);
+	g_assert (ret);
+	file = g_file_new_for_path (tmpfile);
+
+	/* nothing is added, whether parsed serially or in parallel */
+	for (i = 0; i < G_N_ELEMENTS (threads); i++) {
+		GError *error = NULL;
+		_cleanup_object_unref_ AsStore *store = as_store_new ();
+		as_store_set_max_threads (store, threads[i]);
+		ret = as_store_from_file (store, file, NULL, NULL, &error);
+		g_assert (error != NULL);
+		g_assert (!ret);
+		g_clear_error (&error);
+		g_assert_cmpint (as_store_get_size (store), ==, 0);
+	}
+	g_unlink (tmpfile);
+}
+
+static void
+as_test_store_yaml_parallel_func (void)
+{
+	GError *error = NULL;
+	GPtrArray *apps1;
+	GPtrArray *apps2;
+	gboolean ret;
+	guint i;
+	_cleanup_free_ gchar *filename = NULL;
+	_cleanup_object_unref_ AsStore *store1 = NULL;
+	_cleanup_object_unref_ AsStore *store2 = NULL;
+	_cleanup_object_unref_ GFile *file = NULL;
+	_cleanup_string_free_ GString *xml1 = NULL;
+	_cleanup_string_free_ GString *xml2 = NULL;
+
+	filename = as_test_get_filename ("example-v06.yml.gz");
+	g_assert (filename != NULL);
+	file = g_file_new_for_path (filename);
+
+	/* load serially */
+	store1 = as_store_new ();
+	ret = as_store_from_file (store1, file, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* load in parallel */
+	store2 = as_store_new ();
+	as_store_set_max_threads (store2, 4);
+	g_assert_cmpint (as_store_get_max_threads (store2), ==, 4);
+	ret = as_store_from_file (store2, file, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+
+	/* same header, applications and order */
+	g_assert_cmpstr (as_store_get_origin (store2), ==, "bartholomea");
+	g_assert_cmpfloat (as_store_get_api_version (store2), <, 0.6 + 0.01);
+	g_assert_cmpfloat (as_store_get_api_version (store2), >, 0.6 - 0.01);
+	apps1 = as_store_get_apps (store1);
+	apps2 = as_store_get_apps (store2);
+	g_assert_cmpint (apps2->len, ==, 85);
+	g_assert_cmpint (apps1->len, ==, apps2->len);
+	for (i = 0; i < apps1->len; i++) {
+		AsApp *app1 = g_ptr_array_index (apps1, i);
+		AsApp *app2 = g_ptr_array_index (apps2, i);
+		g_assert_cmpstr (as_app_get_id (app1), ==, as_app_get_id (app2));
+	}
+	xml1 = as_store_to_xml (store1, AS_NODE_TO_XML_FLAG_NONE);
+	xml2 = as_store_to_xml (store2, AS_NODE_TO_XML_FLAG_NONE);
+	g_assert_cmpstr (xml1->str, ==, xml2->str);
+}
+
 static void
 as_test_store_speed_yaml_func (void)
 {
@@ -3782,6 +5589,86 @@ as_test_utils_vercmp_func (void)
 	g_assert_cmpint (as_utils_vercmp (NULL, NULL), ==, G_MAXINT);
 }
 
+static void
+as_test_utils_vercmp_key_func (void)
+{
+	guint i;
+	guint j;
+	const gchar *versions[] = { "",
+				    "0",
+				    "1",
+				    "1.",
+				    "1.0",
+				    "1.2",
+				    "1.02",
+				    "1.2.3",
+				    "1.2.3.1",
+				    "1.2.4",
+				    "1.10",
+				    "1.2xxx.3",
+				    "1.2a.3",
+				    "1.2b.3",
+				    "1.2.-3",
+				    "1.-0",
+				    "2.x",
+				    "255.256",
+				    "65536",
+				    "99999999999999999999",
+				    NULL };
+
+	/* keys compare exactly like the strings */
+	for (i = 0; versions[i] != NULL; i++) {
+		_cleanup_bytes_unref_ GBytes *key_a = NULL;
+		key_a = as_utils_version_key (versions[i]);
+		g_assert (key_a != NULL);
+		for (j = 0; versions[j] != NULL; j++) {
+			_cleanup_bytes_unref_ GBytes *key_b = NULL;
+			key_b = as_utils_version_key (versions[j]);
+			g_assert_cmpint (as_utils_vercmp_key (key_a, key_b), ==,
+					 as_utils_vercmp (versions[i], versions[j]));
+		}
+	}
+
+	/* invalid */
+	g_assert (as_utils_version_key (NULL) == NULL);
+	g_assert_cmpint (as_utils_vercmp_key (NULL, NULL), ==, G_MAXINT);
+}
+
+static void
+as_test_utils_vercmp_speed_func (void)
+{
+	_cleanup_timer_destroy_ GTimer *timer = NULL;
+	gdouble elapsed_key;
+	gdouble elapsed_str;
+	guint i;
+	guint j;
+	guint loops = 10000;
+	const gchar *versions[] = { "3.16.0", "3.16.1", "3.14.2", "3.16.1.1", NULL };
+	GBytes *keys[4];
+
+	for (j = 0; versions[j] != NULL; j++)
+		keys[j] = as_utils_version_key (versions[j]);
+
+	timer = g_timer_new ();
+	for (i = 0; i < loops; i++) {
+		for (j = 0; j < 3; j++)
+			as_utils_vercmp (versions[j], versions[j + 1]);
+	}
+	elapsed_str = g_timer_elapsed (timer, NULL);
+	g_timer_reset (timer);
+	for (i = 0; i < loops; i++) {
+		for (j = 0; j < 3; j++)
+			as_utils_vercmp_key (keys[j], keys[j + 1]);
+	}
+	elapsed_key = g_timer_elapsed (timer, NULL);
+	g_print ("%.0f ns vs %.0f ns: ",
+		 elapsed_key * 1000000000 / (loops * 3),
+		 elapsed_str * 1000000000 / (loops * 3));
+
+	for (j = 0; j < 4; j++)
+		g_bytes_unref (keys[j]);
+}
+
 static void
 as_test_inf_func (void)
 {
@@ -4160,6 +6047,7 @@ main (int argc, char **argv)
 
 	/* tests go here */
 	g_test_add_func ("/AppStream/tag", as_test_tag_func);
+	g_test_add_func ("/AppStream/key", as_test_key_func);
 	g_test_add_func ("/AppStream/provide", as_test_provide_func);
 	g_test_add_func ("/AppStream/checksum", as_test_checksum_func);
 	g_test_add_func ("/AppStream/release", as_test_release_func);
@@ -4181,13 +6069,17 @@ main (int argc, char **argv)
 	g_test_add_func ("/AppStream/app{validate-meta-bad}", as_test_app_validate_meta_bad_func);
 	g_test_add_func ("/AppStream/app{validate-intltool}", as_test_app_validate_intltool_func);
 	g_test_add_func ("/AppStream/app{parse-file:desktop}", as_test_app_parse_file_desktop_func);
+	g_test_add_func ("/AppStream/app{parse-file:desktop-escapes}", as_test_app_parse_file_desktop_escapes_func);
 	g_test_add_func ("/AppStream/app{parse-file:inf}", as_test_app_parse_file_inf_func);
 	g_test_add_func ("/AppStream/app{no-markup}", as_test_app_no_markup_func);
+	g_test_add_func ("/AppStream/app{releases}", as_test_app_releases_func);
 	g_test_add_func ("/AppStream/app{subsume}", as_test_app_subsume_func);
+	g_test_add_func ("/AppStream/app{subsume-shared}", as_test_app_subsume_shared_func);
 	g_test_add_func ("/AppStream/app{search}", as_test_app_search_func);
 	g_test_add_func ("/AppStream/inf", as_test_inf_func);
 	g_test_add_func ("/AppStream/node", as_test_node_func);
 	g_test_add_func ("/AppStream/node{reflow}", as_test_node_reflow_text_func);
+	g_test_add_func ("/AppStream/node{reflow-fuzz}", as_test_node_reflow_text_fuzz_func);
 	g_test_add_func ("/AppStream/node{xml}", as_test_node_xml_func);
 	g_test_add_func ("/AppStream/node{hash}", as_test_node_hash_func);
 	g_test_add_func ("/AppStream/node{no-dup-c}", as_test_node_no_dup_c_func);
@@ -4201,22 +6093,41 @@ main (int argc, char **argv)
 	g_test_add_func ("/AppStream/utils{spdx-token}", as_test_utils_spdx_token_func);
 	g_test_add_func ("/AppStream/utils{install-filename}", as_test_utils_install_filename_func);
 	g_test_add_func ("/AppStream/utils{vercmp}", as_test_utils_vercmp_func);
+	g_test_add_func ("/AppStream/utils{vercmp-key}", as_test_utils_vercmp_key_func);
 	g_test_add_func ("/AppStream/monitor{dir}", as_test_monitor_dir_func);
 	g_test_add_func ("/AppStream/monitor{file}", as_test_monitor_file_func);
+	g_test_add_func ("/AppStream/monitor{dir-recreate}", as_test_monitor_dir_recreate_func);
+	g_test_add_func ("/AppStream/monitor{file-sibling}", as_test_monitor_file_sibling_func);
+	g_test_add_func ("/AppStream/monitor{batch}", as_test_monitor_batch_func);
 	g_test_add_func ("/AppStream/yaml", as_test_yaml_func);
 	g_test_add_func ("/AppStream/store", as_test_store_func);
 	g_test_add_func ("/AppStream/store{auto-reload-dir}", as_test_store_auto_reload_dir_func);
 	g_test_add_func ("/AppStream/store{auto-reload-file}", as_test_store_auto_reload_file_func);
+	g_test_add_func ("/AppStream/store{auto-reload-incremental}", as_test_store_auto_reload_incremental_func);
+	g_test_add_func ("/AppStream/store{auto-reload-background}", as_test_store_auto_reload_background_func);
+	g_test_add_func ("/AppStream/store{reload-background-superseded}", as_test_store_reload_background_superseded_func);
+	g_test_add_func ("/AppStream/store{reload-background-dispose}", as_test_store_reload_background_dispose_func);
 	g_test_add_func ("/AppStream/store{demote}", as_test_store_demote_func);
 	g_test_add_func ("/AppStream/store{merges}", as_test_store_merges_func);
 	g_test_add_func ("/AppStream/store{merges-local}", as_test_store_merges_local_func);
+	g_test_add_func ("/AppStream/store{dedup}", as_test_store_dedup_func);
+	g_test_add_func ("/AppStream/store{id-renames}", as_test_store_id_renames_func);
 	g_test_add_func ("/AppStream/store{addons}", as_test_store_addons_func);
 	g_test_add_func ("/AppStream/store{versions}", as_test_store_versions_func);
 	g_test_add_func ("/AppStream/store{origin}", as_test_store_origin_func);
 	g_test_add_func ("/AppStream/store{app-install}", as_test_store_app_install_func);
 	g_test_add_func ("/AppStream/store{yaml}", as_test_store_yaml_func);
+	g_test_add_func ("/AppStream/store{yaml-write}", as_test_store_yaml_write_func);
+	g_test_add_func ("/AppStream/store{yaml-write-quoted}", as_test_store_yaml_write_quoted_func);
+	g_test_add_func ("/AppStream/store{yaml-parallel}", as_test_store_yaml_parallel_func);
+	g_test_add_func ("/AppStream/store{yaml-truncated}", as_test_store_yaml_truncated_func);
+	g_test_add_func ("/AppStream/store{installed-parallel}", as_test_store_installed_parallel_func);
+	g_test_add_func ("/AppStream/store{convert-descriptions}", as_test_store_convert_descriptions_func);
 	g_test_add_func ("/AppStream/store{metadata}", as_test_store_metadata_func);
 	g_test_add_func ("/AppStream/store{metadata-index}", as_test_store_metadata_index_func);
+	g_test_add_func ("/AppStream/store{search}", as_test_store_search_func);
+	g_test_add_func ("/AppStream/store{search-fuzzy}", as_test_store_search_fuzzy_func);
+	g_test_add_func ("/AppStream/store{search-parallel}", as_test_store_search_parallel_func);
 	g_test_add_func ("/AppStream/store{validate}", as_test_store_validate_func);
 	g_test_add_func ("/AppStream/store{embedded}", as_test_store_embedded_func);
 	g_test_add_func ("/AppStream/store{local-app-install}", as_test_store_local_app_install_func);
@@ -4224,7 +6135,14 @@ main (int argc, char **argv)
 	g_test_add_func ("/AppStream/store{speed-appstream}", as_test_store_speed_appstream_func);
 	g_test_add_func ("/AppStream/store{speed-appdata}", as_test_store_speed_appdata_func);
 	g_test_add_func ("/AppStream/store{speed-desktop}", as_test_store_speed_desktop_func);
+	g_test_add_func ("/AppStream/store{speed-merge}", as_test_store_speed_merge_func);
 	g_test_add_func ("/AppStream/store{speed-yaml}", as_test_store_speed_yaml_func);
+	g_test_add_func ("/AppStream/store{speed-validate}", as_test_store_speed_validate_func);
+	g_test_add_func ("/AppStream/store{speed-search-fuzzy}", as_test_store_speed_search_fuzzy_func);
+	g_test_add_func ("/AppStream/key{speed}", as_test_key_speed_func);
+	g_test_add_func ("/AppStream/utils{spdx-speed}", as_test_utils_spdx_speed_func);
+	g_test_add_func ("/AppStream/utils{blacklist-speed}", as_test_utils_blacklist_speed_func);
+	g_test_add_func ("/AppStream/utils{vercmp-speed}", as_test_utils_vercmp_speed_func);
 
 	return g_test_run ();
 }
@@ -36,12 +36,18 @@
 
 #include "config.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "as-app-private.h"
 #include "as-cleanup.h"
 #include "as-node-private.h"
 #include "as-problem.h"
 #include "as-monitor.h"
-#include "as-store.h"
+#include "as-store-private.h"
 #include "as-utils-private.h"
 #include "as-yaml.h"
 
@@ -53,6 +59,18 @@ typedef enum {
 	AS_STORE_PROBLEM_LAST
 } AsStoreProblems;
 
+typedef struct _AsStoreFuzzyNode AsStoreFuzzyNode;
+struct _AsStoreFuzzyNode
+{
+	gchar			*word;
+	gunichar		*ucs4;
+	glong			 len;
+	guint			 distance;	/* to the parent */
+	GPtrArray		*apps;		/* of AsApp, not owned */
+	AsStoreFuzzyNode	*child;		/* first child */
+	AsStoreFuzzyNode	*next;		/* next sibling */
+};
+
 typedef struct _AsStorePrivate	AsStorePrivate;
 struct _AsStorePrivate
 {
@@ -63,20 +81,31 @@ struct _AsStorePrivate
 	GPtrArray		*array;		/* of AsApp */
 	GHashTable		*hash_id;	/* of AsApp{id} */
 	GHashTable		*hash_pkgname;	/* of AsApp{pkgname} */
+	GHashTable		*id_renames;	/* of id{id}, both ways */
 	AsMonitor		*monitor;
 	GHashTable		*metadata_indexes;	/* GHashTable{key} */
+	GHashTable		*content_hashes;	/* GHashTable{filename} */
+	GHashTable		*reloads;	/* GCancellable{filename} */
+	GPtrArray		*fuzzy_nodes;	/* of AsStoreFuzzyNode */
+	GPtrArray		*fuzzy_words;	/* of AsStoreFuzzyNode, sorted */
+	GMutex			 fuzzy_mutex;
 	AsStoreAddFlags		 add_flags;
 	AsStoreWatchFlags	 watch_flags;
 	AsStoreProblems		 problems;
+	guint			 max_threads;
 	guint32			 filter;
 	guint			 changed_block_refcnt;
 	gboolean		 is_pending_changed_signal;
+	GHashTable		*changes_added;		/* of AsApp */
+	GHashTable		*changes_removed;	/* of AsApp */
+	GHashTable		*changes_updated;	/* of AsApp */
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (AsStore, as_store, G_TYPE_OBJECT)
 
 enum {
 	SIGNAL_CHANGED,
+	SIGNAL_APPS_CHANGED,
 	SIGNAL_LAST
 };
 
@@ -100,6 +129,26 @@ as_store_error_quark (void)
 	return quark;
 }
 
+/**
+ * as_store_dispose:
+ **/
+static void
+as_store_dispose (GObject *object)
+{
+	AsStore *store = AS_STORE (object);
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	GCancellable *cancellable;
+	GHashTableIter iter;
+
+	/* stop any worker threads parsing files for this store */
+	g_hash_table_iter_init (&iter, priv->reloads);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &cancellable))
+		g_cancellable_cancel (cancellable);
+	g_hash_table_remove_all (priv->reloads);
+
+	G_OBJECT_CLASS (as_store_parent_class)->dispose (object);
+}
+
 /**
  * as_store_finalize:
  **/
@@ -116,7 +165,18 @@ as_store_finalize (GObject *object)
 	g_object_unref (priv->monitor);
 	g_hash_table_unref (priv->hash_id);
 	g_hash_table_unref (priv->hash_pkgname);
+	g_hash_table_unref (priv->id_renames);
 	g_hash_table_unref (priv->metadata_indexes);
+	g_hash_table_unref (priv->content_hashes);
+	g_hash_table_unref (priv->reloads);
+	g_hash_table_unref (priv->changes_added);
+	g_hash_table_unref (priv->changes_removed);
+	g_hash_table_unref (priv->changes_updated);
+	if (priv->fuzzy_words != NULL)
+		g_ptr_array_unref (priv->fuzzy_words);
+	if (priv->fuzzy_nodes != NULL)
+		g_ptr_array_unref (priv->fuzzy_nodes);
+	g_mutex_clear (&priv->fuzzy_mutex);
 
 	G_OBJECT_CLASS (as_store_parent_class)->finalize (object);
 }
@@ -145,9 +205,195 @@ as_store_class_init (AsStoreClass *klass)
 			      NULL, NULL, g_cclosure_marshal_VOID__VOID,
 			      G_TYPE_NONE, 0);
 
+	/**
+	 * AsStore::apps-changed:
+	 * @store: the #AsStore instance that emitted the signal
+	 * @added: (element-type AsApp): components added to the store
+	 * @removed: (element-type AsApp): components removed from the store
+	 * @updated: (element-type AsApp): components modified in place
+	 *
+	 * The ::apps-changed signal is emitted just before ::changed with
+	 * the components affected since the last emission, so that caches
+	 * can be updated without rescanning the whole store.
+	 *
+	 * A component replaced by a new object with the same ID, for
+	 * instance with a higher priority, is listed in both @removed and
+	 * @added. Components merged into an existing one appear in @updated.
+	 *
+	 * Since: 0.5.0
+	 **/
+	signals [SIGNAL_APPS_CHANGED] =
+		g_signal_new ("apps-changed",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (AsStoreClass, apps_changed),
+			      NULL, NULL, NULL,
+			      G_TYPE_NONE, 3,
+			      G_TYPE_PTR_ARRAY,
+			      G_TYPE_PTR_ARRAY,
+			      G_TYPE_PTR_ARRAY);
+
+	object_class->dispose = as_store_dispose;
 	object_class->finalize = as_store_finalize;
 }
 
+/**
+ * as_store_changes_tracked:
+ *
+ * Only keep track of the affected components if somebody is listening,
+ * either with a signal handler or with a subclass class closure.
+ **/
+static gboolean
+as_store_changes_tracked (AsStore *store)
+{
+	if (AS_STORE_GET_CLASS (store)->apps_changed != NULL)
+		return TRUE;
+	return g_signal_has_handler_pending (store,
+					     signals[SIGNAL_APPS_CHANGED],
+					     0, FALSE);
+}
+
+/**
+ * as_store_changes_added:
+ **/
+static void
+as_store_changes_added (AsStore *store, AsApp *app)
+{
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	if (!as_store_changes_tracked (store))
+		return;
+
+	/* removed and added back before anybody was told */
+	if (g_hash_table_remove (priv->changes_removed, app)) {
+		g_hash_table_add (priv->changes_updated, g_object_ref (app));
+		return;
+	}
+	g_hash_table_add (priv->changes_added, g_object_ref (app));
+}
+
+/**
+ * as_store_changes_removed:
+ **/
+static void
+as_store_changes_removed (AsStore *store, AsApp *app)
+{
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	if (!as_store_changes_tracked (store))
+		return;
+
+	/* added and removed before anybody was told */
+	if (g_hash_table_remove (priv->changes_added, app))
+		return;
+	g_hash_table_remove (priv->changes_updated, app);
+	g_hash_table_add (priv->changes_removed, g_object_ref (app));
+}
+
+/**
+ * as_store_changes_updated:
+ **/
+static void
+as_store_changes_updated (AsStore *store, AsApp *app)
+{
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	if (!as_store_changes_tracked (store))
+		return;
+	if (g_hash_table_contains (priv->changes_added, app))
+		return;
+	g_hash_table_add (priv->changes_updated, g_object_ref (app));
+}
+
+/**
+ * as_store_changes_to_array:
+ **/
+static GPtrArray *
+as_store_changes_to_array (GHashTable *hash)
+{
+	GHashTableIter iter;
+	GPtrArray *array;
+	gpointer key;
+
+	array = g_ptr_array_new_full (g_hash_table_size (hash),
+				      (GDestroyNotify) g_object_unref);
+	g_hash_table_iter_init (&iter, hash);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		g_ptr_array_add (array, key);
+		g_hash_table_iter_steal (&iter);
+	}
+	return array;
+}
+
+/**
+ * as_store_changes_merge_replaced:
+ *
+ * A component replaced by a new object with the same ID, for instance
+ * when a file is reloaded, is reported as updated rather than as being
+ * removed and added.
+ **/
+static void
+as_store_changes_merge_replaced (AsStore *store)
+{
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	AsApp *app;
+	AsApp *app_old;
+	GHashTableIter iter;
+	gpointer key;
+	_cleanup_hashtable_unref_ GHashTable *removed = NULL;
+
+	if (g_hash_table_size (priv->changes_added) == 0 ||
+	    g_hash_table_size (priv->changes_removed) == 0)
+		return;
+
+	/* index the removed components by ID */
+	removed = g_hash_table_new (g_str_hash, g_str_equal);
+	g_hash_table_iter_init (&iter, priv->changes_removed);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		app = AS_APP (key);
+		if (as_app_get_id (app) == NULL)
+			continue;
+		g_hash_table_insert (removed, (gpointer) as_app_get_id (app), app);
+	}
+
+	g_hash_table_iter_init (&iter, priv->changes_added);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		app = AS_APP (key);
+		if (as_app_get_id (app) == NULL)
+			continue;
+		app_old = g_hash_table_lookup (removed, as_app_get_id (app));
+		if (app_old == NULL)
+			continue;
+		g_hash_table_remove (removed, as_app_get_id (app));
+		g_hash_table_remove (priv->changes_removed, app_old);
+		g_hash_table_iter_steal (&iter);
+		g_hash_table_add (priv->changes_updated, app);
+	}
+}
+
+/**
+ * as_store_changes_emit:
+ **/
+static void
+as_store_changes_emit (AsStore *store)
+{
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	_cleanup_ptrarray_unref_ GPtrArray *added = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *removed = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *updated = NULL;
+
+	if (g_hash_table_size (priv->changes_added) == 0 &&
+	    g_hash_table_size (priv->changes_removed) == 0 &&
+	    g_hash_table_size (priv->changes_updated) == 0)
+		return;
+	as_store_changes_merge_replaced (store);
+
+	/* the arrays take over the references */
+	added = as_store_changes_to_array (priv->changes_added);
+	removed = as_store_changes_to_array (priv->changes_removed);
+	updated = as_store_changes_to_array (priv->changes_updated);
+	g_debug ("Emitting ::apps-changed() [%u added, %u removed, %u updated]",
+		 added->len, removed->len, updated->len);
+	g_signal_emit (store, signals[SIGNAL_APPS_CHANGED], 0,
+		       added, removed, updated);
+}
+
 /**
  * as_store_perhaps_emit_changed:
  */
@@ -163,6 +409,7 @@ as_store_perhaps_emit_changed (AsStore *store, const gchar *details)
 		priv->is_pending_changed_signal = TRUE;
 		return;
 	}
+	as_store_changes_emit (store);
 	g_debug ("Emitting ::changed() [%s]", details);
 	g_signal_emit (store, signals[SIGNAL_CHANGED], 0);
 	priv->is_pending_changed_signal = FALSE;
@@ -284,6 +531,26 @@ as_store_get_apps (AsStore *store)
 	return priv->array;
 }
 
+/**
+ * as_store_fuzzy_invalidate:
+ *
+ * The index does not keep a reference to the applications, so this has to
+ * be called before any application is removed from the store.
+ **/
+static void
+as_store_fuzzy_invalidate (AsStore *store)
+{
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	g_mutex_lock (&priv->fuzzy_mutex);
+	if (priv->fuzzy_nodes != NULL) {
+		g_ptr_array_unref (priv->fuzzy_words);
+		g_ptr_array_unref (priv->fuzzy_nodes);
+		priv->fuzzy_words = NULL;
+		priv->fuzzy_nodes = NULL;
+	}
+	g_mutex_unlock (&priv->fuzzy_mutex);
+}
+
 /**
  * as_store_remove_all:
  * @store: a #AsStore instance.
@@ -296,10 +563,15 @@ void
 as_store_remove_all (AsStore *store)
 {
 	AsStorePrivate *priv = GET_PRIVATE (store);
+	guint i;
 	g_return_if_fail (AS_IS_STORE (store));
+	as_store_fuzzy_invalidate (store);
+	for (i = 0; i < priv->array->len; i++)
+		as_store_changes_removed (store, g_ptr_array_index (priv->array, i));
 	g_ptr_array_set_size (priv->array, 0);
 	g_hash_table_remove_all (priv->hash_id);
 	g_hash_table_remove_all (priv->hash_pkgname);
+	g_hash_table_remove_all (priv->id_renames);
 }
 
 /**
@@ -428,6 +700,158 @@ as_store_get_app_by_id (AsStore *store, const gchar *id)
 	return g_hash_table_lookup (priv->hash_id, id);
 }
 
+/* IDs that upstream projects have used previously */
+typedef struct {
+	const gchar	*old;
+	const gchar	*new;
+} AsStoreIdRename;
+
+static const AsStoreIdRename as_store_id_renames[] = {
+	/* GNOME */
+	{ "baobab.desktop",		"org.gnome.baobab.desktop" },
+	{ "cheese.desktop",		"org.gnome.Cheese.desktop" },
+	{ "devhelp.desktop",		"org.gnome.Devhelp.desktop" },
+	{ "file-roller.desktop",	"org.gnome.FileRoller.desktop" },
+	{ "gcalctool.desktop",		"gnome-calculator.desktop" },
+	{ "gedit.desktop",		"org.gnome.gedit.desktop" },
+	{ "glchess.desktop",		"gnome-chess.desktop" },
+	{ "glines.desktop",		"five-or-more.desktop" },
+	{ "gnect.desktop",		"four-in-a-row.desktop" },
+	{ "gnibbles.desktop",		"gnome-nibbles.desktop" },
+	{ "gnobots2.desktop",		"gnome-robots.desktop" },
+	{ "gnome-2048.desktop",		"org.gnome.gnome-2048.desktop" },
+	{ "gnome-boxes.desktop",	"org.gnome.Boxes.desktop" },
+	{ "gnome-clocks.desktop",	"org.gnome.clocks.desktop" },
+	{ "gnome-contacts.desktop",	"org.gnome.Contacts.desktop" },
+	{ "gnome-dictionary.desktop",	"org.gnome.Dictionary.desktop" },
+	{ "gnome-disks.desktop",	"org.gnome.DiskUtility.desktop" },
+	{ "gnome-documents.desktop",	"org.gnome.Documents.desktop" },
+	{ "gnome-font-viewer.desktop",	"org.gnome.font-viewer.desktop" },
+	{ "gnome-maps.desktop",		"org.gnome.Maps.desktop" },
+	{ "gnome-photos.desktop",	"org.gnome.Photos.desktop" },
+	{ "gnome-screenshot.desktop",	"org.gnome.Screenshot.desktop" },
+	{ "gnome-software.desktop",	"org.gnome.Software.desktop" },
+	{ "gnome-sound-recorder.desktop", "org.gnome.SoundRecorder.desktop" },
+	{ "gnome-terminal.desktop",	"org.gnome.Terminal.desktop" },
+	{ "gnome-weather.desktop",	"org.gnome.Weather.Application.desktop" },
+	{ "gnomine.desktop",		"gnome-mines.desktop" },
+	{ "gnotravex.desktop",		"gnome-tetravex.desktop" },
+	{ "gnotski.desktop",		"gnome-klotski.desktop" },
+	{ "gtali.desktop",		"tali.desktop" },
+	{ "nautilus.desktop",		"org.gnome.Nautilus.desktop" },
+	{ "polari.desktop",		"org.gnome.Polari.desktop" },
+	{ "totem.desktop",		"org.gnome.Totem.desktop" },
+
+	/* KDE */
+	{ "blinken.desktop",		"org.kde.blinken.desktop" },
+	{ "cantor.desktop",		"org.kde.cantor.desktop" },
+	{ "filelight.desktop",		"org.kde.filelight.desktop" },
+	{ "gwenview.desktop",		"org.kde.gwenview.desktop" },
+	{ "kalgebra.desktop",		"org.kde.kalgebra.desktop" },
+	{ "kanagram.desktop",		"org.kde.kanagram.desktop" },
+	{ "kapman.desktop",		"org.kde.kapman.desktop" },
+	{ "kbruch.desktop",		"org.kde.kbruch.desktop" },
+	{ "kgeography.desktop",		"org.kde.kgeography.desktop" },
+	{ "khangman.desktop",		"org.kde.khangman.desktop" },
+	{ "kiten.desktop",		"org.kde.kiten.desktop" },
+	{ "klettres.desktop",		"org.kde.klettres.desktop" },
+	{ "klipper.desktop",		"org.kde.klipper.desktop" },
+	{ "kmplot.desktop",		"org.kde.kmplot.desktop" },
+	{ "kollision.desktop",		"org.kde.kollision.desktop" },
+	{ "konsole.desktop",		"org.kde.konsole.desktop" },
+	{ "kstars.desktop",		"org.kde.kstars.desktop" },
+	{ "ktp-log-viewer.desktop",	"org.kde.ktplogviewer.desktop" },
+	{ "kturtle.desktop",		"org.kde.kturtle.desktop" },
+	{ "kwordquiz.desktop",		"org.kde.kwordquiz.desktop" },
+	{ "okteta.desktop",		"org.kde.okteta.desktop" },
+	{ "parley.desktop",		"org.kde.parley.desktop" },
+	{ "partitionmanager.desktop",	"org.kde.PartitionManager.desktop" },
+	{ "step.desktop",		"org.kde.step.desktop" },
+
+	/* others */
+	{ "colorhug-ccmx.desktop",	"com.hughski.ColorHug.CcmxLoader.desktop" },
+	{ "colorhug-flash.desktop",	"com.hughski.ColorHug.FlashLoader.desktop" },
+	{ "dconf-editor.desktop",	"ca.desrt.dconf-editor.desktop" },
+
+	{ NULL, NULL }
+};
+
+/**
+ * as_store_id_renames_get:
+ *
+ * Returns the built-in renames indexed both ways, building the table the
+ * first time.
+ **/
+static GHashTable *
+as_store_id_renames_get (void)
+{
+	static gsize renames_once = 0;
+
+	if (g_once_init_enter (&renames_once)) {
+		GHashTable *renames;
+		guint i;
+
+		renames = g_hash_table_new (g_str_hash, g_str_equal);
+		for (i = 0; as_store_id_renames[i].old != NULL; i++) {
+			g_hash_table_insert (renames,
+					     (gpointer) as_store_id_renames[i].old,
+					     (gpointer) as_store_id_renames[i].new);
+			g_hash_table_insert (renames,
+					     (gpointer) as_store_id_renames[i].new,
+					     (gpointer) as_store_id_renames[i].old);
+		}
+		g_once_init_leave (&renames_once, (gsize) renames);
+	}
+	return (GHashTable *) renames_once;
+}
+
+/**
+ * as_store_add_id_rename:
+ *
+ * Records that @id_old is the previous ID of @id_new, so that either can be
+ * used to find the other.
+ **/
+static void
+as_store_add_id_rename (AsStore *store, const gchar *id_old, const gchar *id_new)
+{
+	AsStorePrivate *priv = GET_PRIVATE (store);
+
+	if (g_strcmp0 (id_old, id_new) == 0)
+		return;
+	g_hash_table_insert (priv->id_renames,
+			     g_strdup (id_old),
+			     g_strdup (id_new));
+	if (!g_hash_table_contains (priv->id_renames, id_new)) {
+		g_hash_table_insert (priv->id_renames,
+				     g_strdup (id_new),
+				     g_strdup (id_old));
+	}
+}
+
+/**
+ * as_store_id_rename_matches_cb:
+ **/
+static gboolean
+as_store_id_rename_matches_cb (gpointer key, gpointer value, gpointer user_data)
+{
+	const gchar *id = (const gchar *) user_data;
+	return g_strcmp0 (key, id) == 0 || g_strcmp0 (value, id) == 0;
+}
+
+/**
+ * as_store_remove_id_renames:
+ *
+ * Forgets the previous IDs of a component that is no longer in the store.
+ **/
+static void
+as_store_remove_id_renames (AsStore *store, const gchar *id)
+{
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	g_hash_table_foreach_remove (priv->id_renames,
+				     as_store_id_rename_matches_cb,
+				     (gpointer) id);
+}
+
 /**
  * as_store_get_app_by_id_with_fallbacks:
  * @store: a #AsStore instance.
@@ -438,6 +862,10 @@ as_store_get_app_by_id (AsStore *store, const gchar *id)
  * to change their ID (e.g. from cheese.desktop to org.gnome.Cheese.desktop)
  * without us duplicating entries in the software center.
  *
+ * As well as a built-in list of renames, any previous IDs listed by
+ * components in the store as <literal>&lt;provides&gt;&lt;id&gt;</literal>
+ * are also used.
+ *
  * Returns: (transfer none): a #AsApp or %NULL
  *
  * Since: 0.4.1
@@ -446,93 +874,27 @@ AsApp *
 as_store_get_app_by_id_with_fallbacks (AsStore *store, const gchar *id)
 {
 	AsApp *app;
-	guint i;
-	const struct {
-		const gchar	*old;
-		const gchar	*new;
-	} id_map[] = {
-		/* GNOME */
-		{ "baobab.desktop",		"org.gnome.baobab.desktop" },
-		{ "cheese.desktop",		"org.gnome.Cheese.desktop" },
-		{ "devhelp.desktop",		"org.gnome.Devhelp.desktop" },
-		{ "file-roller.desktop",	"org.gnome.FileRoller.desktop" },
-		{ "gcalctool.desktop",		"gnome-calculator.desktop" },
-		{ "gedit.desktop",		"org.gnome.gedit.desktop" },
-		{ "glchess.desktop",		"gnome-chess.desktop" },
-		{ "glines.desktop",		"five-or-more.desktop" },
-		{ "gnect.desktop",		"four-in-a-row.desktop" },
-		{ "gnibbles.desktop",		"gnome-nibbles.desktop" },
-		{ "gnobots2.desktop",		"gnome-robots.desktop" },
-		{ "gnome-2048.desktop",		"org.gnome.gnome-2048.desktop" },
-		{ "gnome-boxes.desktop",	"org.gnome.Boxes.desktop" },
-		{ "gnome-clocks.desktop",	"org.gnome.clocks.desktop" },
-		{ "gnome-contacts.desktop",	"org.gnome.Contacts.desktop" },
-		{ "gnome-dictionary.desktop",	"org.gnome.Dictionary.desktop" },
-		{ "gnome-disks.desktop",	"org.gnome.DiskUtility.desktop" },
-		{ "gnome-documents.desktop",	"org.gnome.Documents.desktop" },
-		{ "gnome-font-viewer.desktop",	"org.gnome.font-viewer.desktop" },
-		{ "gnome-maps.desktop",		"org.gnome.Maps.desktop" },
-		{ "gnome-photos.desktop",	"org.gnome.Photos.desktop" },
-		{ "gnome-screenshot.desktop",	"org.gnome.Screenshot.desktop" },
-		{ "gnome-software.desktop",	"org.gnome.Software.desktop" },
-		{ "gnome-sound-recorder.desktop", "org.gnome.SoundRecorder.desktop" },
-		{ "gnome-terminal.desktop",	"org.gnome.Terminal.desktop" },
-		{ "gnome-weather.desktop",	"org.gnome.Weather.Application.desktop" },
-		{ "gnomine.desktop",		"gnome-mines.desktop" },
-		{ "gnotravex.desktop",		"gnome-tetravex.desktop" },
-		{ "gnotski.desktop",		"gnome-klotski.desktop" },
-		{ "gtali.desktop",		"tali.desktop" },
-		{ "nautilus.desktop",		"org.gnome.Nautilus.desktop" },
-		{ "polari.desktop",		"org.gnome.Polari.desktop" },
-		{ "totem.desktop",		"org.gnome.Totem.desktop" },
-
-		/* KDE */
-		{ "blinken.desktop",		"org.kde.blinken.desktop" },
-		{ "cantor.desktop",		"org.kde.cantor.desktop" },
-		{ "filelight.desktop",		"org.kde.filelight.desktop" },
-		{ "gwenview.desktop",		"org.kde.gwenview.desktop" },
-		{ "kalgebra.desktop",		"org.kde.kalgebra.desktop" },
-		{ "kanagram.desktop",		"org.kde.kanagram.desktop" },
-		{ "kapman.desktop",		"org.kde.kapman.desktop" },
-		{ "kbruch.desktop",		"org.kde.kbruch.desktop" },
-		{ "kgeography.desktop",		"org.kde.kgeography.desktop" },
-		{ "khangman.desktop",		"org.kde.khangman.desktop" },
-		{ "kiten.desktop",		"org.kde.kiten.desktop" },
-		{ "klettres.desktop",		"org.kde.klettres.desktop" },
-		{ "klipper.desktop",		"org.kde.klipper.desktop" },
-		{ "kmplot.desktop",		"org.kde.kmplot.desktop" },
-		{ "kollision.desktop",		"org.kde.kollision.desktop" },
-		{ "konsole.desktop",		"org.kde.konsole.desktop" },
-		{ "kstars.desktop",		"org.kde.kstars.desktop" },
-		{ "ktp-log-viewer.desktop",	"org.kde.ktplogviewer.desktop" },
-		{ "kturtle.desktop",		"org.kde.kturtle.desktop" },
-		{ "kwordquiz.desktop",		"org.kde.kwordquiz.desktop" },
-		{ "okteta.desktop",		"org.kde.okteta.desktop" },
-		{ "parley.desktop",		"org.kde.parley.desktop" },
-		{ "partitionmanager.desktop",	"org.kde.PartitionManager.desktop" },
-		{ "step.desktop",		"org.kde.step.desktop" },
-
-		/* others */
-		{ "colorhug-ccmx.desktop",	"com.hughski.ColorHug.CcmxLoader.desktop" },
-		{ "colorhug-flash.desktop",	"com.hughski.ColorHug.FlashLoader.desktop" },
-		{ "dconf-editor.desktop",	"ca.desrt.dconf-editor.desktop" },
-
-		{ NULL, NULL }
-	};
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	const gchar *id_tmp;
 
 	/* trivial case */
 	app = as_store_get_app_by_id (store, id);
 	if (app != NULL)
 		return app;
 
-	/* has the application ID been renamed */
-	for (i = 0; id_map[i].old != NULL; i++) {
-		if (g_strcmp0 (id, id_map[i].old) == 0)
-			return as_store_get_app_by_id (store, id_map[i].new);
-		if (g_strcmp0 (id, id_map[i].new) == 0)
-			return as_store_get_app_by_id (store, id_map[i].old);
+	/* has the application ID been renamed in the metadata */
+	id_tmp = g_hash_table_lookup (priv->id_renames, id);
+	if (id_tmp != NULL) {
+		app = as_store_get_app_by_id (store, id_tmp);
+		if (app != NULL)
+			return app;
 	}
 
+	/* has the application ID been renamed upstream */
+	id_tmp = g_hash_table_lookup (as_store_id_renames_get (), id);
+	if (id_tmp != NULL)
+		return as_store_get_app_by_id (store, id_tmp);
+
 	return NULL;
 }
 
@@ -584,100 +946,928 @@ as_store_get_app_by_pkgnames (AsStore *store, gchar **pkgnames)
 	return NULL;
 }
 
+typedef struct {
+	AsApp		*app;
+	guint		 score;
+} AsStoreSearchResult;
+
 /**
- * as_store_remove_app:
- * @store: a #AsStore instance.
- * @app: a #AsApp instance.
+ * as_store_search_result_cmp:
  *
- * Removes an application from the store if it exists.
+ * Orders results from worst to best, using the application ID to make the
+ * ordering stable when the scores are equal.
+ **/
+static gint
+as_store_search_result_cmp (const AsStoreSearchResult *a,
+			    const AsStoreSearchResult *b)
+{
+	if (a->score < b->score)
+		return -1;
+	if (a->score > b->score)
+		return 1;
+	return g_strcmp0 (as_app_get_id (b->app), as_app_get_id (a->app));
+}
+
+/**
+ * as_store_search_result_sort_cb:
+ **/
+static gint
+as_store_search_result_sort_cb (gconstpointer a, gconstpointer b)
+{
+	return as_store_search_result_cmp ((const AsStoreSearchResult *) b,
+					   (const AsStoreSearchResult *) a);
+}
+
+/**
+ * as_store_search_results_sift_down:
+ **/
+static void
+as_store_search_results_sift_down (GArray *heap, guint idx)
+{
+	AsStoreSearchResult *r = (AsStoreSearchResult *) heap->data;
+	AsStoreSearchResult tmp;
+	guint child;
+
+	while ((child = idx * 2 + 1) < heap->len) {
+		if (child + 1 < heap->len &&
+		    as_store_search_result_cmp (&r[child + 1], &r[child]) < 0)
+			child++;
+		if (as_store_search_result_cmp (&r[idx], &r[child]) <= 0)
+			break;
+		tmp = r[idx];
+		r[idx] = r[child];
+		r[child] = tmp;
+		idx = child;
+	}
+}
+
+/**
+ * as_store_search_results_add:
  *
- * Since: 0.1.0
+ * Adds a scored result, keeping at most @max_results entries in @heap.
+ * When @max_results is non-zero the array is kept as a min-heap so that the
+ * worst result is always at the root and can be replaced in O(log k).
  **/
-void
-as_store_remove_app (AsStore *store, AsApp *app)
+static void
+as_store_search_results_add (GArray *heap,
+			     guint max_results,
+			     AsApp *app,
+			     guint score)
 {
-	AsStorePrivate *priv = GET_PRIVATE (store);
-	g_hash_table_remove (priv->hash_id, as_app_get_id (app));
-	g_ptr_array_remove (priv->array, app);
-	g_hash_table_remove_all (priv->metadata_indexes);
+	AsStoreSearchResult *r;
+	AsStoreSearchResult new_r;
+	AsStoreSearchResult tmp;
+	guint idx;
+	guint parent;
+
+	new_r.app = app;
+	new_r.score = score;
+
+	/* no limit, so just collect everything */
+	if (max_results == 0) {
+		g_array_append_val (heap, new_r);
+		return;
+	}
 
-	/* removed */
-	as_store_perhaps_emit_changed (store, "remove-app");
+	/* replace the worst result if this is better */
+	if (heap->len == max_results) {
+		r = (AsStoreSearchResult *) heap->data;
+		if (as_store_search_result_cmp (&new_r, &r[0]) <= 0)
+			return;
+		r[0] = new_r;
+		as_store_search_results_sift_down (heap, 0);
+		return;
+	}
+
+	/* add to the end and sift up */
+	g_array_append_val (heap, new_r);
+	r = (AsStoreSearchResult *) heap->data;
+	for (idx = heap->len - 1; idx > 0; idx = parent) {
+		parent = (idx - 1) / 2;
+		if (as_store_search_result_cmp (&r[parent], &r[idx]) <= 0)
+			break;
+		tmp = r[idx];
+		r[idx] = r[parent];
+		r[parent] = tmp;
+	}
 }
 
 /**
- * as_store_remove_app_by_id:
+ * as_store_search_results_to_array:
+ **/
+static GPtrArray *
+as_store_search_results_to_array (GArray *heap)
+{
+	AsStoreSearchResult *r;
+	GPtrArray *apps;
+	guint i;
+
+	g_array_sort (heap, as_store_search_result_sort_cb);
+	apps = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (i = 0; i < heap->len; i++) {
+		r = &g_array_index (heap, AsStoreSearchResult, i);
+		g_ptr_array_add (apps, g_object_ref (r->app));
+	}
+	return apps;
+}
+
+/**
+ * as_store_search:
  * @store: a #AsStore instance.
- * @id: an application id
+ * @search: the search terms, e.g. from as_utils_search_tokenize()
+ * @max_results: the maximum number of results to return, or 0 for no limit
  *
- * Removes an application from the store if it exists.
+ * Finds all the applications that match all of the search terms, ordered
+ * so that the most relevant result is first.
  *
- * Since: 0.3.0
+ * The relevance is computed using as_app_search_matches_ranked() and when
+ * @max_results is set only the best results are kept while scanning the
+ * store, so asking for the top few results of a large store is cheap.
+ *
+ * Returns: (element-type AsApp) (transfer container): an array
+ *
+ * Since: 0.5.0
  **/
-void
-as_store_remove_app_by_id (AsStore *store, const gchar *id)
+GPtrArray *
+as_store_search (AsStore *store, gchar **search, guint max_results)
 {
 	AsApp *app;
 	AsStorePrivate *priv = GET_PRIVATE (store);
 	guint i;
+	guint score;
+	_cleanup_array_unref_ GArray *heap = NULL;
 
-	if (!g_hash_table_remove (priv->hash_id, id))
-		return;
+	g_return_val_if_fail (AS_IS_STORE (store), NULL);
+	g_return_val_if_fail (search != NULL, NULL);
+
+	heap = g_array_new (FALSE, FALSE, sizeof (AsStoreSearchResult));
 	for (i = 0; i < priv->array->len; i++) {
 		app = g_ptr_array_index (priv->array, i);
-		if (g_strcmp0 (id, as_app_get_id (app)) != 0)
+		score = as_app_search_matches_ranked (app, search);
+		if (score == 0)
 			continue;
-		g_ptr_array_remove (priv->array, app);
+		as_store_search_results_add (heap, max_results, app, score);
 	}
-	g_hash_table_remove_all (priv->metadata_indexes);
+	return as_store_search_results_to_array (heap);
+}
 
-	/* removed */
-	as_store_perhaps_emit_changed (store, "remove-app-by-id");
+typedef struct AsStorePartition AsStorePartition;
+typedef void (*AsStorePartitionFunc) (AsStorePartition *partition,
+				      gpointer user_data);
+
+struct AsStorePartition {
+	GPtrArray		*apps;
+	guint			 start;
+	guint			 end;
+	gpointer		 results;	/* set by the func, if required */
+	GDestroyNotify		 results_free;
+	AsStorePartitionFunc	 func;
+	gpointer		 user_data;
+};
+
+/**
+ * as_store_partition_free:
+ **/
+static void
+as_store_partition_free (AsStorePartition *partition)
+{
+	if (partition->results != NULL && partition->results_free != NULL)
+		partition->results_free (partition->results);
+	g_slice_free (AsStorePartition, partition);
 }
 
 /**
- * as_store_add_app:
- * @store: a #AsStore instance.
- * @app: a #AsApp instance.
- *
- * Adds an application to the store. If a lower priority application has already
- * been added then this new application will replace it.
- *
- * Additionally only applications where the kind is known will be added.
+ * as_store_partition_thread_cb:
+ **/
+static void
+as_store_partition_thread_cb (gpointer data, gpointer user_data)
+{
+	AsStorePartition *partition = (AsStorePartition *) data;
+	partition->func (partition, partition->user_data);
+}
+
+/**
+ * as_store_partition_run:
  *
- * Since: 0.1.0
+ * Splits the store into one partition per thread and calls @func for each
+ * partition in parallel, returning the partitions in store order once they
+ * have all finished. If threads are not worth starting then one partition
+ * covering the whole store is processed in the calling thread.
  **/
-void
-as_store_add_app (AsStore *store, AsApp *app)
+static GPtrArray *
+as_store_partition_run (AsStore *store,
+			guint max_threads,
+			AsStorePartitionFunc func,
+			gpointer user_data)
 {
-	AsApp *item;
+	AsStorePartition *partition;
 	AsStorePrivate *priv = GET_PRIVATE (store);
-	GPtrArray *pkgnames;
-	const gchar *id;
-	const gchar *pkgname;
+	GPtrArray *partitions;
+	GThreadPool *pool = NULL;
+	guint chunk;
 	guint i;
 
-	/* have we recorded this before? */
-	id = as_app_get_id (app);
-	if (id == NULL) {
-		g_warning ("application has no ID set");
-		return;
+	partitions = g_ptr_array_new_with_free_func ((GDestroyNotify) as_store_partition_free);
+
+	/* not worth starting threads */
+	if (max_threads == 0)
+		max_threads = g_get_num_processors ();
+	if (max_threads > priv->array->len)
+		max_threads = priv->array->len;
+	if (max_threads > 1) {
+		pool = g_thread_pool_new (as_store_partition_thread_cb,
+					  NULL,
+					  max_threads,
+					  TRUE,
+					  NULL);
+	}
+	if (pool == NULL) {
+		partition = g_slice_new0 (AsStorePartition);
+		partition->apps = priv->array;
+		partition->start = 0;
+		partition->end = priv->array->len;
+		partition->func = func;
+		partition->user_data = user_data;
+		g_ptr_array_add (partitions, partition);
+		func (partition, user_data);
+		return partitions;
 	}
-	item = g_hash_table_lookup (priv->hash_id, id);
-	if (item != NULL) {
 
-		/* the previously stored app is what we actually want */
-		if ((priv->add_flags & AS_STORE_ADD_FLAG_PREFER_LOCAL) > 0) {
+	/* each partition only touches its own range of the store */
+	chunk = (priv->array->len + max_threads - 1) / max_threads;
+	for (i = 0; i < priv->array->len; i += chunk) {
+		partition = g_slice_new0 (AsStorePartition);
+		partition->apps = priv->array;
+		partition->start = i;
+		partition->end = MIN (i + chunk, priv->array->len);
+		partition->func = func;
+		partition->user_data = user_data;
+		g_ptr_array_add (partitions, partition);
+		g_thread_pool_push (pool, partition, NULL);
+	}
 
-			if (as_app_get_source_kind (app) == AS_APP_SOURCE_KIND_APPSTREAM &&
-			    as_app_get_source_kind (item) == AS_APP_SOURCE_KIND_APPDATA) {
-				g_debug ("ignoring AppStream entry as AppData exists: %s", id);
-				return;
-			}
-			if (as_app_get_source_kind (app) == AS_APP_SOURCE_KIND_APPSTREAM &&
+	/* wait for them to finish */
+	g_thread_pool_free (pool, FALSE, TRUE);
+	return partitions;
+}
+
+typedef struct {
+	gchar		**search;
+	guint		 max_results;
+} AsStoreSearchHelper;
+
+/**
+ * as_store_search_partition_cb:
+ **/
+static void
+as_store_search_partition_cb (AsStorePartition *partition, gpointer user_data)
+{
+	AsApp *app;
+	AsStoreSearchHelper *helper = (AsStoreSearchHelper *) user_data;
+	GArray *results;
+	guint i;
+	guint score;
+
+	/* each partition keeps its own best results */
+	results = g_array_new (FALSE, FALSE, sizeof (AsStoreSearchResult));
+	partition->results = results;
+	partition->results_free = (GDestroyNotify) g_array_unref;
+	for (i = partition->start; i < partition->end; i++) {
+		app = g_ptr_array_index (partition->apps, i);
+		score = as_app_search_matches_ranked (app, helper->search);
+		if (score == 0)
+			continue;
+		as_store_search_results_add (results, helper->max_results,
+					     app, score);
+	}
+}
+
+/**
+ * as_store_search_parallel:
+ * @store: a #AsStore instance.
+ * @search: the search terms, e.g. from as_utils_search_tokenize()
+ * @max_results: the maximum number of results to return, or 0 for no limit
+ * @max_threads: the number of threads to use, or 0 for the number of CPUs
+ *
+ * Finds all the applications that match all of the search terms, ordered
+ * so that the most relevant result is first.
+ *
+ * This returns the same results as as_store_search() but splits the store
+ * into one partition per thread, scores each partition in parallel and then
+ * merges the best results. This is only useful for very large stores, and
+ * the store must not be modified until this function returns.
+ *
+ * Returns: (element-type AsApp) (transfer container): an array
+ *
+ * Since: 0.5.0
+ **/
+GPtrArray *
+as_store_search_parallel (AsStore *store,
+			  gchar **search,
+			  guint max_results,
+			  guint max_threads)
+{
+	AsStorePartition *partition;
+	AsStoreSearchHelper helper;
+	GArray *results;
+	guint i;
+	guint j;
+	_cleanup_array_unref_ GArray *heap = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *partitions = NULL;
+
+	g_return_val_if_fail (AS_IS_STORE (store), NULL);
+	g_return_val_if_fail (search != NULL, NULL);
+
+	/* score each partition */
+	helper.search = search;
+	helper.max_results = max_results;
+	partitions = as_store_partition_run (store, max_threads,
+					     as_store_search_partition_cb,
+					     &helper);
+
+	/* merge, the overall best results are in the union of the
+	 * best results of each partition */
+	heap = g_array_new (FALSE, FALSE, sizeof (AsStoreSearchResult));
+	for (i = 0; i < partitions->len; i++) {
+		partition = g_ptr_array_index (partitions, i);
+		results = partition->results;
+		for (j = 0; j < results->len; j++) {
+			AsStoreSearchResult *r;
+			r = &g_array_index (results, AsStoreSearchResult, j);
+			as_store_search_results_add (heap, max_results,
+						     r->app, r->score);
+		}
+	}
+	return as_store_search_results_to_array (heap);
+}
+
+/**
+ * as_store_fuzzy_node_free:
+ **/
+static void
+as_store_fuzzy_node_free (AsStoreFuzzyNode *node)
+{
+	g_free (node->word);
+	g_free (node->ucs4);
+	g_ptr_array_unref (node->apps);
+	g_slice_free (AsStoreFuzzyNode, node);
+}
+
+/**
+ * as_store_fuzzy_distance:
+ *
+ * Returns the Levenshtein edit distance between two UCS-4 strings.
+ **/
+static guint
+as_store_fuzzy_distance (const gunichar *a, glong a_len,
+			 const gunichar *b, glong b_len)
+{
+	glong i;
+	glong j;
+	guint cost;
+	guint tmp;
+	guint *row;
+	guint diag;
+	guint result;
+
+	if (a_len == 0)
+		return b_len;
+	if (b_len == 0)
+		return a_len;
+
+	/* only keep one row of the matrix */
+	row = g_new (guint, b_len + 1);
+	for (j = 0; j <= b_len; j++)
+		row[j] = j;
+	for (i = 1; i <= a_len; i++) {
+		diag = row[0];
+		row[0] = i;
+		for (j = 1; j <= b_len; j++) {
+			cost = a[i - 1] == b[j - 1] ? 0 : 1;
+			tmp = MIN (row[j] + 1, row[j - 1] + 1);
+			tmp = MIN (tmp, diag + cost);
+			diag = row[j];
+			row[j] = tmp;
+		}
+	}
+	result = row[b_len];
+	g_free (row);
+	return result;
+}
+
+/**
+ * as_store_fuzzy_insert:
+ *
+ * Adds a word to the BK-tree, where every child is kept at a distinct edit
+ * distance from its parent.
+ **/
+static AsStoreFuzzyNode *
+as_store_fuzzy_insert (GPtrArray *nodes, const gchar *word)
+{
+	AsStoreFuzzyNode *new_node;
+	AsStoreFuzzyNode *node;
+	AsStoreFuzzyNode *child;
+	guint distance;
+
+	new_node = g_slice_new0 (AsStoreFuzzyNode);
+	new_node->word = g_strdup (word);
+	new_node->ucs4 = g_utf8_to_ucs4_fast (word, -1, &new_node->len);
+	new_node->apps = g_ptr_array_new ();
+	g_ptr_array_add (nodes, new_node);
+
+	/* first word is the root */
+	if (nodes->len == 1)
+		return new_node;
+
+	node = g_ptr_array_index (nodes, 0);
+	while (TRUE) {
+		distance = as_store_fuzzy_distance (node->ucs4, node->len,
+						    new_node->ucs4, new_node->len);
+		for (child = node->child; child != NULL; child = child->next) {
+			if (child->distance == distance)
+				break;
+		}
+		if (child == NULL) {
+			new_node->distance = distance;
+			new_node->next = node->child;
+			node->child = new_node;
+			return new_node;
+		}
+		node = child;
+	}
+}
+
+/**
+ * as_store_fuzzy_word_sort_cb:
+ **/
+static gint
+as_store_fuzzy_word_sort_cb (gconstpointer a, gconstpointer b)
+{
+	AsStoreFuzzyNode *node1 = *((AsStoreFuzzyNode **) a);
+	AsStoreFuzzyNode *node2 = *((AsStoreFuzzyNode **) b);
+	return g_strcmp0 (node1->word, node2->word);
+}
+
+/**
+ * as_store_fuzzy_ensure:
+ *
+ * Must be called with the fuzzy mutex held.
+ **/
+static GPtrArray *
+as_store_fuzzy_ensure (AsStore *store)
+{
+	AsApp *app;
+	AsStoreFuzzyNode *node;
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	const gchar *tmp;
+	guint i;
+	guint j;
+	_cleanup_hashtable_unref_ GHashTable *words = NULL;
+
+	/* already valid */
+	if (priv->fuzzy_nodes != NULL)
+		return priv->fuzzy_nodes;
+
+	/* add every search token of every application */
+	priv->fuzzy_nodes = g_ptr_array_new_with_free_func ((GDestroyNotify) as_store_fuzzy_node_free);
+	words = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; i < priv->array->len; i++) {
+		_cleanup_ptrarray_unref_ GPtrArray *tokens = NULL;
+		app = g_ptr_array_index (priv->array, i);
+		tokens = as_app_get_search_tokens (app);
+		for (j = 0; j < tokens->len; j++) {
+			tmp = g_ptr_array_index (tokens, j);
+			node = g_hash_table_lookup (words, tmp);
+			if (node == NULL) {
+				node = as_store_fuzzy_insert (priv->fuzzy_nodes, tmp);
+				g_hash_table_insert (words, node->word, node);
+			}
+
+			/* tokens of each application are added together */
+			if (node->apps->len > 0 &&
+			    g_ptr_array_index (node->apps, node->apps->len - 1) == app)
+				continue;
+			g_ptr_array_add (node->apps, app);
+		}
+	}
+
+	/* also allow looking up words by prefix */
+	priv->fuzzy_words = g_ptr_array_sized_new (priv->fuzzy_nodes->len);
+	for (i = 0; i < priv->fuzzy_nodes->len; i++)
+		g_ptr_array_add (priv->fuzzy_words, g_ptr_array_index (priv->fuzzy_nodes, i));
+	g_ptr_array_sort (priv->fuzzy_words, as_store_fuzzy_word_sort_cb);
+	return priv->fuzzy_nodes;
+}
+
+/**
+ * as_store_fuzzy_search_prefix:
+ *
+ * Adds the applications with a search token starting with @search, which
+ * the BK-tree cannot find as it only compares whole words.
+ **/
+static void
+as_store_fuzzy_search_prefix (GPtrArray *words,
+			      const gchar *search,
+			      GHashTable *hash)
+{
+	AsApp *app;
+	AsStoreFuzzyNode *node;
+	gchar *terms[] = { (gchar *) search, NULL };
+	guint i;
+	guint lo = 0;
+	guint hi = words->len;
+	guint mid;
+	guint score;
+	guint score_old;
+
+	/* find the first word not sorted before the prefix */
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		node = g_ptr_array_index (words, mid);
+		if (g_strcmp0 (node->word, search) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (; lo < words->len; lo++) {
+		node = g_ptr_array_index (words, lo);
+		if (!g_str_has_prefix (node->word, search))
+			break;
+		for (i = 0; i < node->apps->len; i++) {
+			app = g_ptr_array_index (node->apps, i);
+			score = MAX (as_app_search_matches_ranked (app, terms), 1);
+			score_old = GPOINTER_TO_UINT (g_hash_table_lookup (hash, app));
+			if (score > score_old)
+				g_hash_table_insert (hash, app, GUINT_TO_POINTER (score));
+		}
+	}
+}
+
+/**
+ * as_store_fuzzy_search_term:
+ *
+ * Returns a hash of AsApp:score for all the applications with a search token
+ * within @max_distance edits of @search, or starting with @search.
+ **/
+static GHashTable *
+as_store_fuzzy_search_term (GPtrArray *nodes,
+			    GPtrArray *words,
+			    const gchar *search,
+			    guint max_distance)
+{
+	AsApp *app;
+	AsStoreFuzzyNode *child;
+	AsStoreFuzzyNode *node;
+	GHashTable *hash;
+	glong len;
+	guint distance;
+	guint i;
+	guint score;
+	guint score_old;
+	_cleanup_free_ gunichar *ucs4 = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *stack = NULL;
+
+	hash = g_hash_table_new (g_direct_hash, g_direct_equal);
+	if (nodes->len == 0)
+		return hash;
+	as_store_fuzzy_search_prefix (words, search, hash);
+
+	/* only visit children where the triangle inequality allows a match */
+	ucs4 = g_utf8_to_ucs4_fast (search, -1, &len);
+	stack = g_ptr_array_new ();
+	g_ptr_array_add (stack, g_ptr_array_index (nodes, 0));
+	while (stack->len > 0) {
+		node = g_ptr_array_index (stack, stack->len - 1);
+		g_ptr_array_remove_index_fast (stack, stack->len - 1);
+		distance = as_store_fuzzy_distance (ucs4, len, node->ucs4, node->len);
+		for (child = node->child; child != NULL; child = child->next) {
+			if (child->distance + max_distance >= distance &&
+			    child->distance <= distance + max_distance)
+				g_ptr_array_add (stack, child);
+		}
+		if (distance > max_distance)
+			continue;
+
+		/* closer matches are better */
+		for (i = 0; i < node->apps->len; i++) {
+			gchar *words[] = { node->word, NULL };
+			app = g_ptr_array_index (node->apps, i);
+			score = as_app_search_matches_ranked (app, words);
+			score = MAX (score / (distance + 1), 1);
+			score_old = GPOINTER_TO_UINT (g_hash_table_lookup (hash, app));
+			if (score > score_old)
+				g_hash_table_insert (hash, app, GUINT_TO_POINTER (score));
+		}
+	}
+	return hash;
+}
+
+typedef struct {
+	GPtrArray		*results;
+	const gchar		*locale;
+	AsMarkupConvertFormat	 format;
+} AsStoreConvertHelper;
+
+/**
+ * as_store_convert_descriptions_partition_cb:
+ **/
+static void
+as_store_convert_descriptions_partition_cb (AsStorePartition *partition,
+					    gpointer user_data)
+{
+	AsStoreConvertHelper *helper = (AsStoreConvertHelper *) user_data;
+	AsApp *app;
+	const gchar *tmp;
+	guint i;
+	_cleanup_string_free_ GString *str = NULL;
+
+	/* one buffer for every description in the partition, and each
+	 * partition writes to its own part of the results */
+	str = g_string_new ("");
+	for (i = partition->start; i < partition->end; i++) {
+		_cleanup_error_free_ GError *error_local = NULL;
+		app = g_ptr_array_index (partition->apps, i);
+		tmp = as_app_get_description (app, helper->locale);
+		if (tmp == NULL)
+			continue;
+		g_string_truncate (str, 0);
+		if (!as_markup_convert_to_string (tmp, -1, helper->format,
+						  str, &error_local)) {
+			g_debug ("failed to convert description of %s: %s",
+				 as_app_get_id (app), error_local->message);
+			continue;
+		}
+		g_ptr_array_index (helper->results, i) = g_strndup (str->str, str->len);
+	}
+}
+
+/**
+ * as_store_convert_descriptions:
+ * @store: a #AsStore instance.
+ * @locale: the locale, or %NULL to use the users default locale
+ * @format: the #AsMarkupConvertFormat, e.g. %AS_MARKUP_CONVERT_FORMAT_SIMPLE
+ * @max_threads: the number of threads to use, or 0 for the number of CPUs
+ *
+ * Converts the description of every application in the store into a
+ * printable form, splitting the store into one partition per thread.
+ * The store must not be modified until this function returns.
+ *
+ * Returns: (element-type utf8) (transfer full): an array with the
+ * same length and order as as_store_get_apps(), where applications
+ * without a valid description have a %NULL entry
+ *
+ * Since: 0.5.0
+ **/
+GPtrArray *
+as_store_convert_descriptions (AsStore *store,
+			       const gchar *locale,
+			       AsMarkupConvertFormat format,
+			       guint max_threads)
+{
+	AsStoreConvertHelper helper;
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	GPtrArray *results;
+	_cleanup_ptrarray_unref_ GPtrArray *partitions = NULL;
+
+	g_return_val_if_fail (AS_IS_STORE (store), NULL);
+
+	results = g_ptr_array_new_with_free_func (g_free);
+	g_ptr_array_set_size (results, priv->array->len);
+	helper.results = results;
+	helper.locale = locale;
+	helper.format = format;
+	partitions = as_store_partition_run (store, max_threads,
+					     as_store_convert_descriptions_partition_cb,
+					     &helper);
+	return results;
+}
+
+/**
+ * as_store_search_fuzzy:
+ * @store: a #AsStore instance.
+ * @search: the search terms, e.g. from as_utils_search_tokenize()
+ * @max_distance: the maximum number of edits allowed for each term, e.g. 2
+ * @max_results: the maximum number of results to return, or 0 for no limit
+ *
+ * Finds all the applications that have a search token within @max_distance
+ * single character insertions, deletions or substitutions of all of the
+ * search terms, ordered so that the most relevant result is first.
+ *
+ * This allows misspelled searches such as "libreofice" to find results.
+ * Search tokens starting with a term are also matched, so "libreof" finds
+ * the same results. The vocabulary of search tokens is indexed in a BK-tree
+ * the first time this function is called, and the index is rebuilt when the
+ * store changes.
+ *
+ * Returns: (element-type AsApp) (transfer container): an array
+ *
+ * Since: 0.5.0
+ **/
+GPtrArray *
+as_store_search_fuzzy (AsStore *store,
+		       gchar **search,
+		       guint max_distance,
+		       guint max_results)
+{
+	AsApp *app;
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	GHashTableIter iter;
+	GPtrArray *nodes;
+	GPtrArray *results;
+	gpointer key;
+	gpointer value;
+	guint i;
+	guint score;
+	_cleanup_array_unref_ GArray *heap = NULL;
+	_cleanup_hashtable_unref_ GHashTable *scores = NULL;
+
+	g_return_val_if_fail (AS_IS_STORE (store), NULL);
+	g_return_val_if_fail (search != NULL, NULL);
+
+	/* every term has to match something */
+	g_mutex_lock (&priv->fuzzy_mutex);
+	nodes = as_store_fuzzy_ensure (store);
+	for (i = 0; search[i] != NULL; i++) {
+		_cleanup_hashtable_unref_ GHashTable *term = NULL;
+		term = as_store_fuzzy_search_term (nodes, priv->fuzzy_words,
+						   search[i], max_distance);
+		if (scores == NULL) {
+			scores = g_hash_table_ref (term);
+			continue;
+		}
+		g_hash_table_iter_init (&iter, scores);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			score = GPOINTER_TO_UINT (g_hash_table_lookup (term, key));
+			if (score == 0) {
+				g_hash_table_iter_remove (&iter);
+				continue;
+			}
+			score += GPOINTER_TO_UINT (value);
+			g_hash_table_iter_replace (&iter, GUINT_TO_POINTER (score));
+		}
+	}
+
+	/* sort the results */
+	heap = g_array_new (FALSE, FALSE, sizeof (AsStoreSearchResult));
+	if (scores != NULL) {
+		g_hash_table_iter_init (&iter, scores);
+		while (g_hash_table_iter_next (&iter, &key, &value)) {
+			app = AS_APP (key);
+			as_store_search_results_add (heap, max_results, app,
+						     GPOINTER_TO_UINT (value));
+		}
+	}
+	results = as_store_search_results_to_array (heap);
+	g_mutex_unlock (&priv->fuzzy_mutex);
+	return results;
+}
+
+/**
+ * as_store_remove_app:
+ * @store: a #AsStore instance.
+ * @app: a #AsApp instance.
+ *
+ * Removes an application from the store if it exists.
+ *
+ * Since: 0.1.0
+ **/
+void
+as_store_remove_app (AsStore *store, AsApp *app)
+{
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	guint i;
+
+	as_store_fuzzy_invalidate (store);
+	g_hash_table_remove (priv->hash_id, as_app_get_id (app));
+	as_store_remove_id_renames (store, as_app_get_id (app));
+	for (i = 0; i < priv->array->len; i++) {
+		if (g_ptr_array_index (priv->array, i) != app)
+			continue;
+		as_store_changes_removed (store, app);
+		g_ptr_array_remove_index (priv->array, i);
+		break;
+	}
+	g_hash_table_remove_all (priv->metadata_indexes);
+
+	/* removed */
+	as_store_perhaps_emit_changed (store, "remove-app");
+}
+
+/**
+ * as_store_remove_app_by_id:
+ * @store: a #AsStore instance.
+ * @id: an application id
+ *
+ * Removes an application from the store if it exists.
+ *
+ * Since: 0.3.0
+ **/
+void
+as_store_remove_app_by_id (AsStore *store, const gchar *id)
+{
+	AsApp *app;
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	guint i;
+
+	if (!g_hash_table_remove (priv->hash_id, id))
+		return;
+	as_store_remove_id_renames (store, id);
+	as_store_fuzzy_invalidate (store);
+	for (i = 0; i < priv->array->len; i++) {
+		app = g_ptr_array_index (priv->array, i);
+		if (g_strcmp0 (id, as_app_get_id (app)) != 0)
+			continue;
+		as_store_changes_removed (store, app);
+		g_ptr_array_remove (priv->array, app);
+	}
+	g_hash_table_remove_all (priv->metadata_indexes);
+
+	/* removed */
+	as_store_perhaps_emit_changed (store, "remove-app-by-id");
+}
+
+/**
+ * as_store_app_is_identical:
+ *
+ * Returns %TRUE if both components were parsed from the same metadata and
+ * would be treated the same way when added, even if they came from
+ * different catalogues.
+ **/
+static gboolean
+as_store_app_is_identical (AsApp *app1, AsApp *app2)
+{
+	const gchar *hash1 = as_app_get_content_hash (app1);
+	const gchar *hash2 = as_app_get_content_hash (app2);
+
+	if (hash1 == NULL || hash2 == NULL)
+		return FALSE;
+	if (as_app_get_source_kind (app1) != as_app_get_source_kind (app2))
+		return FALSE;
+	if (as_app_get_priority (app1) != as_app_get_priority (app2))
+		return FALSE;
+	return g_strcmp0 (hash1, hash2) == 0;
+}
+
+/**
+ * as_store_add_app_internal:
+ *
+ * Returns %TRUE if @app itself was added, rather than being merged into or
+ * ignored in favour of an application already in the store.
+ **/
+static gboolean
+as_store_add_app_internal (AsStore *store, AsApp *app)
+{
+	AsApp *item;
+	AsProvide *provide;
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	GPtrArray *pkgnames;
+	GPtrArray *provides;
+	const gchar *id;
+	const gchar *pkgname;
+	guint i;
+
+	/* have we recorded this before? */
+	id = as_app_get_id (app);
+	if (id == NULL) {
+		g_warning ("application has no ID set");
+		return FALSE;
+	}
+
+	/* any IDs the component used previously */
+	provides = as_app_get_provides (app);
+	for (i = 0; i < provides->len; i++) {
+		provide = g_ptr_array_index (provides, i);
+		if (as_provide_get_kind (provide) != AS_PROVIDE_KIND_ID)
+			continue;
+		as_store_add_id_rename (store, as_provide_get_value (provide), id);
+	}
+
+	item = g_hash_table_lookup (priv->hash_id, id);
+	if (item != NULL) {
+
+		/* the same metadata, perhaps from another catalogue; only
+		 * record where it came from rather than merging */
+		if (as_store_app_is_identical (item, app)) {
+			g_debug ("ignoring identical duplicate: %s", id);
+			if (as_app_get_origin (app) != NULL)
+				as_app_set_origin (item, as_app_get_origin (app));
+			if (as_app_get_source_file (app) != NULL)
+				as_app_set_source_file (item, as_app_get_source_file (app));
+			return FALSE;
+		}
+
+		/* the previously stored app is what we actually want */
+		if ((priv->add_flags & AS_STORE_ADD_FLAG_PREFER_LOCAL) > 0) {
+
+			if (as_app_get_source_kind (app) == AS_APP_SOURCE_KIND_APPSTREAM &&
+			    as_app_get_source_kind (item) == AS_APP_SOURCE_KIND_APPDATA) {
+				g_debug ("ignoring AppStream entry as AppData exists: %s", id);
+				return FALSE;
+			}
+			if (as_app_get_source_kind (app) == AS_APP_SOURCE_KIND_APPSTREAM &&
 			    as_app_get_source_kind (item) == AS_APP_SOURCE_KIND_DESKTOP) {
 				g_debug ("ignoring AppStream entry as desktop exists: %s", id);
-				return;
+				return FALSE;
 			}
 			if (as_app_get_source_kind (app) == AS_APP_SOURCE_KIND_APPDATA &&
 			    as_app_get_source_kind (item) == AS_APP_SOURCE_KIND_DESKTOP) {
@@ -685,27 +1875,33 @@ as_store_add_app (AsStore *store, AsApp *app)
 				as_app_subsume_full (app, item, AS_APP_SUBSUME_FLAG_BOTH_WAYS);
 				/* promote the desktop source to AppData */
 				as_app_set_source_kind (item, AS_APP_SOURCE_KIND_APPDATA);
-				return;
+				as_store_fuzzy_invalidate (store);
+				as_store_changes_updated (store, item);
+				return FALSE;
 			}
 			if (as_app_get_source_kind (app) == AS_APP_SOURCE_KIND_DESKTOP &&
 			    as_app_get_source_kind (item) == AS_APP_SOURCE_KIND_APPDATA) {
 				g_debug ("merging duplicate desktop:AppData entries: %s", id);
 				as_app_subsume_full (app, item, AS_APP_SUBSUME_FLAG_BOTH_WAYS);
-				return;
+				as_store_fuzzy_invalidate (store);
+				as_store_changes_updated (store, item);
+				return FALSE;
 			}
 
 		} else {
 			if (as_app_get_source_kind (app) == AS_APP_SOURCE_KIND_APPDATA &&
 			    as_app_get_source_kind (item) == AS_APP_SOURCE_KIND_APPSTREAM) {
 				as_app_set_state (item, AS_APP_STATE_INSTALLED);
+				as_store_changes_updated (store, item);
 				g_debug ("ignoring AppData entry as AppStream exists: %s", id);
-				return;
+				return FALSE;
 			}
 			if (as_app_get_source_kind (app) == AS_APP_SOURCE_KIND_DESKTOP &&
 			    as_app_get_source_kind (item) == AS_APP_SOURCE_KIND_APPSTREAM) {
 				as_app_set_state (item, AS_APP_STATE_INSTALLED);
+				as_store_changes_updated (store, item);
 				g_debug ("ignoring desktop entry as AppStream exists: %s", id);
-				return;
+				return FALSE;
 			}
 
 			/* the previously stored app is higher priority */
@@ -715,7 +1911,7 @@ as_store_add_app (AsStore *store, AsApp *app)
 					 as_app_source_kind_to_string (as_app_get_source_kind (app)),
 					 as_app_source_kind_to_string (as_app_get_source_kind (item)),
 					 id);
-				return;
+				return FALSE;
 			}
 
 			/* same priority */
@@ -732,7 +1928,11 @@ as_store_add_app (AsStore *store, AsApp *app)
 				if (as_app_get_source_kind (item) == AS_APP_SOURCE_KIND_DESKTOP &&
 				    as_app_get_source_kind (app) == AS_APP_SOURCE_KIND_APPDATA)
 					as_app_set_source_kind (item, AS_APP_SOURCE_KIND_APPDATA);
-				return;
+
+				/* the merged names and keywords need indexing */
+				as_store_fuzzy_invalidate (store);
+				as_store_changes_updated (store, item);
+				return FALSE;
 			}
 		}
 
@@ -741,11 +1941,14 @@ as_store_add_app (AsStore *store, AsApp *app)
 		g_debug ("removing %s entry: %s",
 			 as_app_source_kind_to_string (as_app_get_source_kind (item)),
 			 id);
+		as_store_fuzzy_invalidate (store);
 		g_hash_table_remove (priv->hash_id, id);
+		as_store_changes_removed (store, item);
 		g_ptr_array_remove (priv->array, item);
 	}
 
 	/* success, add to array */
+	as_store_fuzzy_invalidate (store);
 	g_ptr_array_add (priv->array, g_object_ref (app));
 	g_hash_table_insert (priv->hash_id,
 			     (gpointer) as_app_get_id (app),
@@ -759,7 +1962,27 @@ as_store_add_app (AsStore *store, AsApp *app)
 	}
 
 	/* added */
+	as_store_changes_added (store, app);
 	as_store_perhaps_emit_changed (store, "add-app");
+	return TRUE;
+}
+
+/**
+ * as_store_add_app:
+ * @store: a #AsStore instance.
+ * @app: a #AsApp instance.
+ *
+ * Adds an application to the store. If a lower priority application has already
+ * been added then this new application will replace it.
+ *
+ * Additionally only applications where the kind is known will be added.
+ *
+ * Since: 0.1.0
+ **/
+void
+as_store_add_app (AsStore *store, AsApp *app)
+{
+	as_store_add_app_internal (store, app);
 }
 
 /**
@@ -792,10 +2015,36 @@ as_store_match_addons (AsStore *store)
 			if (parent == NULL)
 				continue;
 			as_app_add_addon (parent, app);
+			as_store_changes_updated (store, parent);
 		}
 	}
 }
 
+/**
+ * as_store_app_get_content_hash:
+ *
+ * Returns a checksum of the metadata the component was parsed from, or
+ * failing that of everything that would be written for it, so that two
+ * versions of it can be compared cheaply.
+ **/
+static gchar *
+as_store_app_get_content_hash (AsApp *app, AsNodeContext *ctx)
+{
+	_cleanup_node_unref_ GNode *root = NULL;
+	_cleanup_string_free_ GString *xml = NULL;
+
+	/* already worked out when parsed */
+	if (as_app_get_content_hash (app) != NULL)
+		return g_strdup (as_app_get_content_hash (app));
+
+	root = as_node_new ();
+	as_app_node_insert (app, root, ctx);
+	xml = as_node_to_xml (root, AS_NODE_TO_XML_FLAG_NONE);
+	return g_compute_checksum_for_data (G_CHECKSUM_SHA1,
+					    (const guchar *) xml->str,
+					    xml->len);
+}
+
 /**
  * as_store_from_root:
  **/
@@ -810,6 +2059,7 @@ as_store_from_root (AsStore *store,
 	GNode *apps;
 	GNode *n;
 	const gchar *tmp;
+	GHashTable *hashes = NULL;
 	_cleanup_free_ AsNodeContext *ctx = NULL;
 	_cleanup_free_ gchar *icon_path = NULL;
 	_cleanup_uninhibit_ guint32 *tok = NULL;
@@ -855,6 +2105,14 @@ as_store_from_root (AsStore *store,
 					      priv->origin,
 					      NULL);
 	}
+	/* what the file contained, to compare with when it changes */
+	if (source_filename != NULL) {
+		hashes = g_hash_table_new_full (g_str_hash, g_str_equal,
+						g_free, g_free);
+		g_hash_table_insert (priv->content_hashes,
+				     g_strdup (source_filename), hashes);
+	}
+
 	ctx = as_node_context_new ();
 	for (n = apps->children; n != NULL; n = n->next) {
 		_cleanup_error_free_ GError *error_local = NULL;
@@ -888,6 +2146,13 @@ as_store_from_root (AsStore *store,
 		as_app_set_origin (app, priv->origin);
 		if (source_filename != NULL)
 			as_app_set_source_file (app, source_filename);
+
+		/* before it is merged with anything else */
+		if (hashes != NULL && as_app_get_id (app) != NULL) {
+			g_hash_table_insert (hashes,
+					     g_strdup (as_app_get_id (app)),
+					     as_store_app_get_content_hash (app, ctx));
+		}
 		as_store_add_app (store, app);
 	}
 
@@ -901,8 +2166,260 @@ as_store_from_root (AsStore *store,
 	return TRUE;
 }
 
+typedef struct {
+	AsStore		*store;
+	AsNodeContext	*ctx;
+	const gchar	*icon_root;
+	gchar		*icon_path;
+	gboolean	 got_header;
+	GThreadPool	*pool;
+	GPtrArray	*docs;		/* of AsStoreYamlDocument */
+	GPtrArray	*apps;		/* of AsApp */
+} AsStoreYamlHelper;
+
+typedef struct {
+	gchar		*data;
+	gsize		 data_len;
+	const gchar	*icon_path;
+	AsApp		*app;
+	GError		*error;
+} AsStoreYamlDocument;
+
+/**
+ * as_store_load_yaml_header:
+ **/
+static void
+as_store_load_yaml_header (AsStoreYamlHelper *helper, GNode *node)
+{
+	AsStorePrivate *priv = GET_PRIVATE (helper->store);
+	GNode *n;
+	const gchar *tmp;
+
+	/* get header information */
+	for (n = node->children; n != NULL; n = n->next) {
+		tmp = as_yaml_node_get_key (n);
+		if (g_strcmp0 (tmp, "Origin") == 0) {
+			as_store_set_origin (helper->store, as_yaml_node_get_value (n));
+			continue;
+		}
+		if (g_strcmp0 (tmp, "Version") == 0) {
+			if (as_yaml_node_get_value (n) != NULL)
+				as_store_set_api_version (helper->store, g_ascii_strtod (as_yaml_node_get_value (n), NULL));
+			continue;
+		}
+	}
+
+	/* if we have an origin either from the YAML or _set_origin() */
+	if (priv->origin != NULL) {
+		const gchar *icon_root = helper->icon_root;
+		if (icon_root == NULL)
+			icon_root = "/usr/share/app-info/icons/";
+		helper->icon_path = g_build_filename (icon_root,
+						      priv->origin,
+						      NULL);
+	}
+}
+
+/**
+ * as_store_load_yaml_document_cb:
+ **/
+static gboolean
+as_store_load_yaml_document_cb (GNode *root, gpointer user_data, GError **error)
+{
+	AsStoreYamlHelper *helper = (AsStoreYamlHelper *) user_data;
+	AsStorePrivate *priv = GET_PRIVATE (helper->store);
+	GNode *app_n = root->children;
+	_cleanup_object_unref_ AsApp *app = NULL;
+
+	if (app_n == NULL)
+		return TRUE;
+
+	/* the first document is the header */
+	if (!helper->got_header) {
+		as_store_load_yaml_header (helper, app_n);
+		helper->got_header = TRUE;
+		return TRUE;
+	}
+
+	/* parse application */
+	if (app_n->children == NULL)
+		return TRUE;
+	app = as_app_new ();
+	if (helper->icon_path != NULL)
+		as_app_set_icon_path (app, helper->icon_path);
+	as_app_set_source_kind (app, AS_APP_SOURCE_KIND_APPSTREAM);
+	if (!as_app_node_parse_dep11 (app, app_n, helper->ctx, error))
+		return FALSE;
+	as_app_set_origin (app, priv->origin);
+	if (as_app_get_id (app) != NULL)
+		g_ptr_array_add (helper->apps, g_object_ref (app));
+	return TRUE;
+}
+
+/**
+ * as_store_yaml_document_free:
+ **/
+static void
+as_store_yaml_document_free (AsStoreYamlDocument *doc)
+{
+	g_free (doc->data);
+	if (doc->app != NULL)
+		g_object_unref (doc->app);
+	if (doc->error != NULL)
+		g_error_free (doc->error);
+	g_slice_free (AsStoreYamlDocument, doc);
+}
+
+/**
+ * as_store_load_yaml_thread_cb:
+ **/
+static void
+as_store_load_yaml_thread_cb (gpointer data, gpointer user_data)
+{
+	AsStoreYamlDocument *doc = (AsStoreYamlDocument *) data;
+	GNode *app_n;
+	_cleanup_free_ AsNodeContext *ctx = NULL;
+	_cleanup_object_unref_ AsApp *app = NULL;
+	_cleanup_yaml_unref_ GNode *root = NULL;
+
+	root = as_yaml_from_data (doc->data, doc->data_len, &doc->error);
+	g_free (doc->data);
+	doc->data = NULL;
+	if (root == NULL)
+		return;
+	app_n = root->children;
+	if (app_n == NULL || app_n->children == NULL)
+		return;
+
+	/* parse application */
+	ctx = as_node_context_new ();
+	app = as_app_new ();
+	if (doc->icon_path != NULL)
+		as_app_set_icon_path (app, doc->icon_path);
+	as_app_set_source_kind (app, AS_APP_SOURCE_KIND_APPSTREAM);
+	if (!as_app_node_parse_dep11 (app, app_n, ctx, &doc->error))
+		return;
+	doc->app = g_object_ref (app);
+}
+
+/**
+ * as_store_load_yaml_split_cb:
+ **/
+static gboolean
+as_store_load_yaml_split_cb (const gchar *data, gsize data_len,
+			     gpointer user_data, GError **error)
+{
+	AsStoreYamlHelper *helper = (AsStoreYamlHelper *) user_data;
+	AsStoreYamlDocument *doc;
+
+	/* the header is needed before any application can be parsed */
+	if (!helper->got_header) {
+		_cleanup_yaml_unref_ GNode *root = NULL;
+		root = as_yaml_from_data (data, data_len, error);
+		if (root == NULL)
+			return FALSE;
+		if (root->children == NULL)
+			return TRUE;
+		as_store_load_yaml_header (helper, root->children);
+		helper->got_header = TRUE;
+		return TRUE;
+	}
+
+	/* parse the application in a worker thread */
+	doc = g_slice_new0 (AsStoreYamlDocument);
+	doc->data = g_strndup (data, data_len);
+	doc->data_len = data_len;
+	doc->icon_path = helper->icon_path;
+	g_ptr_array_add (helper->docs, doc);
+	return g_thread_pool_push (helper->pool, doc, error);
+}
+
+/**
+ * as_store_load_yaml_file_parallel:
+ *
+ * The file is split into documents which are parsed in a thread pool,
+ * and the applications are then added to the store in file order.
+ **/
+static gboolean
+as_store_load_yaml_file_parallel (AsStore *store,
+				  GFile *file,
+				  const gchar *icon_root,
+				  guint max_threads,
+				  GCancellable *cancellable,
+				  GError **error)
+{
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	AsStoreYamlDocument *doc;
+	AsStoreYamlHelper helper;
+	gboolean ret;
+	guint i;
+	_cleanup_ptrarray_unref_ GPtrArray *docs = NULL;
+	_cleanup_uninhibit_ guint32 *tok = NULL;
+
+	/* emit once when finished */
+	tok = as_store_changed_inhibit (store);
+
+	/* parse each document in the pool */
+	docs = g_ptr_array_new_with_free_func ((GDestroyNotify) as_store_yaml_document_free);
+	helper.store = store;
+	helper.ctx = NULL;
+	helper.icon_root = icon_root;
+	helper.icon_path = NULL;
+	helper.got_header = FALSE;
+	helper.docs = docs;
+	helper.apps = NULL;
+	helper.pool = g_thread_pool_new (as_store_load_yaml_thread_cb,
+					 NULL,
+					 max_threads,
+					 TRUE,
+					 error);
+	if (helper.pool == NULL)
+		return FALSE;
+	ret = as_yaml_from_file_split (file,
+				       as_store_load_yaml_split_cb,
+				       &helper,
+				       cancellable,
+				       error);
+
+	/* wait for them to finish */
+	g_thread_pool_free (helper.pool, FALSE, TRUE);
+	g_free (helper.icon_path);
+	if (!ret)
+		return FALSE;
+
+	/* nothing is added unless every document was parsed */
+	for (i = 0; i < docs->len; i++) {
+		doc = g_ptr_array_index (docs, i);
+		if (doc->error != NULL) {
+			g_propagate_error (error, doc->error);
+			doc->error = NULL;
+			return FALSE;
+		}
+	}
+
+	/* add in order */
+	for (i = 0; i < docs->len; i++) {
+		doc = g_ptr_array_index (docs, i);
+		if (doc->app == NULL)
+			continue;
+		as_app_set_origin (doc->app, priv->origin);
+		if (as_app_get_id (doc->app) != NULL)
+			as_store_add_app (store, doc->app);
+	}
+
+	/* emit changed */
+	as_store_changed_uninhibit (&tok);
+	as_store_perhaps_emit_changed (store, "yaml-file");
+
+	return TRUE;
+}
+
 /**
  * as_store_load_yaml_file:
+ *
+ * Each component document is parsed as soon as it has been read, so the
+ * whole file is never held in memory, but nothing is added to the store
+ * if any part of the file cannot be parsed.
  **/
 static gboolean
 as_store_load_yaml_file (AsStore *store,
@@ -912,100 +2429,471 @@ as_store_load_yaml_file (AsStore *store,
 			 GError **error)
 {
 	AsStorePrivate *priv = GET_PRIVATE (store);
-	GNode *app_n;
-	GNode *n;
-	const gchar *tmp;
+	AsStoreYamlHelper helper;
+	gboolean ret;
+	guint i;
+	guint max_threads;
 	_cleanup_free_ AsNodeContext *ctx = NULL;
-	_cleanup_free_ gchar *icon_path = NULL;
-	_cleanup_yaml_unref_ GNode *root = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *apps = NULL;
 	_cleanup_uninhibit_ guint32 *tok = NULL;
 
-	/* load file */
-	root = as_yaml_from_file (file, cancellable, error);
-	if (root == NULL)
+	/* parse documents in parallel if allowed */
+	max_threads = priv->max_threads;
+	if (max_threads == 0)
+		max_threads = g_get_num_processors ();
+	if (max_threads > 1) {
+		return as_store_load_yaml_file_parallel (store, file, icon_root,
+							 max_threads,
+							 cancellable, error);
+	}
+
+	/* emit once when finished */
+	tok = as_store_changed_inhibit (store);
+
+	/* parse applications, which are only added to the store once the
+	 * whole file has been read successfully */
+	ctx = as_node_context_new ();
+	apps = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	helper.store = store;
+	helper.ctx = ctx;
+	helper.icon_root = icon_root;
+	helper.icon_path = NULL;
+	helper.got_header = FALSE;
+	helper.pool = NULL;
+	helper.docs = NULL;
+	helper.apps = apps;
+	ret = as_yaml_from_file_foreach (file,
+					 as_store_load_yaml_document_cb,
+					 &helper,
+					 cancellable,
+					 error);
+	g_free (helper.icon_path);
+	if (!ret)
 		return FALSE;
+	for (i = 0; i < apps->len; i++)
+		as_store_add_app (store, g_ptr_array_index (apps, i));
 
-	/* get header information */
-	for (n = root->children->children; n != NULL; n = n->next) {
-		tmp = as_yaml_node_get_key (n);
-		if (g_strcmp0 (tmp, "Origin") == 0) {
-			as_store_set_origin (store, as_yaml_node_get_value (n));
+	/* emit changed */
+	as_store_changed_uninhibit (&tok);
+	as_store_perhaps_emit_changed (store, "yaml-file");
+
+	return TRUE;
+}
+
+/**
+ * as_store_remove_by_source_file:
+ */
+static void
+as_store_remove_by_source_file (AsStore *store, const gchar *filename)
+{
+	AsApp *app;
+	GPtrArray *apps;
+	guint i;
+	const gchar *tmp;
+	_cleanup_ptrarray_unref_ GPtrArray *ids = NULL;
+	_cleanup_uninhibit_ guint32 *tok = NULL;
+
+	/* emit once when finished */
+	tok = as_store_changed_inhibit (store);
+
+	/* find any applications in the store with this source file */
+	ids = g_ptr_array_new_with_free_func (g_free);
+	apps = as_store_get_apps (store);
+	for (i = 0; i < apps->len; i++) {
+		app = g_ptr_array_index (apps, i);
+		if (g_strcmp0 (as_app_get_source_file (app), filename) != 0)
 			continue;
+		g_ptr_array_add (ids, g_strdup (as_app_get_id (app)));
+	}
+
+	/* remove these from the store */
+	for (i = 0; i < ids->len; i++) {
+		tmp = g_ptr_array_index (ids, i);
+		g_debug ("removing %s as %s invalid", tmp, filename);
+		as_store_remove_app_by_id (store, tmp);
+	}
+
+	/* the store changed */
+	as_store_changed_uninhibit (&tok);
+	as_store_perhaps_emit_changed (store, "remove-by-source-file");
+}
+
+/**
+ * as_store_add_addon_once:
+ **/
+static void
+as_store_add_addon_once (AsStore *store, AsApp *parent, AsApp *addon)
+{
+	GPtrArray *addons = as_app_get_addons (parent);
+	guint i;
+
+	for (i = 0; i < addons->len; i++) {
+		if (g_ptr_array_index (addons, i) == addon)
+			return;
+	}
+	as_app_add_addon (parent, addon);
+	as_store_changes_updated (store, parent);
+}
+
+/**
+ * as_store_match_addons_app:
+ *
+ * Links one new application with its parents, or with the addons already
+ * in the store, without rescanning everything.
+ **/
+static void
+as_store_match_addons_app (AsStore *store, AsApp *app)
+{
+	AsApp *item;
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	GPtrArray *extends;
+	guint i;
+	guint j;
+
+	/* an addon for something already in the store */
+	if (as_app_get_id_kind (app) == AS_ID_KIND_ADDON) {
+		extends = as_app_get_extends (app);
+		for (i = 0; i < extends->len; i++) {
+			item = g_hash_table_lookup (priv->hash_id,
+						    g_ptr_array_index (extends, i));
+			if (item != NULL && item != app)
+				as_store_add_addon_once (store, item, app);
 		}
-		if (g_strcmp0 (tmp, "Version") == 0) {
-			if (as_yaml_node_get_value (n) != NULL)
-				as_store_set_api_version (store, g_ascii_strtod (as_yaml_node_get_value (n), NULL));
+		return;
+	}
+
+	/* a parent for addons already in the store */
+	for (i = 0; i < priv->array->len; i++) {
+		item = g_ptr_array_index (priv->array, i);
+		if (as_app_get_id_kind (item) != AS_ID_KIND_ADDON)
 			continue;
+		extends = as_app_get_extends (item);
+		for (j = 0; j < extends->len; j++) {
+			if (g_strcmp0 (g_ptr_array_index (extends, j),
+				       as_app_get_id (app)) == 0)
+				as_store_add_addon_once (store, app, item);
 		}
 	}
+}
 
-	/* if we have an origin either from the YAML or _set_origin() */
-	if (priv->origin != NULL) {
-		if (icon_root == NULL)
-			icon_root = "/usr/share/app-info/icons/";
-		icon_path = g_build_filename (icon_root,
-					      priv->origin,
-					      NULL);
+/**
+ * as_store_remove_app_incremental:
+ **/
+static void
+as_store_remove_app_incremental (AsStore *store, AsApp *app)
+{
+	AsApp *parent;
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	GPtrArray *extends;
+	guint i;
+
+	/* unlink from the parents as the addon is going away */
+	if (as_app_get_id_kind (app) == AS_ID_KIND_ADDON) {
+		extends = as_app_get_extends (app);
+		for (i = 0; i < extends->len; i++) {
+			parent = g_hash_table_lookup (priv->hash_id,
+						      g_ptr_array_index (extends, i));
+			if (parent == NULL)
+				continue;
+			if (g_ptr_array_remove (as_app_get_addons (parent), app))
+				as_store_changes_updated (store, parent);
+		}
+	}
+	as_store_remove_app (store, app);
+}
+
+/**
+ * as_store_new_scratch:
+ *
+ * Creates a store with the same settings, for a file to be parsed into
+ * without touching this store.
+ **/
+static AsStore *
+as_store_new_scratch (AsStore *store)
+{
+	AsStore *store_new;
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	AsStorePrivate *priv_new;
+
+	store_new = as_store_new ();
+	priv_new = GET_PRIVATE (store_new);
+	as_store_set_origin (store_new, priv->origin);
+	priv_new->add_flags = priv->add_flags;
+	priv_new->filter = priv->filter;
+	priv_new->max_threads = priv->max_threads;
+	return store_new;
+}
+
+/**
+ * as_store_apply_file:
+ *
+ * Compares each component parsed into @store_new with what was previously
+ * loaded from that file, by ID and content hash. Only the components that
+ * were added, removed or changed are applied to the store, and ::changed
+ * is emitted once for the whole file.
+ **/
+static void
+as_store_apply_file (AsStore *store,
+		     const gchar *filename,
+		     AsStore *store_new)
+{
+	AsApp *app;
+	AsApp *app_old;
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	AsStorePrivate *priv_new = GET_PRIVATE (store_new);
+	GHashTable *hashes_old;
+	GHashTableIter iter;
+	GPtrArray *apps_new;
+	const gchar *hash_old;
+	const gchar *id;
+	guint cnt_added = 0;
+	guint cnt_changed = 0;
+	guint i;
+	_cleanup_free_ AsNodeContext *ctx = NULL;
+	_cleanup_hashtable_unref_ GHashTable *apps_old = NULL;
+	_cleanup_hashtable_unref_ GHashTable *hashes_new = NULL;
+	_cleanup_uninhibit_ guint32 *tok = NULL;
+
+	/* the file may have set these */
+	if (priv_new->origin != NULL)
+		as_store_set_origin (store, priv_new->origin);
+	if (priv_new->builder_id != NULL)
+		as_store_set_builder_id (store, priv_new->builder_id);
+
+	/* what we loaded from this file last time */
+	apps_old = g_hash_table_new_full (g_str_hash, g_str_equal,
+					  g_free, (GDestroyNotify) g_object_unref);
+	for (i = 0; i < priv->array->len; i++) {
+		app = g_ptr_array_index (priv->array, i);
+		if (g_strcmp0 (as_app_get_source_file (app), filename) != 0)
+			continue;
+		g_hash_table_insert (apps_old,
+				     g_strdup (as_app_get_id (app)),
+				     g_object_ref (app));
 	}
+	hashes_old = g_hash_table_lookup (priv->content_hashes, filename);
 
 	/* emit once when finished */
 	tok = as_store_changed_inhibit (store);
 
-	/* parse applications */
 	ctx = as_node_context_new ();
-	for (app_n = root->children->next; app_n != NULL; app_n = app_n->next) {
-		_cleanup_object_unref_ AsApp *app = NULL;
-		if (app_n->children == NULL)
+	as_node_context_set_version (ctx, AS_API_VERSION_NEWEST);
+	as_node_context_set_output (ctx, AS_APP_SOURCE_KIND_APPSTREAM);
+	hashes_new = g_hash_table_new_full (g_str_hash, g_str_equal,
+					    g_free, g_free);
+	apps_new = as_store_get_apps (store_new);
+	for (i = 0; i < apps_new->len; i++) {
+		gchar *hash_new;
+
+		app = g_ptr_array_index (apps_new, i);
+		id = as_app_get_id (app);
+		hash_new = as_store_app_get_content_hash (app, ctx);
+		g_hash_table_insert (hashes_new, g_strdup (id), hash_new);
+
+		/* new component */
+		app_old = g_hash_table_lookup (apps_old, id);
+		if (app_old == NULL) {
+			if (as_store_add_app_internal (store, app))
+				as_store_match_addons_app (store, app);
+			cnt_added++;
 			continue;
-		app = as_app_new ();
-		if (icon_path != NULL)
-			as_app_set_icon_path (app, icon_path);
-		as_app_set_source_kind (app, AS_APP_SOURCE_KIND_APPSTREAM);
-		if (!as_app_node_parse_dep11 (app, app_n, ctx, error))
-			return FALSE;
-		as_app_set_origin (app, priv->origin);
-		if (as_app_get_id (app) != NULL)
-			as_store_add_app (store, app);
+		}
+
+		/* keep the existing object if nothing has changed; the
+		 * hashes were recorded before anything was merged into it,
+		 * and without one it has to be replaced */
+		hash_old = NULL;
+		if (hashes_old != NULL)
+			hash_old = g_hash_table_lookup (hashes_old, id);
+		if (g_strcmp0 (hash_old, hash_new) != 0) {
+			as_store_remove_app_incremental (store, app_old);
+			if (as_store_add_app_internal (store, app))
+				as_store_match_addons_app (store, app);
+			cnt_changed++;
+		}
+		g_hash_table_remove (apps_old, id);
 	}
 
-	/* emit changed */
+	/* anything left over is no longer in the file */
+	g_hash_table_iter_init (&iter, apps_old);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &app_old))
+		as_store_remove_app_incremental (store, app_old);
+	g_debug ("%s: %u added, %u removed, %u changed",
+		 filename, cnt_added, g_hash_table_size (apps_old), cnt_changed);
+
+	/* compare against these next time */
+	g_hash_table_insert (priv->content_hashes,
+			     g_strdup (filename),
+			     g_hash_table_ref (hashes_new));
+
+	/* emit if anything was applied */
 	as_store_changed_uninhibit (&tok);
-	as_store_perhaps_emit_changed (store, "yaml-file");
+	as_store_perhaps_emit_changed (store, "file changed incrementally");
+}
+
+/**
+ * as_store_reload_file_incremental:
+ *
+ * Parses the new version of a file on its own and applies the differences.
+ *
+ * If the file cannot be parsed the store is left untouched, as it is
+ * likely to be rewritten again shortly.
+ **/
+static gboolean
+as_store_reload_file_incremental (AsStore *store,
+				  const gchar *filename,
+				  GError **error)
+{
+	_cleanup_object_unref_ AsStore *store_new = NULL;
+	_cleanup_object_unref_ GFile *file = NULL;
 
+	/* parse the file into a scratch store using the same settings */
+	store_new = as_store_new_scratch (store);
+	file = g_file_new_for_path (filename);
+	if (!as_store_from_file (store_new, file, NULL, NULL, error))
+		return FALSE;
+	as_store_apply_file (store, filename, store_new);
 	return TRUE;
 }
 
+typedef struct {
+	gchar		*filename;
+	GWeakRef	 store;
+	AsStore		*store_new;
+} AsStoreReloadHelper;
+
 /**
- * as_store_remove_by_source_file:
- */
+ * as_store_reload_helper_free:
+ **/
 static void
-as_store_remove_by_source_file (AsStore *store, const gchar *filename)
+as_store_reload_helper_free (AsStoreReloadHelper *helper)
 {
-	AsApp *app;
-	GPtrArray *apps;
-	guint i;
-	const gchar *tmp;
-	_cleanup_ptrarray_unref_ GPtrArray *ids = NULL;
+	g_free (helper->filename);
+	g_weak_ref_clear (&helper->store);
+	g_object_unref (helper->store_new);
+	g_slice_free (AsStoreReloadHelper, helper);
+}
 
-	/* find any applications in the store with this source file */
-	ids = g_ptr_array_new_with_free_func (g_free);
-	apps = as_store_get_apps (store);
-	for (i = 0; i < apps->len; i++) {
-		app = g_ptr_array_index (apps, i);
-		if (g_strcmp0 (as_app_get_source_file (app), filename) != 0)
-			continue;
-		g_ptr_array_add (ids, g_strdup (as_app_get_id (app)));
+/**
+ * as_store_reload_thread_cb:
+ *
+ * Only the scratch store is touched in the worker thread.
+ **/
+static void
+as_store_reload_thread_cb (GTask *task,
+			   gpointer source_object,
+			   gpointer task_data,
+			   GCancellable *cancellable)
+{
+	AsStoreReloadHelper *helper = (AsStoreReloadHelper *) task_data;
+	GError *error = NULL;
+	_cleanup_object_unref_ GFile *file = NULL;
+
+	file = g_file_new_for_path (helper->filename);
+	if (!as_store_from_file (helper->store_new, file, NULL,
+				 cancellable, &error)) {
+		g_task_return_error (task, error);
+		return;
 	}
+	if (g_task_return_error_if_cancelled (task))
+		return;
+	g_task_return_boolean (task, TRUE);
+}
 
-	/* remove these from the store */
-	for (i = 0; i < ids->len; i++) {
-		tmp = g_ptr_array_index (ids, i);
-		g_debug ("removing %s as %s invalid", tmp, filename);
-		as_store_remove_app_by_id (store, tmp);
+/**
+ * as_store_reload_done_cb:
+ *
+ * Applies the parsed file in the main context, unless the file has been
+ * changed or removed again since the reload was started, or the store has
+ * been destroyed in the meantime.
+ **/
+static void
+as_store_reload_done_cb (GObject *source_object,
+			 GAsyncResult *res,
+			 gpointer user_data)
+{
+	AsStorePrivate *priv;
+	AsStoreReloadHelper *helper;
+	GTask *task = G_TASK (res);
+	_cleanup_error_free_ GError *error = NULL;
+	_cleanup_object_unref_ AsStore *store = NULL;
+
+	/* the task does not keep the store alive */
+	helper = g_task_get_task_data (task);
+	store = g_weak_ref_get (&helper->store);
+	if (store == NULL) {
+		g_debug ("dropping reload of %s for destroyed store",
+			 helper->filename);
+		return;
 	}
 
-	/* the store changed */
-	as_store_perhaps_emit_changed (store, "remove-by-source-file");
+	/* superseded by a newer reload */
+	priv = GET_PRIVATE (store);
+	if (g_hash_table_lookup (priv->reloads, helper->filename) !=
+	    g_task_get_cancellable (task)) {
+		g_debug ("dropping stale reload of %s", helper->filename);
+		return;
+	}
+	g_hash_table_remove (priv->reloads, helper->filename);
+
+	if (!g_task_propagate_boolean (task, &error)) {
+		if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("failed to rescan: %s", error->message);
+		return;
+	}
+	as_store_apply_file (store, helper->filename, helper->store_new);
+}
+
+/**
+ * as_store_reload_cancel:
+ **/
+static void
+as_store_reload_cancel (AsStore *store, const gchar *filename)
+{
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	GCancellable *cancellable;
+
+	cancellable = g_hash_table_lookup (priv->reloads, filename);
+	if (cancellable == NULL)
+		return;
+	g_debug ("cancelling reload of %s", filename);
+	g_cancellable_cancel (cancellable);
+	g_hash_table_remove (priv->reloads, filename);
+}
+
+/**
+ * as_store_reload_file_background:
+ * @store: a #AsStore instance.
+ * @filename: filename
+ *
+ * Parses the file in a worker thread so that the main loop is not blocked,
+ * cancelling any reload of the same file that is still in progress.
+ * Destroying the store cancels the reload.
+ **/
+void
+as_store_reload_file_background (AsStore *store, const gchar *filename)
+{
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	AsStoreReloadHelper *helper;
+	_cleanup_object_unref_ GCancellable *cancellable = NULL;
+	_cleanup_object_unref_ GTask *task = NULL;
+
+	as_store_reload_cancel (store, filename);
+	cancellable = g_cancellable_new ();
+	g_hash_table_insert (priv->reloads,
+			     g_strdup (filename),
+			     g_object_ref (cancellable));
+
+	/* the scratch store is set up here as the settings may change */
+	helper = g_slice_new0 (AsStoreReloadHelper);
+	helper->filename = g_strdup (filename);
+	g_weak_ref_init (&helper->store, store);
+	helper->store_new = as_store_new_scratch (store);
+	task = g_task_new (NULL, cancellable, as_store_reload_done_cb, NULL);
+	g_task_set_task_data (task, helper,
+			      (GDestroyNotify) as_store_reload_helper_free);
+	g_debug ("rescanning %s in a worker thread", filename);
+	g_task_run_in_thread (task, as_store_reload_thread_cb);
 }
 
 /**
@@ -1018,6 +2906,23 @@ as_store_monitor_changed_cb (AsMonitor *monitor,
 {
 	AsStorePrivate *priv = GET_PRIVATE (store);
 
+	/* parse without blocking the main loop */
+	if (priv->watch_flags & AS_STORE_WATCH_FLAG_ADDED &&
+	    priv->watch_flags & AS_STORE_WATCH_FLAG_BACKGROUND) {
+		as_store_reload_file_background (store, filename);
+		return;
+	}
+
+	/* only apply what is different */
+	if (priv->watch_flags & AS_STORE_WATCH_FLAG_ADDED &&
+	    priv->watch_flags & AS_STORE_WATCH_FLAG_INCREMENTAL) {
+		_cleanup_error_free_ GError *error = NULL;
+		g_debug ("rescanning %s incrementally", filename);
+		if (!as_store_reload_file_incremental (store, filename, &error))
+			g_warning ("failed to rescan: %s", error->message);
+		return;
+	}
+
 	/* reload, or emit a signal */
 	if (priv->watch_flags & AS_STORE_WATCH_FLAG_ADDED) {
 		_cleanup_error_free_ GError *error = NULL;
@@ -1043,6 +2948,13 @@ as_store_monitor_added_cb (AsMonitor *monitor,
 {
 	AsStorePrivate *priv = GET_PRIVATE (store);
 
+	/* parse without blocking the main loop */
+	if (priv->watch_flags & AS_STORE_WATCH_FLAG_ADDED &&
+	    priv->watch_flags & AS_STORE_WATCH_FLAG_BACKGROUND) {
+		as_store_reload_file_background (store, filename);
+		return;
+	}
+
 	/* reload, or emit a signal */
 	if (priv->watch_flags & AS_STORE_WATCH_FLAG_ADDED) {
 		_cleanup_error_free_ GError *error = NULL;
@@ -1065,14 +2977,46 @@ as_store_monitor_removed_cb (AsMonitor *monitor,
 			     AsStore *store)
 {
 	AsStorePrivate *priv = GET_PRIVATE (store);
+
+	/* a pending reload would add the components back */
+	as_store_reload_cancel (store, filename);
+
 	/* remove, or emit a signal */
 	if (priv->watch_flags & AS_STORE_WATCH_FLAG_REMOVED) {
+		g_hash_table_remove (priv->content_hashes, filename);
 		as_store_remove_by_source_file (store, filename);
 	} else {
 		as_store_perhaps_emit_changed (store, "file removed");
 	}
 }
 
+/**
+ * as_store_monitor_batch_cb:
+ *
+ * All the files from one burst of changes are handled together so that
+ * ::changed is only emitted once, for instance for a package transaction.
+ */
+static void
+as_store_monitor_batch_cb (AsMonitor *monitor,
+			   gchar **added,
+			   gchar **removed,
+			   gchar **changed,
+			   AsStore *store)
+{
+	guint i;
+	_cleanup_uninhibit_ guint32 *tok = NULL;
+
+	tok = as_store_changed_inhibit (store);
+	for (i = 0; removed[i] != NULL; i++)
+		as_store_monitor_removed_cb (monitor, removed[i], store);
+	for (i = 0; changed[i] != NULL; i++)
+		as_store_monitor_changed_cb (monitor, changed[i], store);
+	for (i = 0; added[i] != NULL; i++)
+		as_store_monitor_added_cb (monitor, added[i], store);
+	as_store_changed_uninhibit (&tok);
+	as_store_perhaps_emit_changed (store, "files changed");
+}
+
 /**
  * as_store_from_file:
  * @store: a #AsStore instance.
@@ -1276,6 +3220,88 @@ as_store_convert_icons (AsStore *store, AsIconKind kind, GError **error)
 	return TRUE;
 }
 
+/**
+ * as_store_to_yaml_file:
+ *
+ * Each application is written as its own document as soon as it has
+ * been emitted, so no tree is built for the output.
+ **/
+static gboolean
+as_store_to_yaml_file (AsStore *store,
+		       GFile *file,
+		       GCancellable *cancellable,
+		       GError **error)
+{
+	AsApp *app;
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	guint i;
+	gchar version[6];
+	_cleanup_error_free_ GError *error_local = NULL;
+	_cleanup_free_ gchar *basename = NULL;
+	_cleanup_object_unref_ GFileOutputStream *file_stream = NULL;
+	_cleanup_object_unref_ GOutputStream *out = NULL;
+	_cleanup_object_unref_ GZlibCompressor *compressor = NULL;
+	_cleanup_yaml_emitter_free_ AsYamlEmitter *emitter = NULL;
+
+	file_stream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE,
+				      cancellable, &error_local);
+	if (file_stream == NULL) {
+		g_set_error (error,
+			     AS_STORE_ERROR,
+			     AS_STORE_ERROR_FAILED,
+			     "Failed to write file: %s",
+			     error_local->message);
+		return FALSE;
+	}
+
+	/* compress as a gzip file if required */
+	basename = g_file_get_basename (file);
+	if (g_strstr_len (basename, -1, ".gz") != NULL) {
+		compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1);
+		out = g_converter_output_stream_new (G_OUTPUT_STREAM (file_stream),
+						     G_CONVERTER (compressor));
+	} else {
+		out = g_object_ref (file_stream);
+	}
+	emitter = as_yaml_emitter_new (out, error);
+	if (emitter == NULL)
+		return FALSE;
+
+	/* header */
+	as_yaml_emitter_document_start (emitter);
+	as_yaml_emitter_key_value (emitter, "File", "DEP-11");
+	g_ascii_formatd (version, sizeof (version), "%.1f", priv->api_version);
+	as_yaml_emitter_key_value (emitter, "Version", version);
+	as_yaml_emitter_key_value (emitter, "Origin", priv->origin);
+	as_yaml_emitter_document_end (emitter);
+
+	/* sort by ID */
+	g_ptr_array_sort (priv->array, as_store_apps_sort_cb);
+
+	/* one document per application */
+	for (i = 0; i < priv->array->len; i++) {
+		app = g_ptr_array_index (priv->array, i);
+		as_app_node_emit_dep11 (app, emitter);
+	}
+	if (!as_yaml_emitter_close (emitter, &error_local)) {
+		g_set_error (error,
+			     AS_STORE_ERROR,
+			     AS_STORE_ERROR_FAILED,
+			     "Failed to write stream: %s",
+			     error_local->message);
+		return FALSE;
+	}
+	if (!g_output_stream_close (out, cancellable, &error_local)) {
+		g_set_error (error,
+			     AS_STORE_ERROR,
+			     AS_STORE_ERROR_FAILED,
+			     "Failed to close stream: %s",
+			     error_local->message);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 /**
  * as_store_to_file:
  * @store: a #AsStore instance.
@@ -1285,6 +3311,8 @@ as_store_convert_icons (AsStore *store, AsIconKind kind, GError **error)
  * @error: A #GError or %NULL
  *
  * Outputs an optionally compressed XML file of all the applications in the store.
+ * If the filename contains ".yml" then a DEP-11 YAML file is written instead,
+ * in which case @flags is ignored.
  *
  * Returns: A #GString
  *
@@ -1304,8 +3332,12 @@ as_store_to_file (AsStore *store,
 	_cleanup_string_free_ GString *xml = NULL;
 	_cleanup_free_ gchar *basename = NULL;
 
-	/* check if compressed */
+	/* DEP-11 */
 	basename = g_file_get_basename (file);
+	if (g_strstr_len (basename, -1, ".yml") != NULL)
+		return as_store_to_yaml_file (store, file, cancellable, error);
+
+	/* check if compressed */
 	if (g_strstr_len (basename, -1, ".gz") == NULL) {
 		xml = as_store_to_xml (store, flags);
 		if (!g_file_replace_contents (file, xml->str, xml->len,
@@ -1574,6 +3606,45 @@ as_store_set_watch_flags (AsStore *store, AsStoreWatchFlags watch_flags)
 	priv->watch_flags = watch_flags;
 }
 
+/**
+ * as_store_get_max_threads:
+ * @store: a #AsStore instance.
+ *
+ * Gets the maximum number of threads used when loading files.
+ *
+ * Returns: the number of threads, where 0 is one per processor
+ *
+ * Since: 0.5.0
+ **/
+guint
+as_store_get_max_threads (AsStore *store)
+{
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	return priv->max_threads;
+}
+
+/**
+ * as_store_set_max_threads:
+ * @store: a #AsStore instance.
+ * @max_threads: the number of threads, or 0 for one per processor
+ *
+ * Sets the maximum number of threads used when loading files.
+ * DEP-11 files consist of many independent documents, and directories
+ * of installed desktop and AppData files consist of many small files,
+ * and both can be parsed in parallel, although the applications are
+ * always added to the store in the order they were found.
+ *
+ * The default is 1, which parses each document or file in turn.
+ *
+ * Since: 0.5.0
+ **/
+void
+as_store_set_max_threads (AsStore *store, guint max_threads)
+{
+	AsStorePrivate *priv = GET_PRIVATE (store);
+	priv->max_threads = max_threads;
+}
+
 /**
  * as_store_guess_origin_fallback:
  */
@@ -1824,8 +3895,128 @@ as_store_load_app_install (AsStore *store,
 	return TRUE;
 }
 
+typedef struct {
+	gchar		*filename;
+	AsAppParseFlags	 parse_flags;
+	AsApp		*app;
+	GError		*error;
+} AsStoreInstalledFile;
+
+/**
+ * as_store_installed_file_free:
+ **/
+static void
+as_store_installed_file_free (AsStoreInstalledFile *file)
+{
+	g_free (file->filename);
+	if (file->app != NULL)
+		g_object_unref (file->app);
+	if (file->error != NULL)
+		g_error_free (file->error);
+	g_slice_free (AsStoreInstalledFile, file);
+}
+
+/**
+ * as_store_read_file:
+ *
+ * Reads the whole file into @buf with one read of the size reported by
+ * fstat(), reusing the existing allocation of @buf where possible.
+ **/
+static gboolean
+as_store_read_file (const gchar *filename, GString *buf, GError **error)
+{
+	gint errsv;
+	gint fd;
+	gsize offset = 0;
+	gssize len;
+	struct stat st;
+
+	fd = g_open (filename, O_RDONLY, 0);
+	if (fd < 0)
+		goto out;
+	if (fstat (fd, &st) < 0)
+		goto out;
+	g_string_set_size (buf, (gsize) st.st_size);
+	while (offset < buf->len) {
+		len = read (fd, buf->str + offset, buf->len - offset);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len < 0)
+			goto out;
+		if (len == 0)
+			break;
+		offset += (gsize) len;
+	}
+
+	/* the file may have been truncated since the fstat() */
+	g_string_truncate (buf, offset);
+	close (fd);
+	return TRUE;
+out:
+	errsv = errno;
+	if (fd >= 0)
+		close (fd);
+	g_set_error (error,
+		     G_FILE_ERROR,
+		     g_file_error_from_errno (errsv),
+		     "Failed to read %s: %s",
+		     filename, g_strerror (errsv));
+	return FALSE;
+}
+
+/**
+ * as_store_load_installed_file:
+ **/
+static void
+as_store_load_installed_file (AsStoreInstalledFile *file, GString *buf)
+{
+	_cleanup_object_unref_ AsApp *app = NULL;
+
+	if (!as_store_read_file (file->filename, buf, &file->error))
+		return;
+	app = as_app_new ();
+	if (!as_app_parse_data (app, file->filename, buf->str, buf->len,
+				file->parse_flags, &file->error))
+		return;
+	file->app = g_object_ref (app);
+}
+
+/**
+ * as_store_read_buffer_free:
+ **/
+static void
+as_store_read_buffer_free (GString *buf)
+{
+	g_string_free (buf, TRUE);
+}
+
+/* each worker thread keeps one read buffer for all the files it parses */
+static GPrivate as_store_read_buffer =
+	G_PRIVATE_INIT ((GDestroyNotify) as_store_read_buffer_free);
+
+/**
+ * as_store_load_installed_thread_cb:
+ **/
+static void
+as_store_load_installed_thread_cb (gpointer data, gpointer user_data)
+{
+	AsStoreInstalledFile *file = (AsStoreInstalledFile *) data;
+	GString *buf;
+
+	buf = g_private_get (&as_store_read_buffer);
+	if (buf == NULL) {
+		buf = g_string_sized_new (4096);
+		g_private_set (&as_store_read_buffer, buf);
+	}
+	as_store_load_installed_file (file, buf);
+}
+
 /**
  * as_store_load_installed:
+ *
+ * All the files in @path are read into a reused buffer and parsed, in
+ * a thread pool if allowed, and the applications are then added to the
+ * store in directory order.
  **/
 static gboolean
 as_store_load_installed (AsStore *store,
@@ -1835,10 +4026,13 @@ as_store_load_installed (AsStore *store,
 			 GError **error)
 {
 	AsAppParseFlags parse_flags = AS_APP_PARSE_FLAG_USE_HEURISTICS;
+	AsStoreInstalledFile *file;
 	AsStorePrivate *priv = GET_PRIVATE (store);
-	GError *error_local = NULL;
 	const gchar *tmp;
+	guint i;
+	guint max_threads;
 	_cleanup_dir_close_ GDir *dir = NULL;
+	_cleanup_ptrarray_unref_ GPtrArray *files = NULL;
 	_cleanup_uninhibit_ guint32 *tok = NULL;
 
 	dir = g_dir_open (path, 0, error);
@@ -1852,10 +4046,11 @@ as_store_load_installed (AsStore *store,
 	if (flags & AS_STORE_LOAD_FLAG_ALLOW_VETO)
 		parse_flags |= AS_APP_PARSE_FLAG_ALLOW_VETO;
 
+	/* find the files that need parsing */
+	files = g_ptr_array_new_with_free_func ((GDestroyNotify) as_store_installed_file_free);
 	while ((tmp = g_dir_read_name (dir)) != NULL) {
 		AsApp *app_tmp;
 		_cleanup_free_ gchar *filename = NULL;
-		_cleanup_object_unref_ AsApp *app = NULL;
 		filename = g_build_filename (path, tmp, NULL);
 		if (!g_file_test (filename, G_FILE_TEST_IS_REGULAR))
 			continue;
@@ -1869,29 +4064,67 @@ as_store_load_installed (AsStore *store,
 				continue;
 			}
 		}
-		app = as_app_new ();
-		if (!as_app_parse_file (app, filename, parse_flags, &error_local)) {
-			if (g_error_matches (error_local,
+		file = g_slice_new0 (AsStoreInstalledFile);
+		file->filename = g_strdup (filename);
+		file->parse_flags = parse_flags;
+		g_ptr_array_add (files, file);
+	}
+
+	/* parse the files, in parallel if allowed */
+	max_threads = priv->max_threads;
+	if (max_threads == 0)
+		max_threads = g_get_num_processors ();
+	if (max_threads > files->len)
+		max_threads = files->len;
+	if (max_threads > 1) {
+		GThreadPool *pool;
+		pool = g_thread_pool_new (as_store_load_installed_thread_cb,
+					  NULL,
+					  max_threads,
+					  TRUE,
+					  error);
+		if (pool == NULL)
+			return FALSE;
+		for (i = 0; i < files->len; i++) {
+			if (!g_thread_pool_push (pool, g_ptr_array_index (files, i), error)) {
+				g_thread_pool_free (pool, TRUE, TRUE);
+				return FALSE;
+			}
+		}
+		g_thread_pool_free (pool, FALSE, TRUE);
+	} else {
+		_cleanup_string_free_ GString *buf = NULL;
+		buf = g_string_sized_new (4096);
+		for (i = 0; i < files->len; i++)
+			as_store_load_installed_file (g_ptr_array_index (files, i), buf);
+	}
+
+	/* add in order */
+	for (i = 0; i < files->len; i++) {
+		file = g_ptr_array_index (files, i);
+		if (file->error != NULL) {
+			if (g_error_matches (file->error,
 					     AS_APP_ERROR,
-					     AS_APP_ERROR_INVALID_TYPE)) {
-				g_debug ("Ignoring %s: %s", filename,
-					 error_local->message);
-				g_clear_error (&error_local);
+					     AS_APP_ERROR_INVALID_TYPE) ||
+			    file->error->domain == G_FILE_ERROR) {
+				g_debug ("Ignoring %s: %s", file->filename,
+					 file->error->message);
 				continue;
 			}
-			g_propagate_error (error, error_local);
+			g_propagate_error (error, file->error);
+			file->error = NULL;
 			return FALSE;
 		}
 
 		/* do not load applications with vetos */
 		if ((flags & AS_STORE_LOAD_FLAG_ALLOW_VETO) == 0 &&
-		    as_app_get_vetos(app)->len > 0)
+		    as_app_get_vetos(file->app)->len > 0)
 			continue;
 
 		/* set lower priority than AppStream entries */
-		as_app_set_priority (app, -1);
-		as_app_set_state (app, AS_APP_STATE_INSTALLED);
-		as_store_add_app (store, app);
+		as_app_set_priority (file->app, -1);
+		as_app_set_state (file->app, AS_APP_STATE_INSTALLED);
+		as_store_add_app (store, file->app);
 	}
 
 	/* emit changed */
@@ -2290,6 +4523,7 @@ as_store_init (AsStore *store)
 	priv->api_version = AS_API_VERSION_NEWEST;
 	priv->array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	priv->watch_flags = AS_STORE_WATCH_FLAG_NONE;
+	priv->max_threads = 1;
 	priv->hash_id = g_hash_table_new_full (g_str_hash,
 					       g_str_equal,
 					       NULL,
@@ -2298,20 +4532,37 @@ as_store_init (AsStore *store)
 						    g_str_equal,
 						    g_free,
 						    (GDestroyNotify) g_object_unref);
+	priv->id_renames = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  g_free, g_free);
 	priv->monitor = as_monitor_new ();
-	g_signal_connect (priv->monitor, "changed",
-			  G_CALLBACK (as_store_monitor_changed_cb),
-			  store);
-	g_signal_connect (priv->monitor, "added",
-			  G_CALLBACK (as_store_monitor_added_cb),
-			  store);
-	g_signal_connect (priv->monitor, "removed",
-			  G_CALLBACK (as_store_monitor_removed_cb),
+	g_signal_connect (priv->monitor, "batch",
+			  G_CALLBACK (as_store_monitor_batch_cb),
 			  store);
 	priv->metadata_indexes = g_hash_table_new_full (g_str_hash,
 							  g_str_equal,
 							  g_free,
 							  (GDestroyNotify) g_hash_table_unref);
+	priv->content_hashes = g_hash_table_new_full (g_str_hash,
+						      g_str_equal,
+						      g_free,
+						      (GDestroyNotify) g_hash_table_unref);
+	g_mutex_init (&priv->fuzzy_mutex);
+	priv->reloads = g_hash_table_new_full (g_str_hash,
+					       g_str_equal,
+					       g_free,
+					       (GDestroyNotify) g_object_unref);
+	priv->changes_added = g_hash_table_new_full (g_direct_hash,
+						     g_direct_equal,
+						     (GDestroyNotify) g_object_unref,
+						     NULL);
+	priv->changes_removed = g_hash_table_new_full (g_direct_hash,
+						       g_direct_equal,
+						       (GDestroyNotify) g_object_unref,
+						       NULL);
+	priv->changes_updated = g_hash_table_new_full (g_direct_hash,
+						       g_direct_equal,
+						       (GDestroyNotify) g_object_unref,
+						       NULL);
 }
 
 /**
@@ -31,6 +31,7 @@
 
 #include "as-app.h"
 #include "as-node.h"
+#include "as-utils.h"
 
 #define AS_TYPE_STORE		(as_store_get_type())
 #define AS_STORE(obj)		(G_TYPE_CHECK_INSTANCE_CAST((obj), AS_TYPE_STORE, AsStore))
@@ -53,8 +54,11 @@ struct _AsStoreClass
 {
 	GObjectClass		parent_class;
 	void			(*changed)	(AsStore	*store);
+	void			(*apps_changed)	(AsStore	*store,
+						 GPtrArray	*added,
+						 GPtrArray	*removed,
+						 GPtrArray	*updated);
 	/*< private >*/
-	void (*_as_reserved1)	(void);
 	void (*_as_reserved2)	(void);
 	void (*_as_reserved3)	(void);
 	void (*_as_reserved4)	(void);
@@ -106,6 +110,8 @@ typedef enum {
  * @AS_STORE_WATCH_FLAG_NONE:			No extra flags to use
  * @AS_STORE_WATCH_FLAG_ADDED:			Add applications if files change or are added
  * @AS_STORE_WATCH_FLAG_REMOVED:		Remove applications if files are changed or deleted
+ * @AS_STORE_WATCH_FLAG_INCREMENTAL:		Only apply the components that differ when files change
+ * @AS_STORE_WATCH_FLAG_BACKGROUND:		Parse changed files in a worker thread
  *
  * The flags to use when local files are added or removed from the store.
  **/
@@ -113,6 +119,8 @@ typedef enum {
 	AS_STORE_WATCH_FLAG_NONE			= 0,	/* Since: 0.4.2 */
 	AS_STORE_WATCH_FLAG_ADDED			= 1,	/* Since: 0.4.2 */
 	AS_STORE_WATCH_FLAG_REMOVED			= 2,	/* Since: 0.4.2 */
+	AS_STORE_WATCH_FLAG_INCREMENTAL			= 4,	/* Since: 0.5.0 */
+	AS_STORE_WATCH_FLAG_BACKGROUND			= 8,	/* Since: 0.5.0 */
 	/*< private >*/
 	AS_STORE_WATCH_FLAG_LAST
 } AsStoreWatchFlags;
@@ -169,6 +177,21 @@ AsApp		*as_store_get_app_by_pkgname	(AsStore	*store,
 						 const gchar	*pkgname);
 AsApp		*as_store_get_app_by_pkgnames	(AsStore	*store,
 						 gchar		**pkgnames);
+GPtrArray	*as_store_search		(AsStore	*store,
+						 gchar		**search,
+						 guint		 max_results);
+GPtrArray	*as_store_search_parallel	(AsStore	*store,
+						 gchar		**search,
+						 guint		 max_results,
+						 guint		 max_threads);
+GPtrArray	*as_store_convert_descriptions	(AsStore	*store,
+						 const gchar	*locale,
+						 AsMarkupConvertFormat format,
+						 guint		 max_threads);
+GPtrArray	*as_store_search_fuzzy		(AsStore	*store,
+						 gchar		**search,
+						 guint		 max_distance,
+						 guint		 max_results);
 void		 as_store_add_app		(AsStore	*store,
 						 AsApp		*app);
 void		 as_store_remove_app		(AsStore	*store,
@@ -203,6 +226,9 @@ void		 as_store_set_add_flags		(AsStore	*store,
 AsStoreWatchFlags as_store_get_watch_flags	(AsStore	*store);
 void		 as_store_set_watch_flags	(AsStore	*store,
 						 AsStoreWatchFlags watch_flags);
+guint		 as_store_get_max_threads	(AsStore	*store);
+void		 as_store_set_max_threads	(AsStore	*store,
+						 guint		 max_threads);
 GPtrArray	*as_store_validate		(AsStore	*store,
 						 AsAppValidateFlags flags,
 						 GError		**error);
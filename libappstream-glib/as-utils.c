@@ -42,12 +42,26 @@
 #include "as-app.h"
 #include "as-cleanup.h"
 #include "as-enums.h"
-#include "as-node.h"
+#include "as-node-private.h"
 #include "as-resources.h"
 #include "as-store.h"
 #include "as-utils.h"
 #include "as-utils-private.h"
 
+#ifdef HAVE_GPERF
+  /* we need to define these now as gperf just writes big header files */
+  const char *as_blacklist_id_from_gperf (const char *str, guint len);
+  const char *as_category_id_from_gperf (const char *str, guint len);
+  const char *as_environment_id_from_gperf (const char *str, guint len);
+  const char *as_license_id_from_gperf (const char *str, guint len);
+  const char *as_stock_icon_from_gperf (const char *str, guint len);
+  #include "as-blacklist-ids-private.h"
+  #include "as-category-ids-private.h"
+  #include "as-environment-ids-private.h"
+  #include "as-license-ids-private.h"
+  #include "as-stock-icons-private.h"
+#endif
+
 /**
  * as_utils_error_quark:
  *
@@ -124,26 +138,85 @@ as_markup_strsplit_words (const gchar *text, guint line_len)
 	return (gchar **) g_ptr_array_free (lines, FALSE);
 }
 
+/**
+ * as_markup_render_words:
+ *
+ * Appends @text broken into lines no longer than @line_len, in the same
+ * way as as_markup_strsplit_words(), but without building any arrays.
+ **/
+static void
+as_markup_render_words (GString *str,
+			const gchar *text,
+			guint line_len,
+			const gchar *prefix_first,
+			const gchar *prefix_rest)
+{
+	const gchar *end;
+	gsize curlen = 0;
+	gsize toklen;
+
+	g_string_append (str, prefix_first);
+	for (;;) {
+		end = strchr (text, ' ');
+		toklen = end != NULL ? (gsize) (end - text) : strlen (text);
+
+		/* too long, so remove space and start a new line */
+		if (curlen + toklen >= line_len) {
+			if (curlen > 0)
+				g_string_truncate (str, str->len - 1);
+			g_string_append_c (str, '\n');
+			g_string_append (str, prefix_rest);
+			curlen = 0;
+		}
+		g_string_append_len (str, text, toklen);
+		g_string_append_c (str, ' ');
+		curlen += toklen + 1;
+		if (end == NULL)
+			break;
+		text = end + 1;
+	}
+
+	/* finish the incomplete line */
+	g_string_truncate (str, str->len - 1);
+	g_string_append_c (str, '\n');
+}
+
+typedef enum {
+	AS_MARKUP_STATE_NONE,
+	AS_MARKUP_STATE_PARA,
+	AS_MARKUP_STATE_LIST,
+	AS_MARKUP_STATE_ITEM
+} AsMarkupState;
+
+typedef struct {
+	AsMarkupConvertFormat	 format;
+	AsMarkupState		 state;
+	GString			*str;
+	gsize			 str_start;
+	GString			*text;		/* of the current <p> or <li> */
+	gboolean		 got_text;
+	guint			 depth;
+	gchar			*list_tag;
+} AsMarkupHelper;
+
 /**
  * as_markup_render_para:
  **/
 static void
-as_markup_render_para (GString *str, AsMarkupConvertFormat format, const gchar *data)
+as_markup_render_para (AsMarkupHelper *helper)
 {
-	guint i;
-	_cleanup_strv_free_ gchar **spl = NULL;
+	GString *str = helper->str;
 
-	if (str->len > 0)
+	if (str->len > helper->str_start)
 		g_string_append (str, "\n");
-	switch (format) {
+	switch (helper->format) {
 	case AS_MARKUP_CONVERT_FORMAT_SIMPLE:
-		g_string_append_printf (str, "%s\n", data);
+		g_string_append_len (str, helper->text->str, helper->text->len);
+		g_string_append_c (str, '\n');
 		break;
 	case AS_MARKUP_CONVERT_FORMAT_MARKDOWN:
 		/* break to 80 chars */
-		spl = as_markup_strsplit_words (data, 80);
-		for (i = 0; spl[i] != NULL; i++)
-			g_string_append (str, spl[i]);
+		as_markup_render_words (str, helper->text->str, 80, "", "");
 		break;
 	default:
 		break;
@@ -154,21 +227,19 @@ as_markup_render_para (GString *str, AsMarkupConvertFormat format, const gchar *
  * as_markup_render_li:
  **/
 static void
-as_markup_render_li (GString *str, AsMarkupConvertFormat format, const gchar *data)
+as_markup_render_li (AsMarkupHelper *helper)
 {
-	guint i;
-	_cleanup_strv_free_ gchar **spl = NULL;
+	GString *str = helper->str;
 
-	switch (format) {
+	switch (helper->format) {
 	case AS_MARKUP_CONVERT_FORMAT_SIMPLE:
-		g_string_append_printf (str, " • %s\n", data);
+		g_string_append (str, " • ");
+		g_string_append_len (str, helper->text->str, helper->text->len);
+		g_string_append_c (str, '\n');
 		break;
 	case AS_MARKUP_CONVERT_FORMAT_MARKDOWN:
 		/* break to 80 chars, leaving room for the dot/indent */
-		spl = as_markup_strsplit_words (data, 80 - 3);
-		g_string_append_printf (str, " * %s", spl[0]);
-		for (i = 1; spl[i] != NULL; i++)
-			g_string_append_printf (str, "   %s", spl[i]);
+		as_markup_render_words (str, helper->text->str, 80 - 3, " * ", "   ");
 		break;
 	default:
 		break;
@@ -176,77 +247,248 @@ as_markup_render_li (GString *str, AsMarkupConvertFormat format, const gchar *da
 }
 
 /**
- * as_markup_convert:
+ * as_markup_start_element_cb:
+ **/
+static void
+as_markup_start_element_cb (GMarkupParseContext *context,
+			    const gchar *element_name,
+			    const gchar **attribute_names,
+			    const gchar **attribute_values,
+			    gpointer user_data,
+			    GError **error)
+{
+	AsMarkupHelper *helper = (AsMarkupHelper *) user_data;
+
+	switch (helper->state) {
+	case AS_MARKUP_STATE_NONE:
+		if (g_strcmp0 (element_name, "p") == 0) {
+			helper->state = AS_MARKUP_STATE_PARA;
+			g_string_truncate (helper->text, 0);
+			helper->got_text = FALSE;
+		} else if (g_strcmp0 (element_name, "ul") == 0 ||
+			   g_strcmp0 (element_name, "ol") == 0) {
+			helper->state = AS_MARKUP_STATE_LIST;
+			g_free (helper->list_tag);
+			helper->list_tag = g_strdup (element_name);
+		} else {
+			/* only <p>, <ul> and <ol> is valid here */
+			g_set_error (error,
+				     AS_NODE_ERROR,
+				     AS_NODE_ERROR_FAILED,
+				     "Unknown tag '%s'", element_name);
+			return;
+		}
+		break;
+	case AS_MARKUP_STATE_LIST:
+		if (g_strcmp0 (element_name, "li") != 0) {
+			/* only <li> is valid in lists */
+			g_set_error (error,
+				     AS_NODE_ERROR,
+				     AS_NODE_ERROR_FAILED,
+				     "Tag %s in %s invalid",
+				     element_name, helper->list_tag);
+			return;
+		}
+		helper->state = AS_MARKUP_STATE_ITEM;
+		g_string_truncate (helper->text, 0);
+		helper->got_text = FALSE;
+		break;
+	default:
+		/* any markup inside <p> and <li> is ignored */
+		break;
+	}
+	helper->depth++;
+}
+
+/**
+ * as_markup_end_element_cb:
+ **/
+static void
+as_markup_end_element_cb (GMarkupParseContext *context,
+			  const gchar *element_name,
+			  gpointer user_data,
+			  GError **error)
+{
+	AsMarkupHelper *helper = (AsMarkupHelper *) user_data;
+
+	helper->depth--;
+	switch (helper->state) {
+	case AS_MARKUP_STATE_PARA:
+		if (helper->depth > 0)
+			break;
+		as_markup_render_para (helper);
+		helper->state = AS_MARKUP_STATE_NONE;
+		break;
+	case AS_MARKUP_STATE_ITEM:
+		if (helper->depth > 1)
+			break;
+		as_markup_render_li (helper);
+		helper->state = AS_MARKUP_STATE_LIST;
+		break;
+	case AS_MARKUP_STATE_LIST:
+		if (helper->depth == 0)
+			helper->state = AS_MARKUP_STATE_NONE;
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * as_markup_text_cb:
+ **/
+static void
+as_markup_text_cb (GMarkupParseContext *context,
+		   const gchar *text,
+		   gsize text_len,
+		   gpointer user_data,
+		   GError **error)
+{
+	AsMarkupHelper *helper = (AsMarkupHelper *) user_data;
+	gsize i;
+
+	/* only the direct contents of <p> and <li> are shown */
+	if (helper->state == AS_MARKUP_STATE_PARA && helper->depth != 1)
+		return;
+	if (helper->state == AS_MARKUP_STATE_ITEM && helper->depth != 2)
+		return;
+	if (helper->state != AS_MARKUP_STATE_PARA &&
+	    helper->state != AS_MARKUP_STATE_ITEM)
+		return;
+
+	/* all whitespace? */
+	for (i = 0; i < text_len; i++) {
+		if (!g_ascii_isspace (text[i]))
+			break;
+	}
+	if (i >= text_len)
+		return;
+
+	/* the text has been split by other markup */
+	if (helper->got_text) {
+		g_set_error (error,
+			     AS_NODE_ERROR,
+			     AS_NODE_ERROR_INVALID_MARKUP,
+			     "<%s> already set '%s' and tried to replace with '%s'",
+			     helper->state == AS_MARKUP_STATE_PARA ? "p" : "li",
+			     helper->text->str, text);
+		return;
+	}
+	as_node_reflow_text_append (helper->text, text, text_len);
+	helper->got_text = TRUE;
+}
+
+/**
+ * as_markup_convert_to_string:
  * @markup: the text to copy.
+ * @markup_len: the length of @markup, or -1 if NUL terminated
  * @format: the #AsMarkupConvertFormat, e.g. %AS_MARKUP_CONVERT_FORMAT_MARKDOWN
+ * @str: a #GString to append to
  * @error: A #GError or %NULL
  *
- * Converts an XML description into a printable form.
+ * Converts an XML description into a printable form, appending it to
+ * @str. The markup is rendered as it is parsed without building a node
+ * tree, and the same buffer can be reused for many descriptions.
  *
- * Returns: (transfer full): a newly allocated %NULL terminated string
+ * If an error is returned then @str may contain partial output.
  *
- * Since: 0.3.5
+ * Returns: %TRUE for success
+ *
+ * Since: 0.5.0
  **/
-gchar *
-as_markup_convert (const gchar *markup,
-		   AsMarkupConvertFormat format, GError **error)
+gboolean
+as_markup_convert_to_string (const gchar *markup,
+			     gssize markup_len,
+			     AsMarkupConvertFormat format,
+			     GString *str,
+			     GError **error)
 {
-	GNode *tmp;
-	GNode *tmp_c;
-	const gchar *tag;
-	const gchar *tag_c;
-	_cleanup_node_unref_ GNode *root = NULL;
-	_cleanup_string_free_ GString *str = NULL;
+	AsMarkupHelper helper;
+	gboolean ret;
+	_cleanup_error_free_ GError *error_local = NULL;
+	_cleanup_markup_parse_context_unref_ GMarkupParseContext *ctx = NULL;
+	_cleanup_string_free_ GString *text = NULL;
+	const GMarkupParser parser = {
+		as_markup_start_element_cb,
+		as_markup_end_element_cb,
+		as_markup_text_cb,
+		NULL,
+		NULL };
+
+	g_return_val_if_fail (markup != NULL, FALSE);
+	g_return_val_if_fail (str != NULL, FALSE);
 
 	/* is this actually markup */
-	if (g_strstr_len (markup, -1, "<") == NULL)
-		return g_strdup (markup);
+	if (markup_len < 0)
+		markup_len = strlen (markup);
+	if (memchr (markup, '<', markup_len) == NULL) {
+		g_string_append_len (str, markup, markup_len);
+		return TRUE;
+	}
 
-	/* load */
-	root = as_node_from_xml (markup, AS_NODE_FROM_XML_FLAG_NONE, error);
-	if (root == NULL)
-		return NULL;
+	/* render as the markup is parsed */
+	text = g_string_new ("");
+	helper.format = format;
+	helper.state = AS_MARKUP_STATE_NONE;
+	helper.str = str;
+	helper.str_start = str->len;
+	helper.text = text;
+	helper.got_text = FALSE;
+	helper.depth = 0;
+	helper.list_tag = NULL;
+	ctx = g_markup_parse_context_new (&parser,
+					  G_MARKUP_PREFIX_ERROR_POSITION,
+					  &helper,
+					  NULL);
+	ret = g_markup_parse_context_parse (ctx, markup, markup_len, &error_local);
+	g_free (helper.list_tag);
+	if (!ret) {
+		g_set_error_literal (error,
+				     AS_NODE_ERROR,
+				     AS_NODE_ERROR_FAILED,
+				     error_local->message);
+		return FALSE;
+	}
 
-	/* format */
-	str = g_string_new ("");
-	for (tmp = root->children; tmp != NULL; tmp = tmp->next) {
-
-		tag = as_node_get_name (tmp);
-		if (g_strcmp0 (tag, "p") == 0) {
-			as_markup_render_para (str, format, as_node_get_data (tmp));
-
-		/* loop on the children */
-		} else if (g_strcmp0 (tag, "ul") == 0 ||
-			   g_strcmp0 (tag, "ol") == 0) {
-			for (tmp_c = tmp->children; tmp_c != NULL; tmp_c = tmp_c->next) {
-				tag_c = as_node_get_name (tmp_c);
-				if (g_strcmp0 (tag_c, "li") == 0) {
-					as_markup_render_li (str, format,
-							     as_node_get_data (tmp_c));
-				} else {
-					/* only <li> is valid in lists */
-					g_set_error (error,
-						     AS_NODE_ERROR,
-						     AS_NODE_ERROR_FAILED,
-						     "Tag %s in %s invalid",
-						     tag_c, tag);
-					return FALSE;
-				}
-			}
-		} else {
-			/* only <p>, <ul> and <ol> is valid here */
-			g_set_error (error,
+	/* more opening than closing */
+	if (helper.depth != 0) {
+		g_set_error_literal (error,
 				     AS_NODE_ERROR,
 				     AS_NODE_ERROR_FAILED,
-				     "Unknown tag '%s'", tag);
-			return NULL;
-		}
+				     "Mismatched XML");
+		return FALSE;
 	}
 
 	/* success */
-	if (str->len > 0)
+	if (str->len > helper.str_start)
 		g_string_truncate (str, str->len - 1);
-	return g_strdup (str->str);
+	return TRUE;
+}
+
+/**
+ * as_markup_convert:
+ * @markup: the text to copy.
+ * @format: the #AsMarkupConvertFormat, e.g. %AS_MARKUP_CONVERT_FORMAT_MARKDOWN
+ * @error: A #GError or %NULL
+ *
+ * Converts an XML description into a printable form.
+ *
+ * Returns: (transfer full): a newly allocated %NULL terminated string
+ *
+ * Since: 0.3.5
+ **/
+gchar *
+as_markup_convert (const gchar *markup,
+		   AsMarkupConvertFormat format, GError **error)
+{
+	GString *str;
+
+	str = g_string_new ("");
+	if (!as_markup_convert_to_string (markup, -1, format, str, error)) {
+		g_string_free (str, TRUE);
+		return NULL;
+	}
+	return g_string_free (str, FALSE);
 }
 
 /**
@@ -320,6 +562,12 @@ as_hash_lookup_by_locale (GHashTable *hash, const gchar *locale)
 gboolean
 as_utils_is_stock_icon_name (const gchar *name)
 {
+#ifdef HAVE_GPERF
+	/* use a perfect hash generated at build time */
+	if (name == NULL)
+		return FALSE;
+	return as_stock_icon_from_gperf (name, strlen (name)) != NULL;
+#else
 	_cleanup_bytes_unref_ GBytes *data = NULL;
 	_cleanup_free_ gchar *key = NULL;
 
@@ -332,6 +580,7 @@ as_utils_is_stock_icon_name (const gchar *name)
 		return FALSE;
 	key = g_strdup_printf ("\n%s\n", name);
 	return g_strstr_len (g_bytes_get_data (data, NULL), -1, key) != NULL;
+#endif
 }
 
 /**
@@ -347,6 +596,12 @@ as_utils_is_stock_icon_name (const gchar *name)
 gboolean
 as_utils_is_spdx_license_id (const gchar *license_id)
 {
+#ifdef HAVE_GPERF
+	/* use a perfect hash generated from as-license-ids.txt */
+	if (license_id == NULL)
+		return FALSE;
+	return as_license_id_from_gperf (license_id, strlen (license_id)) != NULL;
+#else
 	_cleanup_bytes_unref_ GBytes *data = NULL;
 	_cleanup_free_ gchar *key = NULL;
 
@@ -359,13 +614,179 @@ as_utils_is_spdx_license_id (const gchar *license_id)
 		return FALSE;
 	key = g_strdup_printf ("\n%s\n", license_id);
 	return g_strstr_len (g_bytes_get_data (data, NULL), -1, key) != NULL;
+#endif
+}
+
+typedef struct {
+	gchar		*glob;
+	GPatternSpec	*spec;		/* NULL if fnmatch() is needed */
+	gboolean	 extra;		/* added by as_utils_add_blacklisted_id() */
+} AsUtilsBlacklistGlob;
+
+typedef struct {
+	GHashTable	*ids;		/* exact IDs */
+	GHashTable	*ids_extra;	/* exact IDs added at runtime */
+	GPtrArray	*globs_any;	/* globs starting with a wildcard */
+	GPtrArray	*globs[256];	/* globs indexed by the first char */
+} AsUtilsBlacklist;
+
+static GRWLock as_utils_blacklist_lock;
+
+static void
+as_utils_blacklist_glob_free (gpointer data)
+{
+	AsUtilsBlacklistGlob *item = (AsUtilsBlacklistGlob *) data;
+	if (item->spec != NULL)
+		g_pattern_spec_free (item->spec);
+	g_free (item->glob);
+	g_slice_free (AsUtilsBlacklistGlob, item);
+}
+
+/**
+ * as_utils_blacklist_add:
+ *
+ * Adds an exact ID or a glob to the matcher, which must be locked for
+ * writing if it has already been returned by as_utils_blacklist_get().
+ **/
+static void
+as_utils_blacklist_add (AsUtilsBlacklist *blacklist,
+			const gchar *glob,
+			gboolean extra)
+{
+	AsUtilsBlacklistGlob *item;
+	guchar first = (guchar) glob[0];
+
+	/* exact ID */
+	if (strpbrk (glob, "*?[\\") == NULL) {
+		g_hash_table_add (extra ? blacklist->ids_extra : blacklist->ids,
+				  g_strdup (glob));
+		return;
+	}
+
+	/* GPatternSpec is faster, but only understands '*' and '?' */
+	item = g_slice_new0 (AsUtilsBlacklistGlob);
+	item->glob = g_strdup (glob);
+	item->extra = extra;
+	if (strpbrk (glob, "[\\") == NULL)
+		item->spec = g_pattern_spec_new (glob);
+
+	/* a glob starting with a literal char can only match IDs that
+	 * start with the same char, so only those need to try it */
+	if (strchr ("*?[\\", first) != NULL) {
+		g_ptr_array_add (blacklist->globs_any, item);
+		return;
+	}
+	if (blacklist->globs[first] == NULL)
+		blacklist->globs[first] = g_ptr_array_new_with_free_func (as_utils_blacklist_glob_free);
+	g_ptr_array_add (blacklist->globs[first], item);
+}
+
+/**
+ * as_utils_blacklist_remove:
+ *
+ * Removes an entry added at runtime, which must be locked for writing.
+ **/
+static gboolean
+as_utils_blacklist_remove (AsUtilsBlacklist *blacklist, const gchar *glob)
+{
+	AsUtilsBlacklistGlob *item;
+	GPtrArray *globs;
+	guchar first = (guchar) glob[0];
+	guint i;
+
+	/* exact ID */
+	if (strpbrk (glob, "*?[\\") == NULL)
+		return g_hash_table_remove (blacklist->ids_extra, glob);
+
+	/* glob */
+	if (strchr ("*?[\\", first) != NULL)
+		globs = blacklist->globs_any;
+	else
+		globs = blacklist->globs[first];
+	if (globs == NULL)
+		return FALSE;
+	for (i = 0; i < globs->len; i++) {
+		item = g_ptr_array_index (globs, i);
+		if (item->extra && g_strcmp0 (item->glob, glob) == 0) {
+			g_ptr_array_remove_index (globs, i);
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/**
+ * as_utils_blacklist_get:
+ *
+ * Returns the matcher, compiling the built-in list the first time.
+ **/
+static AsUtilsBlacklist *
+as_utils_blacklist_get (void)
+{
+	static gsize blacklist_once = 0;
+
+	if (g_once_init_enter (&blacklist_once)) {
+		AsUtilsBlacklist *blacklist;
+		guint i;
+		_cleanup_bytes_unref_ GBytes *data = NULL;
+		_cleanup_strv_free_ gchar **split = NULL;
+
+		blacklist = g_new0 (AsUtilsBlacklist, 1);
+		blacklist->ids = g_hash_table_new_full (g_str_hash, g_str_equal,
+							g_free, NULL);
+		blacklist->ids_extra = g_hash_table_new_full (g_str_hash, g_str_equal,
+							      g_free, NULL);
+		blacklist->globs_any = g_ptr_array_new_with_free_func (as_utils_blacklist_glob_free);
+
+		/* load the readonly data section and compile each entry */
+		data = g_resource_lookup_data (as_get_resource (),
+					       "/org/freedesktop/appstream-glib/as-blacklist-ids.txt",
+					       G_RESOURCE_LOOKUP_FLAGS_NONE,
+					       NULL);
+		if (data != NULL)
+			split = g_strsplit (g_bytes_get_data (data, NULL), "\n", -1);
+		for (i = 0; split != NULL && split[i] != NULL; i++) {
+			if (split[i][0] == '\0' || split[i][0] == '#')
+				continue;
+#ifdef HAVE_GPERF
+			/* exact IDs are already in the perfect hash */
+			if (strpbrk (split[i], "*?[\\") == NULL)
+				continue;
+#endif
+			as_utils_blacklist_add (blacklist, split[i], FALSE);
+		}
+		g_once_init_leave (&blacklist_once, (gsize) blacklist);
+	}
+	return (AsUtilsBlacklist *) blacklist_once;
+}
+
+static gboolean
+as_utils_blacklist_globs_match (GPtrArray *globs, const gchar *desktop_id, guint len)
+{
+	AsUtilsBlacklistGlob *item;
+	guint i;
+
+	if (globs == NULL)
+		return FALSE;
+	for (i = 0; i < globs->len; i++) {
+		item = g_ptr_array_index (globs, i);
+		if (item->spec != NULL) {
+			if (g_pattern_match (item->spec, len, desktop_id, NULL))
+				return TRUE;
+			continue;
+		}
+		if (fnmatch (item->glob, desktop_id, 0) == 0)
+			return TRUE;
+	}
+	return FALSE;
 }
 
 /**
  * as_utils_is_blacklisted_id:
  * @desktop_id: a desktop ID, e.g. "gimp.desktop"
  *
- * Searches the known list of blacklisted desktop IDs.
+ * Searches the known list of blacklisted desktop IDs, and any added using
+ * as_utils_add_blacklisted_id().
  *
  * Returns: %TRUE if the desktop ID is blacklisted
  *
@@ -374,24 +795,79 @@ as_utils_is_spdx_license_id (const gchar *license_id)
 gboolean
 as_utils_is_blacklisted_id (const gchar *desktop_id)
 {
-	guint i;
-	_cleanup_bytes_unref_ GBytes *data = NULL;
-	_cleanup_free_ gchar *key = NULL;
-	_cleanup_strv_free_ gchar **split = NULL;
+	AsUtilsBlacklist *blacklist;
+	gboolean ret;
+	guint len;
 
-	/* load the readonly data section and look for the icon name */
-	data = g_resource_lookup_data (as_get_resource (),
-				       "/org/freedesktop/appstream-glib/as-blacklist-ids.txt",
-				       G_RESOURCE_LOOKUP_FLAGS_NONE,
-				       NULL);
-	if (data == NULL)
+	if (desktop_id == NULL)
 		return FALSE;
-	split = g_strsplit (g_bytes_get_data (data, NULL), "\n", -1);
-	for (i = 0; split[i] != NULL; i++) {
-		if (fnmatch (split[i], desktop_id, 0) == 0)
-			return TRUE;
-	}
-	return FALSE;
+	len = strlen (desktop_id);
+
+#ifdef HAVE_GPERF
+	/* exact IDs are in a perfect hash generated at build time */
+	if (as_blacklist_id_from_gperf (desktop_id, len) != NULL)
+		return TRUE;
+#endif
+
+	/* check the compiled matcher */
+	blacklist = as_utils_blacklist_get ();
+	g_rw_lock_reader_lock (&as_utils_blacklist_lock);
+	ret = g_hash_table_contains (blacklist->ids, desktop_id) ||
+	      g_hash_table_contains (blacklist->ids_extra, desktop_id) ||
+	      as_utils_blacklist_globs_match (blacklist->globs[(guchar) desktop_id[0]],
+					      desktop_id, len) ||
+	      as_utils_blacklist_globs_match (blacklist->globs_any,
+					      desktop_id, len);
+	g_rw_lock_reader_unlock (&as_utils_blacklist_lock);
+	return ret;
+}
+
+/**
+ * as_utils_add_blacklisted_id:
+ * @desktop_id: a desktop ID, or a glob such as "kcm*.desktop"
+ *
+ * Adds an extra site-specific entry to the list used by
+ * as_utils_is_blacklisted_id(). The entry applies to the whole process.
+ *
+ * Since: 0.5.0
+ **/
+void
+as_utils_add_blacklisted_id (const gchar *desktop_id)
+{
+	AsUtilsBlacklist *blacklist;
+
+	g_return_if_fail (desktop_id != NULL && desktop_id[0] != '\0');
+
+	blacklist = as_utils_blacklist_get ();
+	g_rw_lock_writer_lock (&as_utils_blacklist_lock);
+	as_utils_blacklist_add (blacklist, desktop_id, TRUE);
+	g_rw_lock_writer_unlock (&as_utils_blacklist_lock);
+}
+
+/**
+ * as_utils_remove_blacklisted_id:
+ * @desktop_id: a desktop ID or glob
+ *
+ * Removes an entry previously added using as_utils_add_blacklisted_id().
+ * The built-in entries cannot be removed.
+ *
+ * Returns: %TRUE if the entry was found and removed
+ *
+ * Since: 0.5.0
+ **/
+gboolean
+as_utils_remove_blacklisted_id (const gchar *desktop_id)
+{
+	AsUtilsBlacklist *blacklist;
+	gboolean ret;
+
+	g_return_val_if_fail (desktop_id != NULL && desktop_id[0] != '\0', FALSE);
+
+	blacklist = as_utils_blacklist_get ();
+	g_rw_lock_writer_lock (&as_utils_blacklist_lock);
+	ret = as_utils_blacklist_remove (blacklist, desktop_id);
+	g_rw_lock_writer_unlock (&as_utils_blacklist_lock);
+	return ret;
 }
 
 /**
@@ -407,6 +883,12 @@ as_utils_is_blacklisted_id (const gchar *desktop_id)
 gboolean
 as_utils_is_environment_id (const gchar *environment_id)
 {
+#ifdef HAVE_GPERF
+	/* use a perfect hash generated at build time */
+	if (environment_id == NULL)
+		return FALSE;
+	return as_environment_id_from_gperf (environment_id, strlen (environment_id)) != NULL;
+#else
 	_cleanup_bytes_unref_ GBytes *data = NULL;
 	_cleanup_free_ gchar *key = NULL;
 
@@ -419,6 +901,7 @@ as_utils_is_environment_id (const gchar *environment_id)
 		return FALSE;
 	key = g_strdup_printf ("\n%s\n", environment_id);
 	return g_strstr_len (g_bytes_get_data (data, NULL), -1, key) != NULL;
+#endif
 }
 
 /**
@@ -434,6 +917,12 @@ as_utils_is_environment_id (const gchar *environment_id)
 gboolean
 as_utils_is_category_id (const gchar *category_id)
 {
+#ifdef HAVE_GPERF
+	/* use a perfect hash generated at build time */
+	if (category_id == NULL)
+		return FALSE;
+	return as_category_id_from_gperf (category_id, strlen (category_id)) != NULL;
+#else
 	_cleanup_bytes_unref_ GBytes *data = NULL;
 	_cleanup_free_ gchar *key = NULL;
 
@@ -446,6 +935,7 @@ as_utils_is_category_id (const gchar *category_id)
 		return FALSE;
 	key = g_strdup_printf ("\n%s\n", category_id);
 	return g_strstr_len (g_bytes_get_data (data, NULL), -1, key) != NULL;
+#endif
 }
 
 typedef struct {
@@ -530,22 +1020,8 @@ as_utils_spdx_license_tokenize_drop (AsUtilsSpdxHelper *helper)
 	g_string_truncate (helper->collect, 0);
 }
 
-/**
- * as_utils_spdx_license_tokenize:
- * @license: a license string, e.g. "LGPLv2+ and (QPL or GPLv2) and MIT"
- *
- * Tokenizes the SPDX license string (or any simarly formatted string)
- * into parts. Any licence parts of the string e.g. "LGPL-2.0+" are prefexed
- * with "@", the conjunctive replaced with "&" and the disjunctive replaced
- * with "|". Brackets are added as indervidual tokens and other strings are
- * appended into single tokens where possible.
- *
- * Returns: (transfer full): array of strings
- *
- * Since: 0.1.5
- **/
-gchar **
-as_utils_spdx_license_tokenize (const gchar *license)
+static gchar **
+as_utils_spdx_license_tokenize_real (const gchar *license)
 {
 	guint i;
 	AsUtilsSpdxHelper helper;
@@ -580,6 +1056,124 @@ as_utils_spdx_license_tokenize (const gchar *license)
 	return (gchar **) g_ptr_array_free (helper.array, FALSE);
 }
 
+static gboolean
+as_utils_spdx_license_tokens_valid (gchar **tokens)
+{
+	guint i;
+
+	for (i = 0; tokens[i] != NULL; i++) {
+		if (tokens[i][0] == '@') {
+			if (as_utils_is_spdx_license_id (tokens[i] + 1))
+				continue;
+		}
+		if (as_utils_is_spdx_license_id (tokens[i]))
+			continue;
+		if (g_strcmp0 (tokens[i], "&") == 0)
+			continue;
+		if (g_strcmp0 (tokens[i], "|") == 0)
+			continue;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* the same few license strings are seen for every application in a
+ * catalog, so remember the result of tokenizing and validating them */
+#define AS_UTILS_SPDX_CACHE_SIZE_MAX	1024
+
+typedef struct {
+	gchar		**tokens;
+	gboolean	 valid;
+} AsUtilsSpdxCacheItem;
+
+G_LOCK_DEFINE_STATIC (as_utils_spdx_cache);
+static GHashTable *as_utils_spdx_cache = NULL;
+
+static void
+as_utils_spdx_cache_item_free (gpointer data)
+{
+	AsUtilsSpdxCacheItem *item = (AsUtilsSpdxCacheItem *) data;
+	g_strfreev (item->tokens);
+	g_slice_free (AsUtilsSpdxCacheItem, item);
+}
+
+/**
+ * as_utils_spdx_license_lookup:
+ * @license: a license string
+ * @tokens: (out) (allow-none): a copy of the license tokens, or %NULL
+ *
+ * Tokenizes and validates the license string, reusing the result from an
+ * earlier call with the same string if possible.
+ *
+ * Returns: %TRUE if the license string is a valid SPDX license
+ **/
+static gboolean
+as_utils_spdx_license_lookup (const gchar *license, gchar ***tokens)
+{
+	AsUtilsSpdxCacheItem *item;
+	gboolean valid = FALSE;
+	gboolean found = FALSE;
+
+	/* seen before */
+	G_LOCK (as_utils_spdx_cache);
+	if (as_utils_spdx_cache != NULL) {
+		item = g_hash_table_lookup (as_utils_spdx_cache, license);
+		if (item != NULL) {
+			if (tokens != NULL)
+				*tokens = g_strdupv (item->tokens);
+			valid = item->valid;
+			found = TRUE;
+		}
+	}
+	G_UNLOCK (as_utils_spdx_cache);
+	if (found)
+		return valid;
+
+	/* tokenize outside the lock so other threads are not blocked */
+	item = g_slice_new0 (AsUtilsSpdxCacheItem);
+	item->tokens = as_utils_spdx_license_tokenize_real (license);
+	item->valid = as_utils_spdx_license_tokens_valid (item->tokens);
+	if (tokens != NULL)
+		*tokens = g_strdupv (item->tokens);
+	valid = item->valid;
+
+	/* add to the cache, starting again if it has grown too large */
+	G_LOCK (as_utils_spdx_cache);
+	if (as_utils_spdx_cache == NULL) {
+		as_utils_spdx_cache = g_hash_table_new_full (g_str_hash,
+							     g_str_equal,
+							     g_free,
+							     as_utils_spdx_cache_item_free);
+	}
+	if (g_hash_table_size (as_utils_spdx_cache) >= AS_UTILS_SPDX_CACHE_SIZE_MAX)
+		g_hash_table_remove_all (as_utils_spdx_cache);
+	g_hash_table_insert (as_utils_spdx_cache, g_strdup (license), item);
+	G_UNLOCK (as_utils_spdx_cache);
+	return valid;
+}
+
+/**
+ * as_utils_spdx_license_tokenize:
+ * @license: a license string, e.g. "LGPLv2+ and (QPL or GPLv2) and MIT"
+ *
+ * Tokenizes the SPDX license string (or any simarly formatted string)
+ * into parts. Any licence parts of the string e.g. "LGPL-2.0+" are prefexed
+ * with "@", the conjunctive replaced with "&" and the disjunctive replaced
+ * with "|". Brackets are added as indervidual tokens and other strings are
+ * appended into single tokens where possible.
+ *
+ * Returns: (transfer full): array of strings
+ *
+ * Since: 0.1.5
+ **/
+gchar **
+as_utils_spdx_license_tokenize (const gchar *license)
+{
+	gchar **tokens = NULL;
+	as_utils_spdx_license_lookup (license, &tokens);
+	return tokens;
+}
+
 /**
  * as_utils_spdx_license_detokenize:
  * @license_tokens: license tokens, typically from as_utils_spdx_license_tokenize()
@@ -629,24 +1223,7 @@ as_utils_spdx_license_detokenize (gchar **license_tokens)
 gboolean
 as_utils_is_spdx_license (const gchar *license)
 {
-	guint i;
-	_cleanup_strv_free_ gchar **tokens = NULL;
-
-	tokens = as_utils_spdx_license_tokenize (license);
-	for (i = 0; tokens[i] != NULL; i++) {
-		if (tokens[i][0] == '@') {
-			if (as_utils_is_spdx_license_id (tokens[i] + 1))
-				continue;
-		}
-		if (as_utils_is_spdx_license_id (tokens[i]))
-			continue;
-		if (g_strcmp0 (tokens[i], "&") == 0)
-			continue;
-		if (g_strcmp0 (tokens[i], "|") == 0)
-			continue;
-		return FALSE;
-	}
-	return TRUE;
+	return as_utils_spdx_license_lookup (license, NULL);
 }
 
 /**
@@ -1428,6 +2005,50 @@ as_utils_search_tokenize (const gchar *search)
 	return values;
 }
 
+/**
+ * as_utils_vercmp_section:
+ *
+ * Parses one dot-separated section of a version without copying it, using
+ * the same rules as g_ascii_strtoll() would on the split section, and moves
+ * @str to the '.' or NUL that follows.
+ *
+ * Returns: %FALSE if the section is not a non-negative integer
+ **/
+static gboolean
+as_utils_vercmp_section (const gchar **str, guint64 *value)
+{
+	const gchar *tmp = *str;
+	gboolean digits = FALSE;
+	gboolean negative = FALSE;
+	guint64 val = 0;
+
+	while (g_ascii_isspace (*tmp))
+		tmp++;
+	if (*tmp == '+' || *tmp == '-') {
+		negative = *tmp == '-';
+		tmp++;
+	}
+	for (; g_ascii_isdigit (*tmp); tmp++) {
+		guint digit = (guint) (*tmp - '0');
+		digits = TRUE;
+		if (val > (G_MAXINT64 - digit) / 10)
+			val = G_MAXINT64;
+		else
+			val = val * 10 + digit;
+	}
+
+	/* nothing was parsed, which is only valid for an empty section */
+	if (!digits)
+		tmp = *str;
+	if (*tmp != '.' && *tmp != '\0')
+		return FALSE;
+	if (negative && val > 0)
+		return FALSE;
+	*value = val;
+	*str = tmp;
+	return TRUE;
+}
+
 /**
  * as_utils_vercmp:
  * @version_a: the release version, e.g. 1.2.3
@@ -1443,13 +2064,12 @@ as_utils_search_tokenize (const gchar *search)
 gint
 as_utils_vercmp (const gchar *version_a, const gchar *version_b)
 {
-	gchar *endptr;
-	gint64 ver_a;
-	gint64 ver_b;
-	guint i;
-	guint longest_split;
-	_cleanup_strv_free_ gchar **split_a = NULL;
-	_cleanup_strv_free_ gchar **split_b = NULL;
+	const gchar *tmp_a = version_a;
+	const gchar *tmp_b = version_b;
+	gboolean more_a;
+	gboolean more_b;
+	guint64 ver_a;
+	guint64 ver_b;
 
 	/* sanity check */
 	if (version_a == NULL || version_b == NULL)
@@ -1459,39 +2079,161 @@ as_utils_vercmp (const gchar *version_a, const gchar *version_b)
 	if (g_strcmp0 (version_a, version_b) == 0)
 		return 0;
 
-	/* split into sections, and try to parse */
-	split_a = g_strsplit (version_a, ".", -1);
-	split_b = g_strsplit (version_b, ".", -1);
-	longest_split = MAX (g_strv_length (split_a), g_strv_length (split_b));
-	for (i = 0; i < longest_split; i++) {
+	/* compare each section in place */
+	more_a = *tmp_a != '\0';
+	more_b = *tmp_b != '\0';
+	while (more_a || more_b) {
 
 		/* we lost or gained a dot */
-		if (split_a[i] == NULL)
+		if (!more_a)
 			return -1;
-		if (split_b[i] == NULL)
+		if (!more_b)
 			return 1;
 
 		/* compare integers */
-		ver_a = g_ascii_strtoll (split_a[i], &endptr, 10);
-		if (endptr != NULL && endptr[0] != '\0')
-			return G_MAXINT;
-		if (ver_a < 0)
-			return G_MAXINT;
-		ver_b = g_ascii_strtoll (split_b[i], &endptr, 10);
-		if (endptr != NULL && endptr[0] != '\0')
+		if (!as_utils_vercmp_section (&tmp_a, &ver_a))
 			return G_MAXINT;
-		if (ver_b < 0)
+		if (!as_utils_vercmp_section (&tmp_b, &ver_b))
 			return G_MAXINT;
 		if (ver_a < ver_b)
 			return -1;
 		if (ver_a > ver_b)
 			return 1;
-	}
 
-	/* we really shouldn't get here */
+		/* skip the dot */
+		more_a = *tmp_a == '.';
+		if (more_a)
+			tmp_a++;
+		more_b = *tmp_b == '.';
+		if (more_b)
+			tmp_b++;
+	}
 	return 0;
 }
 
+/* the first byte of a version key */
+#define AS_UTILS_VERSION_KEY_VALID	0x00
+#define AS_UTILS_VERSION_KEY_INVALID	0x01
+
+/* the section that as_utils_vercmp() would fail on */
+#define AS_UTILS_VERSION_KEY_ERROR	0xff
+
+/**
+ * as_utils_version_key:
+ * @version: the release version, e.g. 1.2.3
+ *
+ * Parses a version once so that it can be compared many times using
+ * as_utils_vercmp_key(), for instance when sorting.
+ *
+ * Each section is stored as its length in bytes followed by the value in
+ * big-endian order, so that keys for valid versions sort with memcmp().
+ *
+ * Returns: (transfer full): a key, or %NULL if @version is %NULL
+ *
+ * Since: 0.5.0
+ */
+GBytes *
+as_utils_version_key (const gchar *version)
+{
+	GByteArray *key;
+	const gchar *tmp = version;
+	gboolean more;
+	guint64 val;
+	guint8 buf[8];
+	guint8 len;
+
+	if (version == NULL)
+		return NULL;
+
+	key = g_byte_array_sized_new (strlen (version) + 1);
+	buf[0] = AS_UTILS_VERSION_KEY_VALID;
+	g_byte_array_append (key, buf, 1);
+	more = *tmp != '\0';
+	while (more) {
+
+		/* keep the whole string so different versions never match */
+		if (!as_utils_vercmp_section (&tmp, &val)) {
+			key->data[0] = AS_UTILS_VERSION_KEY_INVALID;
+			buf[0] = AS_UTILS_VERSION_KEY_ERROR;
+			g_byte_array_append (key, buf, 1);
+			g_byte_array_append (key, (const guint8 *) version,
+					     strlen (version));
+			break;
+		}
+		for (len = 0; val > 0; len++) {
+			buf[sizeof (buf) - len - 1] = val & 0xff;
+			val >>= 8;
+		}
+		g_byte_array_append (key, &len, 1);
+		g_byte_array_append (key, buf + sizeof (buf) - len, len);
+
+		/* skip the dot */
+		more = *tmp == '.';
+		if (more)
+			tmp++;
+	}
+	return g_byte_array_free_to_bytes (key);
+}
+
+/**
+ * as_utils_vercmp_key:
+ * @key_a: a key from as_utils_version_key()
+ * @key_b: a key from as_utils_version_key()
+ *
+ * Compares version keys, giving the same result as as_utils_vercmp() would
+ * for the versions they were created from, without parsing them again.
+ *
+ * Returns: -1 if a < b, +1 if a > b, 0 if they are equal, and %G_MAXINT on error
+ *
+ * Since: 0.5.0
+ */
+gint
+as_utils_vercmp_key (GBytes *key_a, GBytes *key_b)
+{
+	const guint8 *data_a;
+	const guint8 *data_b;
+	gint rc;
+	gsize i = 1;
+	gsize len_a;
+	gsize len_b;
+
+	/* sanity check */
+	if (key_a == NULL || key_b == NULL)
+		return G_MAXINT;
+
+	/* same version */
+	data_a = g_bytes_get_data (key_a, &len_a);
+	data_b = g_bytes_get_data (key_b, &len_b);
+	if (len_a == len_b && memcmp (data_a, data_b, len_a) == 0)
+		return 0;
+
+	/* a shorter key is a version with fewer sections */
+	if (data_a[0] == AS_UTILS_VERSION_KEY_VALID &&
+	    data_b[0] == AS_UTILS_VERSION_KEY_VALID) {
+		rc = memcmp (data_a, data_b, MIN (len_a, len_b));
+		if (rc != 0)
+			return rc < 0 ? -1 : 1;
+		return len_a < len_b ? -1 : 1;
+	}
+
+	/* compare each section until one is not a number */
+	for (;;) {
+		if (i >= len_a)
+			return -1;
+		if (i >= len_b)
+			return 1;
+		if (data_a[i] == AS_UTILS_VERSION_KEY_ERROR ||
+		    data_b[i] == AS_UTILS_VERSION_KEY_ERROR)
+			return G_MAXINT;
+		if (data_a[i] != data_b[i])
+			return data_a[i] < data_b[i] ? -1 : 1;
+		rc = memcmp (data_a + i + 1, data_b + i + 1, data_a[i]);
+		if (rc != 0)
+			return rc < 0 ? -1 : 1;
+		i += data_a[i] + 1;
+	}
+}
+
 /**
  * as_ptr_array_find_string:
  * @array: gchar* array
@@ -95,6 +95,11 @@ gchar		*as_markup_convert_simple	(const gchar	*markup,
 gchar		*as_markup_convert		(const gchar	*markup,
 						 AsMarkupConvertFormat format,
 						 GError		**error);
+gboolean	 as_markup_convert_to_string	(const gchar	*markup,
+						 gssize		 markup_len,
+						 AsMarkupConvertFormat format,
+						 GString	*str,
+						 GError		**error);
 gchar		**as_markup_strsplit_words	(const gchar	*text,
 						 guint		 line_len);
 
@@ -105,6 +110,8 @@ gboolean	 as_utils_is_spdx_license	(const gchar	*license);
 gboolean	 as_utils_is_environment_id	(const gchar	*environment_id);
 gboolean	 as_utils_is_category_id	(const gchar	*category_id);
 gboolean	 as_utils_is_blacklisted_id	(const gchar	*desktop_id);
+void		 as_utils_add_blacklisted_id	(const gchar	*desktop_id);
+gboolean	 as_utils_remove_blacklisted_id	(const gchar	*desktop_id);
 gchar		**as_utils_spdx_license_tokenize (const gchar	*license);
 gchar		*as_utils_spdx_license_detokenize (gchar	**license_tokens);
 gboolean	 as_utils_check_url_exists	(const gchar	*url,
@@ -126,6 +133,9 @@ gboolean	 as_utils_search_token_valid	(const gchar	*token);
 gchar		**as_utils_search_tokenize	(const gchar	*search);
 gint		 as_utils_vercmp		(const gchar	*version_a,
 						 const gchar	*version_b);
+GBytes		*as_utils_version_key		(const gchar	*version);
+gint		 as_utils_vercmp_key		(GBytes		*key_a,
+						 GBytes		*key_b);
 
 G_END_DECLS
 
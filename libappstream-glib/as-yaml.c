@@ -21,6 +21,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #ifdef AS_BUILD_DEP11
 #include <yaml.h>
 #endif
@@ -99,6 +101,50 @@ as_yaml_node_get_value_as_int (const GNode *node)
 	return value_tmp;
 }
 
+/**
+ * as_yaml_node_checksum_update:
+ **/
+static void
+as_yaml_node_checksum_update (GChecksum *csum, const GNode *node)
+{
+	AsYamlNode *ym = node->data;
+	const GNode *c;
+
+	/* include the NULs so that adjacent strings cannot run together */
+	if (ym != NULL) {
+		guint8 kind = ym->kind;
+		g_checksum_update (csum, &kind, 1);
+		if (ym->key != NULL)
+			g_checksum_update (csum, (const guchar *) ym->key, strlen (ym->key));
+		g_checksum_update (csum, (const guchar *) "", 1);
+		if (ym->value != NULL)
+			g_checksum_update (csum, (const guchar *) ym->value, strlen (ym->value));
+		g_checksum_update (csum, (const guchar *) "", 1);
+	}
+
+	/* mark where the children start and end */
+	g_checksum_update (csum, (const guchar *) "[", 1);
+	for (c = node->children; c != NULL; c = c->next)
+		as_yaml_node_checksum_update (csum, c);
+	g_checksum_update (csum, (const guchar *) "]", 1);
+}
+
+/**
+ * as_yaml_node_get_checksum:
+ **/
+gchar *
+as_yaml_node_get_checksum (const GNode *node)
+{
+	gchar *tmp;
+	GChecksum *csum;
+
+	csum = g_checksum_new (G_CHECKSUM_SHA1);
+	as_yaml_node_checksum_update (csum, node);
+	tmp = g_strdup (g_checksum_get_string (csum));
+	g_checksum_free (csum);
+	return tmp;
+}
+
 /**
  * as_node_yaml_destroy_node_cb:
  **/
@@ -212,8 +258,8 @@ as_yaml_node_new (AsYamlNodeKind kind, const gchar *id)
 /**
  * as_node_yaml_process_layer:
  **/
-static void
-as_node_yaml_process_layer (yaml_parser_t *parser, GNode *parent)
+static gboolean
+as_node_yaml_process_layer (yaml_parser_t *parser, GNode *parent, GError **error)
 {
 	AsYamlNode *ym;
 	GNode *last_scalar = NULL;
@@ -223,7 +269,14 @@ as_node_yaml_process_layer (yaml_parser_t *parser, GNode *parent)
 	yaml_event_t event;
 
 	while (valid) {
-		yaml_parser_parse (parser, &event);
+		if (!yaml_parser_parse (parser, &event)) {
+			g_set_error (error,
+				     AS_NODE_ERROR,
+				     AS_NODE_ERROR_FAILED,
+				     "failed to parse YAML: %s",
+				     parser->problem);
+			return FALSE;
+		}
 		switch (event.type) {
 		case YAML_SCALAR_EVENT:
 			tmp = (const gchar *) event.data.scalar.value;
@@ -247,7 +300,10 @@ as_node_yaml_process_layer (yaml_parser_t *parser, GNode *parent)
 				ym->kind = AS_YAML_NODE_KIND_MAP;
 				new = last_scalar;
 			}
-			as_node_yaml_process_layer (parser, new);
+			if (!as_node_yaml_process_layer (parser, new, error)) {
+				yaml_event_delete (&event);
+				return FALSE;
+			}
 			last_scalar = NULL;
 			break;
 		case YAML_SEQUENCE_START_EVENT:
@@ -259,13 +315,15 @@ as_node_yaml_process_layer (yaml_parser_t *parser, GNode *parent)
 				ym->kind = AS_YAML_NODE_KIND_SEQ;
 				new = last_scalar;
 			}
-			as_node_yaml_process_layer (parser, new);
+			if (!as_node_yaml_process_layer (parser, new, error)) {
+				yaml_event_delete (&event);
+				return FALSE;
+			}
 			last_scalar = NULL;
 			break;
-		case YAML_STREAM_START_EVENT:
-			break;
 		case YAML_MAPPING_END_EVENT:
 		case YAML_SEQUENCE_END_EVENT:
+		case YAML_DOCUMENT_END_EVENT:
 		case YAML_STREAM_END_EVENT:
 			valid = FALSE;
 			break;
@@ -274,9 +332,75 @@ as_node_yaml_process_layer (yaml_parser_t *parser, GNode *parent)
 		}
 		yaml_event_delete (&event);
 	}
+	return TRUE;
+}
+
+/**
+ * as_yaml_parse_documents:
+ *
+ * Builds a tree for each document in the stream in turn and hands it to
+ * @func, freeing it before the next document is read.
+ **/
+static gboolean
+as_yaml_parse_documents (yaml_parser_t *parser,
+			 AsYamlDocumentFunc func,
+			 gpointer user_data,
+			 GCancellable *cancellable,
+			 GError **error)
+{
+	yaml_event_t event;
+
+	while (TRUE) {
+		_cleanup_yaml_unref_ GNode *node = NULL;
+
+		if (!yaml_parser_parse (parser, &event)) {
+			g_set_error (error,
+				     AS_NODE_ERROR,
+				     AS_NODE_ERROR_FAILED,
+				     "failed to parse YAML: %s",
+				     parser->problem);
+			return FALSE;
+		}
+		if (event.type == YAML_STREAM_END_EVENT) {
+			yaml_event_delete (&event);
+			break;
+		}
+		if (event.type != YAML_DOCUMENT_START_EVENT) {
+			yaml_event_delete (&event);
+			continue;
+		}
+		yaml_event_delete (&event);
+
+		/* build just this document */
+		if (g_cancellable_set_error_if_cancelled (cancellable, error))
+			return FALSE;
+		node = g_node_new (NULL);
+		if (!as_node_yaml_process_layer (parser, node, error))
+			return FALSE;
+		if (!func (node, user_data, error))
+			return FALSE;
+	}
+	return TRUE;
 }
 #endif
 
+/**
+ * as_yaml_append_document_cb:
+ **/
+static gboolean
+as_yaml_append_document_cb (GNode *node, gpointer user_data, GError **error)
+{
+	GNode *root = (GNode *) user_data;
+	GNode *c;
+
+	/* move the document contents into the combined tree */
+	while ((c = node->children) != NULL) {
+		g_node_unlink (c);
+		g_node_append (root, c);
+	}
+	return TRUE;
+}
+
 /**
  * as_yaml_from_data:
  **/
@@ -293,7 +417,11 @@ as_yaml_from_data (const gchar *data, gssize data_len, GError **error)
 		data_len = strlen (data);
 	yaml_parser_set_input_string (&parser, (guchar *) data, data_len);
 	node = g_node_new (NULL);
-	as_node_yaml_process_layer (&parser, node);
+	if (!as_yaml_parse_documents (&parser, as_yaml_append_document_cb,
+				      node, NULL, error)) {
+		as_yaml_unref (node);
+		node = NULL;
+	}
 	yaml_parser_delete (&parser);
 #else
 	g_set_error_literal (error,
@@ -318,23 +446,17 @@ as_yaml_read_handler_cb (void *data,
 	*size_read = g_input_stream_read (stream, buffer, size, NULL, NULL);
 	return 1;
 }
-#endif
 
 /**
- * as_yaml_from_file:
+ * as_yaml_open_stream:
  **/
-GNode *
-as_yaml_from_file (GFile *file, GCancellable *cancellable, GError **error)
+static GInputStream *
+as_yaml_open_stream (GFile *file, GCancellable *cancellable, GError **error)
 {
-	GNode *node = NULL;
-#if AS_BUILD_DEP11
 	const gchar *content_type = NULL;
-	yaml_parser_t parser;
-	_cleanup_free_ gchar *data = NULL;
 	_cleanup_object_unref_ GConverter *conv = NULL;
 	_cleanup_object_unref_ GFileInfo *info = NULL;
 	_cleanup_object_unref_ GInputStream *file_stream = NULL;
-	_cleanup_object_unref_ GInputStream *stream_data = NULL;
 
 	/* what kind of file is this */
 	info = g_file_query_info (file,
@@ -353,29 +475,505 @@ as_yaml_from_file (GFile *file, GCancellable *cancellable, GError **error)
 	if (g_strcmp0 (content_type, "application/gzip") == 0 ||
 	    g_strcmp0 (content_type, "application/x-gzip") == 0) {
 		conv = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP));
-		stream_data = g_converter_input_stream_new (file_stream, conv);
-	} else if (g_strcmp0 (content_type, "application/x-yaml") == 0) {
-		stream_data = g_object_ref (file_stream);
-	} else {
-		g_set_error (error,
-			     AS_NODE_ERROR,
-			     AS_NODE_ERROR_FAILED,
-			     "cannot process file of type %s",
-			     content_type);
-		return NULL;
+		return g_converter_input_stream_new (file_stream, conv);
 	}
+	if (g_strcmp0 (content_type, "application/x-yaml") == 0)
+		return g_object_ref (file_stream);
+	g_set_error (error,
+		     AS_NODE_ERROR,
+		     AS_NODE_ERROR_FAILED,
+		     "cannot process file of type %s",
+		     content_type);
+	return NULL;
+}
+#endif
+
+/**
+ * as_yaml_from_file_foreach:
+ * @file: a #GFile
+ * @func: a #AsYamlDocumentFunc
+ * @user_data: user data to pass to @func
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: A #GError or %NULL
+ *
+ * Parses a YAML file one document at a time, calling @func for each.
+ * The tree passed to @func is only valid for the duration of the call,
+ * so only one document is ever held in memory.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+as_yaml_from_file_foreach (GFile *file,
+			   AsYamlDocumentFunc func,
+			   gpointer user_data,
+			   GCancellable *cancellable,
+			   GError **error)
+{
+#if AS_BUILD_DEP11
+	gboolean ret;
+	yaml_parser_t parser;
+	_cleanup_object_unref_ GInputStream *stream_data = NULL;
+
+	stream_data = as_yaml_open_stream (file, cancellable, error);
+	if (stream_data == NULL)
+		return FALSE;
 
 	/* parse */
 	yaml_parser_initialize (&parser);
 	yaml_parser_set_input (&parser, as_yaml_read_handler_cb, stream_data);
-	node = g_node_new (NULL);
-	as_node_yaml_process_layer (&parser, node);
+	ret = as_yaml_parse_documents (&parser, func, user_data,
+				       cancellable, error);
 	yaml_parser_delete (&parser);
+	return ret;
 #else
 	g_set_error_literal (error,
 			     AS_NODE_ERROR,
 			     AS_NODE_ERROR_NO_SUPPORT,
 			     "No DEP-11 support, needs libyaml");
+	return FALSE;
+#endif
+}
+
+#if AS_BUILD_DEP11
+/**
+ * as_yaml_find_document_start:
+ *
+ * Returns the offset of the first "---" marker after the start of @str,
+ * or 0 if there is no complete marker line yet.
+ **/
+static gsize
+as_yaml_find_document_start (const gchar *str, gsize len, gsize *scanned)
+{
+	const gchar *tmp;
+	gsize i = MAX (*scanned, 1);
+
+	while (i < len) {
+		tmp = memchr (str + i - 1, '\n', len - i + 1);
+		if (tmp == NULL)
+			break;
+		i = (gsize) (tmp - str) + 1;
+
+		/* need the character after the marker to decide */
+		if (i + 3 >= len) {
+			*scanned = i;
+			return 0;
+		}
+		if (memcmp (str + i, "---", 3) == 0 &&
+		    g_ascii_isspace (str[i + 3]))
+			return i;
+		i++;
+	}
+	*scanned = len;
+	return 0;
+}
+#endif
+
+/**
+ * as_yaml_from_file_split:
+ * @file: a #GFile
+ * @func: a #AsYamlSplitFunc
+ * @user_data: user data to pass to @func
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: A #GError or %NULL
+ *
+ * Splits a YAML file at the "---" document markers without parsing it,
+ * calling @func with the text of each document in order. The documents
+ * can then be parsed independently using as_yaml_from_data().
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+as_yaml_from_file_split (GFile *file,
+			 AsYamlSplitFunc func,
+			 gpointer user_data,
+			 GCancellable *cancellable,
+			 GError **error)
+{
+#if AS_BUILD_DEP11
+	gchar chunk[32 * 1024];
+	gsize offset;
+	gsize scanned = 0;
+	gssize len;
+	_cleanup_object_unref_ GInputStream *stream_data = NULL;
+	_cleanup_string_free_ GString *buf = NULL;
+
+	stream_data = as_yaml_open_stream (file, cancellable, error);
+	if (stream_data == NULL)
+		return FALSE;
+
+	buf = g_string_new (NULL);
+	while (TRUE) {
+		len = g_input_stream_read (stream_data, chunk, sizeof (chunk),
+					   cancellable, error);
+		if (len < 0)
+			return FALSE;
+		if (len == 0)
+			break;
+		g_string_append_len (buf, chunk, len);
+
+		/* hand over each complete document */
+		while ((offset = as_yaml_find_document_start (buf->str,
+							      buf->len,
+							      &scanned)) > 0) {
+			if (!func (buf->str, offset, user_data, error))
+				return FALSE;
+			g_string_erase (buf, 0, offset);
+			scanned = 0;
+		}
+	}
+
+	/* last document */
+	if (buf->len > 0 && !func (buf->str, buf->len, user_data, error))
+		return FALSE;
+	return TRUE;
+#else
+	g_set_error_literal (error,
+			     AS_NODE_ERROR,
+			     AS_NODE_ERROR_NO_SUPPORT,
+			     "No DEP-11 support, needs libyaml");
+	return FALSE;
 #endif
+}
+
+/**
+ * as_yaml_from_file:
+ **/
+GNode *
+as_yaml_from_file (GFile *file, GCancellable *cancellable, GError **error)
+{
+	GNode *node;
+
+	node = g_node_new (NULL);
+	if (!as_yaml_from_file_foreach (file, as_yaml_append_document_cb,
+					node, cancellable, error)) {
+		as_yaml_unref (node);
+		return NULL;
+	}
 	return node;
 }
+
+struct _AsYamlEmitter {
+	GOutputStream		*stream;
+	GError			*error;
+#if AS_BUILD_DEP11
+	yaml_emitter_t		 emitter;
+#endif
+};
+
+#if AS_BUILD_DEP11
+/**
+ * as_yaml_write_handler_cb:
+ **/
+static int
+as_yaml_write_handler_cb (void *data, unsigned char *buffer, size_t size)
+{
+	AsYamlEmitter *emitter = (AsYamlEmitter *) data;
+	if (emitter->error != NULL)
+		return 0;
+	if (!g_output_stream_write_all (emitter->stream, buffer, size,
+					NULL, NULL, &emitter->error))
+		return 0;
+	return 1;
+}
+
+/**
+ * as_yaml_emitter_emit:
+ **/
+static void
+as_yaml_emitter_emit (AsYamlEmitter *emitter, yaml_event_t *event)
+{
+	if (emitter->error != NULL) {
+		yaml_event_delete (event);
+		return;
+	}
+	if (!yaml_emitter_emit (&emitter->emitter, event)) {
+		if (emitter->error != NULL)
+			return;
+		g_set_error (&emitter->error,
+			     AS_NODE_ERROR,
+			     AS_NODE_ERROR_FAILED,
+			     "failed to emit YAML: %s",
+			     emitter->emitter.problem);
+	}
+}
+#endif
+
+/**
+ * as_yaml_emitter_new:
+ * @stream: a #GOutputStream
+ * @error: A #GError or %NULL
+ *
+ * Creates a streaming YAML writer. Events are written to @stream as
+ * they are emitted, so no tree is built for the output.
+ *
+ * Returns: a new #AsYamlEmitter, or %NULL if YAML is not supported
+ **/
+AsYamlEmitter *
+as_yaml_emitter_new (GOutputStream *stream, GError **error)
+{
+#if AS_BUILD_DEP11
+	AsYamlEmitter *emitter;
+	yaml_event_t event;
+
+	emitter = g_slice_new0 (AsYamlEmitter);
+	emitter->stream = g_object_ref (stream);
+	yaml_emitter_initialize (&emitter->emitter);
+	yaml_emitter_set_unicode (&emitter->emitter, 1);
+	yaml_emitter_set_output (&emitter->emitter,
+				 as_yaml_write_handler_cb,
+				 emitter);
+	yaml_stream_start_event_initialize (&event, YAML_UTF8_ENCODING);
+	as_yaml_emitter_emit (emitter, &event);
+	return emitter;
+#else
+	g_set_error_literal (error,
+			     AS_NODE_ERROR,
+			     AS_NODE_ERROR_NO_SUPPORT,
+			     "No DEP-11 support, needs libyaml");
+	return NULL;
+#endif
+}
+
+/**
+ * as_yaml_emitter_document_start:
+ **/
+void
+as_yaml_emitter_document_start (AsYamlEmitter *emitter)
+{
+#if AS_BUILD_DEP11
+	yaml_event_t event;
+	yaml_document_start_event_initialize (&event, NULL, NULL, NULL, 0);
+	as_yaml_emitter_emit (emitter, &event);
+	as_yaml_emitter_mapping_start (emitter);
+#endif
+}
+
+/**
+ * as_yaml_emitter_document_end:
+ **/
+void
+as_yaml_emitter_document_end (AsYamlEmitter *emitter)
+{
+#if AS_BUILD_DEP11
+	yaml_event_t event;
+	as_yaml_emitter_mapping_end (emitter);
+	yaml_document_end_event_initialize (&event, 1);
+	as_yaml_emitter_emit (emitter, &event);
+#endif
+}
+
+/**
+ * as_yaml_emitter_mapping_start:
+ **/
+void
+as_yaml_emitter_mapping_start (AsYamlEmitter *emitter)
+{
+#if AS_BUILD_DEP11
+	yaml_event_t event;
+	yaml_mapping_start_event_initialize (&event, NULL, NULL, 1,
+					     YAML_BLOCK_MAPPING_STYLE);
+	as_yaml_emitter_emit (emitter, &event);
+#endif
+}
+
+/**
+ * as_yaml_emitter_mapping_end:
+ **/
+void
+as_yaml_emitter_mapping_end (AsYamlEmitter *emitter)
+{
+#if AS_BUILD_DEP11
+	yaml_event_t event;
+	yaml_mapping_end_event_initialize (&event);
+	as_yaml_emitter_emit (emitter, &event);
+#endif
+}
+
+/**
+ * as_yaml_emitter_sequence_start:
+ **/
+void
+as_yaml_emitter_sequence_start (AsYamlEmitter *emitter)
+{
+#if AS_BUILD_DEP11
+	yaml_event_t event;
+	yaml_sequence_start_event_initialize (&event, NULL, NULL, 1,
+					      YAML_BLOCK_SEQUENCE_STYLE);
+	as_yaml_emitter_emit (emitter, &event);
+#endif
+}
+
+/**
+ * as_yaml_emitter_sequence_end:
+ **/
+void
+as_yaml_emitter_sequence_end (AsYamlEmitter *emitter)
+{
+#if AS_BUILD_DEP11
+	yaml_event_t event;
+	yaml_sequence_end_event_initialize (&event);
+	as_yaml_emitter_emit (emitter, &event);
+#endif
+}
+
+/**
+ * as_yaml_emitter_scalar_full:
+ **/
+static void
+as_yaml_emitter_scalar_full (AsYamlEmitter *emitter,
+			     const gchar *value,
+			     gboolean plain)
+{
+#if AS_BUILD_DEP11
+	yaml_event_t event;
+	yaml_scalar_event_initialize (&event, NULL, NULL,
+				      (yaml_char_t *) value, -1,
+				      plain, 1, YAML_ANY_SCALAR_STYLE);
+	as_yaml_emitter_emit (emitter, &event);
+#endif
+}
+
+/**
+ * as_yaml_emitter_scalar:
+ *
+ * Emits a plain scalar, which readers are free to interpret as a number
+ * or boolean. This should only be used for fixed mapping keys and typed
+ * values, and as_yaml_emitter_key() for any other key.
+ **/
+void
+as_yaml_emitter_scalar (AsYamlEmitter *emitter, const gchar *value)
+{
+	as_yaml_emitter_scalar_full (emitter, value, TRUE);
+}
+
+/**
+ * as_yaml_emitter_string:
+ *
+ * Emits a quoted scalar, so that values such as "1.10" or "yes" are not
+ * read back as a float or boolean.
+ **/
+void
+as_yaml_emitter_string (AsYamlEmitter *emitter, const gchar *value)
+{
+	as_yaml_emitter_scalar_full (emitter, value, FALSE);
+}
+
+/**
+ * as_yaml_scalar_is_ambiguous:
+ *
+ * Returns %TRUE if a plain scalar would be read by a YAML 1.1 parser as
+ * a boolean, null or number rather than as a string.
+ **/
+static gboolean
+as_yaml_scalar_is_ambiguous (const gchar *value)
+{
+	const gchar *words[] = { "y", "yes", "n", "no", "true", "false",
+				 "on", "off", "null", "~", NULL };
+	guint i;
+
+	if (value[0] == '\0')
+		return TRUE;
+	for (i = 0; words[i] != NULL; i++) {
+		if (g_ascii_strcasecmp (value, words[i]) == 0)
+			return TRUE;
+	}
+
+	/* integers, floats, .inf and .nan in any of their forms */
+	if (g_ascii_isdigit (value[0]) || strchr ("+-.", value[0]) != NULL)
+		return TRUE;
+	return FALSE;
+}
+
+/**
+ * as_yaml_emitter_key:
+ *
+ * Emits a mapping key, which is only quoted if it would otherwise not be
+ * read back as a string, for instance the "no" locale.
+ **/
+void
+as_yaml_emitter_key (AsYamlEmitter *emitter, const gchar *key)
+{
+	as_yaml_emitter_scalar_full (emitter, key,
+				     !as_yaml_scalar_is_ambiguous (key));
+}
+
+/**
+ * as_yaml_emitter_key_value:
+ *
+ * Emits a key and its string value, or nothing at all if @value is %NULL.
+ **/
+void
+as_yaml_emitter_key_value (AsYamlEmitter *emitter,
+			   const gchar *key,
+			   const gchar *value)
+{
+	if (value == NULL)
+		return;
+	as_yaml_emitter_key (emitter, key);
+	as_yaml_emitter_string (emitter, value);
+}
+
+/**
+ * as_yaml_emitter_key_value_plain:
+ *
+ * Emits a key and a number or boolean value, or nothing at all if @value
+ * is %NULL.
+ **/
+void
+as_yaml_emitter_key_value_plain (AsYamlEmitter *emitter,
+				 const gchar *key,
+				 const gchar *value)
+{
+	if (value == NULL)
+		return;
+	as_yaml_emitter_key (emitter, key);
+	as_yaml_emitter_scalar (emitter, value);
+}
+
+/**
+ * as_yaml_emitter_close:
+ * @emitter: a #AsYamlEmitter
+ * @error: A #GError or %NULL
+ *
+ * Ends the stream and flushes any pending output.
+ *
+ * Returns: %TRUE if everything was written
+ **/
+gboolean
+as_yaml_emitter_close (AsYamlEmitter *emitter, GError **error)
+{
+#if AS_BUILD_DEP11
+	yaml_event_t event;
+	yaml_stream_end_event_initialize (&event);
+	as_yaml_emitter_emit (emitter, &event);
+	if (emitter->error == NULL && !yaml_emitter_flush (&emitter->emitter)) {
+		if (emitter->error == NULL) {
+			g_set_error_literal (&emitter->error,
+					     AS_NODE_ERROR,
+					     AS_NODE_ERROR_FAILED,
+					     "failed to flush YAML");
+		}
+	}
+#endif
+	if (emitter->error != NULL) {
+		g_propagate_error (error, emitter->error);
+		emitter->error = NULL;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * as_yaml_emitter_free:
+ **/
+void
+as_yaml_emitter_free (AsYamlEmitter *emitter)
+{
+#if AS_BUILD_DEP11
+	yaml_emitter_delete (&emitter->emitter);
+#endif
+	if (emitter->error != NULL)
+		g_error_free (emitter->error);
+	g_object_unref (emitter->stream);
+	g_slice_free (AsYamlEmitter, emitter);
+}
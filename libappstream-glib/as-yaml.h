@@ -31,6 +31,16 @@
 
 G_BEGIN_DECLS
 
+typedef struct _AsYamlEmitter AsYamlEmitter;
+
+typedef gboolean (*AsYamlDocumentFunc)		(GNode		*node,
+						 gpointer	 user_data,
+						 GError		**error);
+typedef gboolean (*AsYamlSplitFunc)		(const gchar	*data,
+						 gsize		 data_len,
+						 gpointer	 user_data,
+						 GError		**error);
+
 void		 as_yaml_unref			(GNode		*node);
 GString		*as_yaml_to_string		(GNode		*node);
 GNode		*as_yaml_from_data		(const gchar	*data,
@@ -39,9 +49,44 @@ GNode		*as_yaml_from_data		(const gchar	*data,
 GNode		*as_yaml_from_file		(GFile		*file,
 						 GCancellable	*cancellable,
 						 GError		**error);
+gboolean	 as_yaml_from_file_foreach	(GFile		*file,
+						 AsYamlDocumentFunc func,
+						 gpointer	 user_data,
+						 GCancellable	*cancellable,
+						 GError		**error);
+gboolean	 as_yaml_from_file_split	(GFile		*file,
+						 AsYamlSplitFunc func,
+						 gpointer	 user_data,
+						 GCancellable	*cancellable,
+						 GError		**error);
 const gchar	*as_yaml_node_get_key		(const GNode	*node);
 const gchar	*as_yaml_node_get_value		(const GNode	*node);
 gint		 as_yaml_node_get_value_as_int	(const GNode	*node);
+gchar		*as_yaml_node_get_checksum	(const GNode	*node);
+
+AsYamlEmitter	*as_yaml_emitter_new		(GOutputStream	*stream,
+						 GError		**error);
+void		 as_yaml_emitter_free		(AsYamlEmitter	*emitter);
+gboolean	 as_yaml_emitter_close		(AsYamlEmitter	*emitter,
+						 GError		**error);
+void		 as_yaml_emitter_document_start	(AsYamlEmitter	*emitter);
+void		 as_yaml_emitter_document_end	(AsYamlEmitter	*emitter);
+void		 as_yaml_emitter_mapping_start	(AsYamlEmitter	*emitter);
+void		 as_yaml_emitter_mapping_end	(AsYamlEmitter	*emitter);
+void		 as_yaml_emitter_sequence_start	(AsYamlEmitter	*emitter);
+void		 as_yaml_emitter_sequence_end	(AsYamlEmitter	*emitter);
+void		 as_yaml_emitter_scalar		(AsYamlEmitter	*emitter,
+						 const gchar	*value);
+void		 as_yaml_emitter_string		(AsYamlEmitter	*emitter,
+						 const gchar	*value);
+void		 as_yaml_emitter_key		(AsYamlEmitter	*emitter,
+						 const gchar	*key);
+void		 as_yaml_emitter_key_value	(AsYamlEmitter	*emitter,
+						 const gchar	*key,
+						 const gchar	*value);
+void		 as_yaml_emitter_key_value_plain (AsYamlEmitter	*emitter,
+						 const gchar	*key,
+						 const gchar	*value);
 
 G_END_DECLS
 